@@ -0,0 +1,295 @@
+#include "append_cache.h"
+#include "pipe_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CACHED_FILES 64
+#define LINES_PER_WRITEV 512                    // Each line takes two iovecs (text and newline).
+#define GROUP_BUFFER_LIMIT (1024 * 1024)        // Buffered bytes per file that force a flush.
+#define DEFAULT_GROUP_INTERVAL_MS 1000
+
+// An append descriptor kept open between writeline calls.
+typedef struct {
+    char *path;                 // Absolute path the descriptor was opened with, or NULL if free.
+    uint32_t pathHash;          // Hash of path, compared before the string.
+    int fd;                     // Descriptor opened with O_APPEND.
+    dev_t device;               // Identity of the file the descriptor refers to; if the path
+    ino_t inode;                // now names a different file, the descriptor is reopened.
+    unsigned long lastUse;      // Use counter value at the last access, for eviction.
+    char *buffer;               // Lines waiting for a group commit.
+    size_t bufferLength;
+    size_t bufferCapacity;
+} AppendTarget;
+
+static AppendTarget targets[MAX_CACHED_FILES];
+static unsigned long useCounter = 0;
+
+// Group commit: lines are buffered per file and written together.
+static bool groupCommit = false;
+static long groupIntervalMs = DEFAULT_GROUP_INTERVAL_MS;
+static struct timespec oldestBufferedLine;
+static bool haveBufferedLines = false;
+
+// FNV-1a hash of a path.
+static inline uint32_t hashPath(const char* path) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)path; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+// Opens path for appending and fills info with the identity of the file that was opened.
+// Returns the descriptor, or -1 if the file cannot be opened.
+static int openAppendFile(const char* path, struct stat* info) {
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+    if (fd >= 0 && fstat(fd, info) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Checks that a cached descriptor still refers to the file its path names, and reopens it
+// if the file was removed or replaced. Buffered lines are kept, so they go to the file the
+// path names when they are committed. Returns false if the file cannot be reopened.
+static bool verifyTarget(AppendTarget* target) {
+    struct stat info;
+    if (stat(target->path, &info) == 0 && info.st_ino == target->inode && info.st_dev == target->device) {
+        return true;
+    }
+    int fd = openAppendFile(target->path, &info);
+    if (fd < 0) {
+        return false;
+    }
+    close(target->fd);
+    target->fd = fd;
+    target->device = info.st_dev;
+    target->inode = info.st_ino;
+    return true;
+}
+
+// Writes a target's buffered lines to the file its path names now.
+static bool flushTarget(AppendTarget* target) {
+    bool ok = true;
+    if (target->bufferLength > 0) {
+        ok = verifyTarget(target) && writeAll(target->fd, target->buffer, target->bufferLength);
+        target->bufferLength = 0;
+    }
+    return ok;
+}
+
+// Flushes and closes a cached descriptor, leaving the entry free.
+static void releaseTarget(AppendTarget* target) {
+    if (target->path == NULL) {
+        return;
+    }
+    if (!flushTarget(target)) {
+        perror(target->path);
+    }
+    close(target->fd);
+    free(target->path);
+    free(target->buffer);
+    memset(target, 0, sizeof(*target));
+    target->fd = -1;
+}
+
+// Opens path for appending and records the identity of the file that was opened.
+static bool openTarget(AppendTarget* target, const char* path, uint32_t pathHash) {
+    struct stat info;
+    int fd = openAppendFile(path, &info);
+    if (fd < 0) {
+        return false;
+    }
+
+    target->path = strdup(path);
+    if (target->path == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    target->pathHash = pathHash;
+    target->fd = fd;
+    target->device = info.st_dev;
+    target->inode = info.st_ino;
+    return true;
+}
+
+// Returns the cached entry for path, opening (and if necessary evicting) one on a miss.
+// With verify set, a cached descriptor is checked against the file the path names now and
+// reopened if the file was removed or replaced. Returns NULL if the file cannot be opened.
+static AppendTarget* findTarget(const char* path, bool verify) {
+    uint32_t pathHash = hashPath(path);
+    AppendTarget *victim = &targets[0];
+    useCounter++;
+
+    for (int i = 0; i < MAX_CACHED_FILES; i++) {
+        AppendTarget *target = &targets[i];
+        if (target->path != NULL && target->pathHash == pathHash && strcmp(target->path, path) == 0) {
+            if (verify && !verifyTarget(target)) {
+                return NULL;
+            }
+            target->lastUse = useCounter;
+            return target;
+        }
+        // Prefer a free entry, otherwise the least recently used one.
+        if (victim->path != NULL && (target->path == NULL || target->lastUse < victim->lastUse)) {
+            victim = target;
+        }
+    }
+
+    releaseTarget(victim);
+    if (!openTarget(victim, path, pathHash)) {
+        return NULL;
+    }
+    victim->lastUse = useCounter;
+    return victim;
+}
+
+// Appends a buffer to a target's group-commit buffer.
+static void bufferLine(AppendTarget* target, const char* line, size_t length) {
+    if (target->bufferLength + length > target->bufferCapacity) {
+        size_t capacity = target->bufferCapacity ? target->bufferCapacity : 64 * 1024;
+        while (capacity < target->bufferLength + length) {
+            capacity *= 2;
+        }
+        char *grown = realloc(target->buffer, capacity);
+        if (grown == NULL) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        target->buffer = grown;
+        target->bufferCapacity = capacity;
+    }
+    memcpy(target->buffer + target->bufferLength, line, length);
+    target->bufferLength += length;
+}
+
+// Returns path made absolute against the current directory, in buffer, so that a cached
+// relative path keeps naming the same file after cd. Absolute paths are returned as they are.
+static const char* absolutePath(const char* path, char* buffer, size_t size) {
+    if (path[0] == '/' || getcwd(buffer, size) == NULL) {
+        return path;
+    }
+    size_t length = strlen(buffer);
+    int written = snprintf(buffer + length, size - length, "%s%s", length > 1 ? "/" : "", path);
+    return written >= 0 && (size_t)written < size - length ? buffer : path;
+}
+
+// Appends each string in the NULL-terminated lines array to path as its own line. The
+// descriptor is taken from the cache and all lines go out in a single writev (or a few,
+// for very long argument lists). In group-commit mode the lines are buffered instead.
+bool appendLines(const char* path, char** lines) {
+    // Buffered lines are checked against the file when they are committed instead.
+    char absolute[PATH_MAX];
+    AppendTarget *target = findTarget(absolutePath(path, absolute, sizeof(absolute)), !groupCommit);
+    if (target == NULL) {
+        return false;
+    }
+
+    if (groupCommit) {
+        for (int i = 0; lines[i] != NULL; i++) {
+            bufferLine(target, lines[i], strlen(lines[i]));
+            bufferLine(target, "\n", 1);
+        }
+        if (!haveBufferedLines) {
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &oldestBufferedLine);
+            haveBufferedLines = true;
+        }
+        if (target->bufferLength >= GROUP_BUFFER_LIMIT && !flushTarget(target)) {
+            return false;
+        }
+        tickAppendCache();
+        return true;
+    }
+
+    struct iovec vectors[LINES_PER_WRITEV * 2];
+    int i = 0;
+    while (lines[i] != NULL) {
+        int numVectors = 0;
+        size_t expected = 0;
+        for (; lines[i] != NULL && numVectors < LINES_PER_WRITEV * 2; i++) {
+            vectors[numVectors].iov_base = lines[i];
+            vectors[numVectors].iov_len = strlen(lines[i]);
+            vectors[numVectors + 1].iov_base = "\n";
+            vectors[numVectors + 1].iov_len = 1;
+            expected += vectors[numVectors].iov_len + 1;
+            numVectors += 2;
+        }
+
+        ssize_t written = writev(target->fd, vectors, numVectors);
+        if (written < 0) {
+            return false;
+        }
+        if ((size_t)written < expected) {
+            // Rare short write: finish the remainder one piece at a time.
+            size_t skip = (size_t)written;
+            for (int v = 0; v < numVectors; v++) {
+                if (skip >= vectors[v].iov_len) {
+                    skip -= vectors[v].iov_len;
+                    continue;
+                }
+                if (!writeAll(target->fd, (char *)vectors[v].iov_base + skip, vectors[v].iov_len - skip)) {
+                    return false;
+                }
+                skip = 0;
+            }
+        }
+    }
+    return true;
+}
+
+// Turns group commit on or off. Turning it off flushes everything buffered.
+void setGroupCommit(bool enabled, long intervalMilliseconds) {
+    if (!enabled) {
+        flushAppendCache();
+    }
+    groupCommit = enabled;
+    if (intervalMilliseconds > 0) {
+        groupIntervalMs = intervalMilliseconds;
+    }
+}
+
+// Returns true if writeline is currently buffering lines for group commit.
+bool groupCommitEnabled() {
+    return groupCommit;
+}
+
+// Flushes buffered lines once the oldest of them has waited for the commit interval.
+void tickAppendCache() {
+    if (!haveBufferedLines) {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    long waited = (now.tv_sec - oldestBufferedLine.tv_sec) * 1000 + (now.tv_nsec - oldestBufferedLine.tv_nsec) / 1000000;
+    if (waited >= groupIntervalMs) {
+        flushAppendCache();
+    }
+}
+
+// Writes out every buffered line.
+void flushAppendCache() {
+    for (int i = 0; i < MAX_CACHED_FILES; i++) {
+        if (targets[i].path != NULL && !flushTarget(&targets[i])) {
+            perror(targets[i].path);
+        }
+    }
+    haveBufferedLines = false;
+}
+
+// Flushes and closes every cached descriptor.
+void closeAppendCache() {
+    for (int i = 0; i < MAX_CACHED_FILES; i++) {
+        releaseTarget(&targets[i]);
+    }
+    haveBufferedLines = false;
+}
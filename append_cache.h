@@ -0,0 +1,9 @@
+#pragma once
+#include <stdbool.h>
+
+bool appendLines(const char* path, char** lines);
+void setGroupCommit(bool enabled, long intervalMilliseconds);
+bool groupCommitEnabled();
+void tickAppendCache();
+void flushAppendCache();
+void closeAppendCache();
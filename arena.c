@@ -0,0 +1,124 @@
+#include "arena.h"
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT alignof(max_align_t)
+
+// Rounds a size up to the arena's allocation alignment.
+static inline size_t alignSize(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+// Allocates a new block large enough to hold at least minimumSize bytes.
+static ArenaBlock* newBlock(size_t minimumSize) {
+    size_t capacity = minimumSize > ARENA_BLOCK_SIZE ? alignSize(minimumSize) : ARENA_BLOCK_SIZE;
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + capacity);
+    if (block == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+// Initializes an empty arena. The first block is allocated on first use.
+void arenaInit(Arena* arena) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->lastAllocation = NULL;
+}
+
+// Returns size bytes of suitably aligned storage that lives until the arena is reset.
+void* arenaAlloc(Arena* arena, size_t size) {
+    size = alignSize(size == 0 ? 1 : size);
+
+    if (arena->current == NULL) {
+        arena->first = arena->current = newBlock(size);
+    }
+
+    ArenaBlock *block = arena->current;
+    if (block->capacity - block->used < size) {
+        // Move on to the next retained block if it fits, otherwise splice a new one in.
+        ArenaBlock *next = block->next;
+        if (next != NULL && next->capacity >= size) {
+            next->used = 0;
+            block = next;
+        } else {
+            ArenaBlock *inserted = newBlock(size);
+            inserted->next = next;
+            block->next = inserted;
+            block = inserted;
+        }
+        arena->current = block;
+    }
+
+    void *allocation = block->data + block->used;
+    block->used += size;
+    arena->lastAllocation = allocation;
+    return allocation;
+}
+
+// Resizes an arena allocation. The most recent allocation is extended in place when the
+// current block has room; otherwise the contents are copied to a fresh allocation.
+void* arenaGrow(Arena* arena, void* allocation, size_t oldSize, size_t newSize) {
+    if (allocation == NULL) {
+        return arenaAlloc(arena, newSize);
+    }
+
+    ArenaBlock *block = arena->current;
+    if (allocation == arena->lastAllocation) {
+        size_t start = (size_t)((unsigned char *)allocation - block->data);
+        size_t alignedSize = alignSize(newSize);
+        if (start + alignedSize <= block->capacity) {
+            block->used = start + alignedSize;
+            return allocation;
+        }
+    }
+
+    void *grown = arenaAlloc(arena, newSize);
+    memcpy(grown, allocation, oldSize < newSize ? oldSize : newSize);
+    return grown;
+}
+
+// Captures the current allocation position.
+ArenaMark arenaMark(Arena* arena) {
+    ArenaMark mark = { arena->current, arena->current ? arena->current->used : 0 };
+    return mark;
+}
+
+// Releases everything allocated since the mark was taken. Blocks stay in the chain.
+void arenaRelease(Arena* arena, ArenaMark mark) {
+    if (mark.block == NULL) {
+        arenaReset(arena);
+        return;
+    }
+    arena->current = mark.block;
+    arena->current->used = mark.used;
+    arena->lastAllocation = NULL;
+}
+
+// Releases every allocation in O(1), keeping the blocks for reuse.
+void arenaReset(Arena* arena) {
+    arena->current = arena->first;
+    if (arena->current != NULL) {
+        arena->current->used = 0;
+    }
+    arena->lastAllocation = NULL;
+}
+
+// Frees all blocks owned by the arena.
+void arenaDestroy(Arena* arena) {
+    ArenaBlock *block = arena->first;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arenaInit(arena);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdalign.h>
+#include <stddef.h>
+
+// A bump allocator made of a chain of blocks. Allocations are never freed individually;
+// the whole arena (or everything allocated after a mark) is released at once. Blocks are
+// kept after a reset so that steady-state use performs no heap allocation at all.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;        // Next block in the chain (kept across resets for reuse).
+    size_t capacity;                // Usable bytes in data.
+    size_t used;                    // Bytes handed out from data.
+    alignas(max_align_t) unsigned char data[];  // Block storage, aligned like malloc's.
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first;              // Head of the block chain.
+    ArenaBlock *current;            // Block that allocations are currently served from.
+    void *lastAllocation;           // Most recent allocation, which arenaGrow can extend in place.
+} Arena;
+
+// A saved allocation position that can later be restored with arenaRelease.
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+void arenaInit(Arena* arena);
+void* arenaAlloc(Arena* arena, size_t size);
+void* arenaGrow(Arena* arena, void* allocation, size_t oldSize, size_t newSize);
+ArenaMark arenaMark(Arena* arena);
+void arenaRelease(Arena* arena, ArenaMark mark);
+void arenaReset(Arena* arena);
+void arenaDestroy(Arena* arena);
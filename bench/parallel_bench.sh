@@ -0,0 +1,47 @@
+#!/bin/sh
+# Parallel batch benchmark: wall time and speedup of `parallel -j N` over running the same
+# commands one after another, for commands that wait (sleep) and commands that compute
+# (sha256sum of a file). The waiting case shows the overlap the batch gives whatever the
+# CPU count; the computing case can only speed up as far as there are CPUs.
+#
+# Build the shell with the command in the README, then run from the repository root:
+#     sh bench/parallel_bench.sh [shell] [commands]
+shell=${1:-./lopesShell}
+count=${2:-16}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Times a one-line script in a fresh shell and prints the seconds taken.
+elapsed() {
+    printf '%s\n' "$1" > "$work/script"
+    start=$(date +%s.%N)
+    "$shell" "$work/script" > /dev/null
+    end=$(date +%s.%N)
+    echo "$start $end" | awk '{ printf "%.3f", $2 - $1 }'
+}
+
+# Joins count copies of a command with ;.
+repeat() {
+    line=$1
+    i=1
+    while [ $i -lt "$count" ]; do
+        line="$line; $1"
+        i=$((i + 1))
+    done
+    echo "$line"
+}
+
+bench() {
+    commands=$(repeat "$2")
+    serial=$(elapsed "$commands")
+    printf '%s, %d commands, %d CPUs\n' "$1" "$count" "$(nproc)"
+    printf '  %-12s %7.3f s\n' "sequential" "$serial"
+    for jobs in 1 2 4 8; do
+        seconds=$(elapsed "parallel -j $jobs $commands")
+        echo "$serial $seconds" | awk -v jobs="$jobs" '{ printf "  -j %-9s %7.3f s  %5.2fx\n", jobs, $2, $1 / $2 }'
+    done
+}
+
+elapsed "randomtxt -s 1 $work/data 64M" > /dev/null
+bench "sleep 0.2" "sleep 0.2"
+bench "sha256sum of 64 MiB" "sha256sum $work/data"
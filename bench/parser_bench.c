@@ -0,0 +1,150 @@
+// Command line tokenizer microbenchmark: tokens per second for the original strtok-based
+// splitCommands/getArgumentList, which copied every token to the heap, and for the
+// single-pass parseCommandList, which points into the input line.
+//
+// Build from the repository root and run:
+//     gcc -O2 -o parser_bench bench/parser_bench.c command_parser.c arena.c utilities.c -I.
+//     ./parser_bench [commands_per_line] [lines]
+#include "command_parser.h"
+#include "utilities.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The original tokenizer, kept here as the baseline.
+static char** legacyGetArgumentList(char* command) {
+    char *delim = " \n";
+    char *command_copy = copyString(command);
+    int numTokens = 0;
+    char *token = strtok(command, delim);
+    while (token != NULL) {
+        numTokens++;
+        token = strtok(NULL, delim);
+    }
+    numTokens++;
+    char **argumentsV = malloc(sizeof(char *) * (numTokens + 1));
+    token = strtok(command_copy, delim);
+    int i = 0;
+    for (i = 0; token != NULL; i++) {
+        argumentsV[i] = malloc(sizeof(char) * (strlen(token) + 1));
+        strcpy(argumentsV[i], token);
+        token = strtok(NULL, delim);
+    }
+    argumentsV[i] = NULL;
+    free(command_copy);
+    return argumentsV;
+}
+
+static char** legacySplitCommands(char* commands) {
+    if (strlen(commands) == 0) {
+        return NULL;
+    }
+    char *delim = ";";
+    char *commands_copy = copyString(commands);
+    int numTokens = 0;
+    char *token = strtok(commands, delim);
+    while (token != NULL) {
+        numTokens++;
+        token = strtok(NULL, delim);
+    }
+    numTokens++;
+    char **argumentsV = malloc(sizeof(char *) * (numTokens + 1));
+    token = strtok(commands_copy, delim);
+    int i = 0;
+    for (i = 0; token != NULL; i++) {
+        argumentsV[i] = malloc(sizeof(char) * (strlen(token) + 1));
+        strcpy(argumentsV[i], token);
+        token = strtok(NULL, delim);
+    }
+    argumentsV[i] = NULL;
+    free(commands_copy);
+    return argumentsV;
+}
+
+// Splits, tokenizes and frees a line the way the original runCommand did. Returns the
+// number of arguments.
+static size_t legacyParse(char* line) {
+    size_t tokens = 0;
+    char **commandList = legacySplitCommands(line);
+    int numCommands = 0;
+    while (commandList[numCommands] != NULL) {
+        numCommands++;
+    }
+    char ***arguments = malloc(sizeof(char **) * (numCommands + 1));
+    for (int i = 0; i < numCommands; i++) {
+        arguments[i] = legacyGetArgumentList(commandList[i]);
+    }
+    for (int i = 0; i < numCommands; i++) {
+        free(commandList[i]);
+    }
+    free(commandList);
+    for (int i = 0; i < numCommands; i++) {
+        for (int j = 0; arguments[i][j] != NULL; j++) {
+            free(arguments[i][j]);
+            tokens++;
+        }
+        free(arguments[i]);
+    }
+    free(arguments);
+    return tokens;
+}
+
+// Parses a line with parseCommandList, releasing the arena afterwards. Returns the number
+// of arguments.
+static size_t arenaParse(Arena* arena, char* line) {
+    CommandList commandList;
+    size_t tokens = 0;
+    ArenaMark mark = arenaMark(arena);
+    parseCommandList(arena, line, &commandList);
+    for (size_t i = 0; i < commandList.numCommands; i++) {
+        for (size_t s = 0; s < commandList.commands[i].numStages; s++) {
+            for (char **argument = commandList.commands[i].stages[s]; *argument != NULL; argument++) {
+                tokens++;
+            }
+        }
+    }
+    arenaRelease(arena, mark);
+    return tokens;
+}
+
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char** argv) {
+    int commandsPerLine = argc > 1 ? atoi(argv[1]) : 200;
+    int numLines = argc > 2 ? atoi(argv[2]) : 20000;
+
+    // A generated line of commands like the ones scripts send: `accessmem 17 40960 w; ...`.
+    size_t capacity = (size_t)commandsPerLine * 64 + 1;
+    char *line = malloc(capacity);
+    char *buffer = malloc(capacity);
+    size_t length = 0;
+    for (int i = 0; i < commandsPerLine; i++) {
+        length += (size_t)snprintf(line + length, capacity - length, "%saccessmem %d %d w extra%d", i ? "; " : "",
+                                   i % 50, i * 4096, i);
+    }
+
+    Arena arena;
+    arenaInit(&arena);
+    const char *names[] = { "strtok + malloc (before)", "single pass + arena (after)" };
+    for (int variant = 0; variant < 2; variant++) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        size_t tokens = 0;
+        for (int i = 0; i < numLines; i++) {
+            memcpy(buffer, line, length + 1);
+            tokens += variant == 0 ? legacyParse(buffer) : arenaParse(&arena, buffer);
+        }
+        double seconds = secondsSince(&start);
+        printf("%-28s %zu tokens in %.3f s: %.1f M tokens/s\n", names[variant], tokens, seconds,
+               (double)tokens / seconds / 1e6);
+    }
+    arenaDestroy(&arena);
+    free(line);
+    free(buffer);
+    return 0;
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Pipeline throughput benchmark: GB/s through lopesShell pipelines of increasing depth, fed
+# by `randomtxt -` and drained by `writeline`, against the temporary file the same data
+# had to go through before pipes were supported. Each case is a one-line script run by a
+# fresh shell, so the timings include its startup.
+#
+# Build the shell with the command in the README, then run from the repository root:
+#     sh bench/pipeline_bench.sh [shell] [size]
+shell=${1:-./lopesShell}
+size=${2:-2G}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+case $size in
+    *G) bytes=$((${size%G} << 30)) ;;
+    *M) bytes=$((${size%M} << 20)) ;;
+    *) bytes=$size ;;
+esac
+
+run() {
+    printf '%s\n' "$2" > "$work/script"
+    start=$(date +%s.%N)
+    "$shell" "$work/script" > /dev/null
+    end=$(date +%s.%N)
+    echo "$start $end $bytes" | awk -v name="$1" '{ s = $2 - $1; printf "%-40s %7.3f s %6.2f GB/s\n", name, s, $3 / s / 1e9 }'
+}
+
+echo "$size through each pipeline"
+run "randomtxt to a file (generator)" "randomtxt $work/data $size"
+rm -f "$work/data"
+run "temporary file, then cat" "randomtxt $work/data $size; cat $work/data; rm $work/data"
+run "randomtxt | writeline" "randomtxt - $size | writeline /dev/null"
+run "randomtxt | cat | writeline" "randomtxt - $size | cat | writeline /dev/null"
+run "randomtxt | cat | cat | cat | writeline" "randomtxt - $size | cat | cat | cat | writeline /dev/null"
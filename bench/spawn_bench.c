@@ -0,0 +1,65 @@
+// Command startup microbenchmark: spawns per second and spawn-to-exit latency percentiles
+// of `true` for each spawn backend. The shell's own memory is simulated with a touched heap
+// of the given size, since that is what fork has to copy the page tables of.
+//
+// Build from the repository root and run:
+//     gcc -O2 -o spawn_bench bench/spawn_bench.c process_spawn.c path_cache.c -I.
+//     ./spawn_bench [spawns] [heap_megabytes]
+#include "process_spawn.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+
+static double nowSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Returns the latency below which the given fraction of the sorted samples fall.
+static double percentile(const double *sorted, int count, double fraction) {
+    int index = (int)(fraction * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+int main(int argc, char** argv) {
+    int numSpawns = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t heapMegabytes = argc > 2 ? (size_t)atol(argv[2]) : 256;
+
+    // Touch every page so it is mapped in the page tables a fork would copy.
+    size_t heapSize = heapMegabytes << 20;
+    char *heap = malloc(heapSize ? heapSize : 1);
+    memset(heap, 1, heapSize);
+
+    double *latencies = malloc(sizeof(double) * (size_t)numSpawns);
+    char *arguments[] = { "true", NULL };
+    printf("%d spawns of true, %zu MB of touched heap\n", numSpawns, heapMegabytes);
+    for (SpawnBackend backend = SPAWN_POSIX_SPAWN; backend <= SPAWN_FORK; backend++) {
+        setSpawnBackend(backend);
+        double start = nowSeconds();
+        for (int i = 0; i < numSpawns; i++) {
+            double spawnStart = nowSeconds();
+            pid_t pid = spawnCommand(arguments, -1, -1, -1);
+            if (pid < 0) {
+                return EXIT_FAILURE;
+            }
+            waitpid(pid, NULL, 0);
+            latencies[i] = nowSeconds() - spawnStart;
+        }
+        double seconds = nowSeconds() - start;
+        qsort(latencies, (size_t)numSpawns, sizeof(double), compareDoubles);
+        printf("%-12s %8.0f spawns/s   p50 %7.1f us   p90 %7.1f us   p99 %7.1f us\n",
+               spawnBackendName(backend), numSpawns / seconds, percentile(latencies, numSpawns, 0.50) * 1e6,
+               percentile(latencies, numSpawns, 0.90) * 1e6, percentile(latencies, numSpawns, 0.99) * 1e6);
+    }
+    free(latencies);
+    free(heap);
+    return 0;
+}
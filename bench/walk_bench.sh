@@ -0,0 +1,53 @@
+#!/bin/sh
+# Directory walk benchmark: wall time of the find and du builtins against GNU find
+# (findutils) and du (coreutils) on a generated tree, with a warm cache. Each builtin run is
+# a one-line script in a fresh shell, so the timings include its startup.
+#
+# Build the shell with the command in the README, then run from the repository root:
+#     sh bench/walk_bench.sh [shell] [fanout]
+# The tree has fanout^3 directories holding 8 files each.
+shell=${1:-./lopesShell}
+fanout=${2:-20}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+for a in $(seq "$fanout"); do
+    for b in $(seq "$fanout"); do
+        for c in $(seq "$fanout"); do
+            mkdir -p "$work/tree/d$a/d$b/d$c"
+        done
+    done
+done
+for directory in $(find "$work/tree" -mindepth 3 -type d); do
+    touch "$directory/a.txt" "$directory/b.txt" "$directory/c.log" "$directory/d.log" \
+          "$directory/e.c" "$directory/f.c" "$directory/g.h" "$directory/h.h"
+done
+echo "$(find "$work/tree" -type d | wc -l) directories, $(find "$work/tree" -type f | wc -l) files"
+
+# Prints the best of three wall times of a command.
+best() {
+    for run in 1 2 3; do
+        start=$(date +%s.%N)
+        "$@" > /dev/null
+        end=$(date +%s.%N)
+        echo "$start $end"
+    done | awk 'NR == 1 || $2 - $1 < best { best = $2 - $1 } END { printf "%.3f", best }'
+}
+
+builtin() {
+    printf '%s\n' "$1" > "$work/script"
+    best "$shell" "$work/script"
+}
+
+compare() {
+    ours=$(builtin "$2")
+    theirs=$(best $3)
+    echo "$ours $theirs" | awk -v name="$1" '{ printf "%-22s lopesShell %7.3f s   GNU %7.3f s   %5.2fx\n", name, $1, $2, $2 / $1 }'
+}
+
+# Warm the cache.
+find "$work/tree" > /dev/null
+compare "find -name" "find $work/tree -name e.c" "find $work/tree -name e.c"
+compare "find -type d" "find $work/tree -type d" "find $work/tree -type d"
+compare "du -s" "du -s $work/tree" "du -s $work/tree"
+compare "du -h" "du -h $work/tree" "du -h $work/tree"
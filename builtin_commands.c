@@ -1,51 +1,191 @@
 #include "builtin_commands.h"
+#include "checkpoint.h"
+#include "command_executor.h"
 #include "constants.h"
+#include "jobs.h"
+#include "parallel.h"
+#include "path_cache.h"
+#include "process_spawn.h"
+#include "script_file.h"
+#include "swap.h"
+#include "tlb.h"
+#include "trace.h"
+#include "vmm_replay.h"
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "createFileProcess.h"
-
-// Function to check and execute built-in commands.
-int checkAdditionalCommands(char** arguments) {
-    // Check if the first argument is NULL or the 'quit' command, and if so, exit the shell.
-    if ((!arguments[0]) || (strcmp(arguments[0], CMD_QUIT) == 0)) {
-        printf("Exiting shell...\n");
-        exit(EXIT_SUCCESS); // Exit the program successfully.
+
+// Handlers for the shell's own commands.
+static void executeQuit(char** arguments);
+static void executeFile(char** arguments);
+static void executeSpawnMode(char** arguments);
+static void executeHash(char** arguments);
+
+// Registry of every built-in command. New commands are added here and nowhere else; the
+// dispatcher in runCommand and the help pages both look commands up through this table.
+static const BuiltinCommand builtinTable[] = {
+    { CMD_EXECUTE_FILE,     executeFile,                NULL,               HELP_EXECUTE_FILE, "Execute a lopesShell script file." },
+    { CMD_HELP,             showHelp,                   NULL,               HELP_HELP,         "Info on using lopesShell. Use `help help` for additional information on features." },
+    { CMD_QUIT,             executeQuit,                NULL,               HELP_QUIT,         "Exit lopesShell." },
+    { CMD_SPAWN_MODE,       executeSpawnMode,           NULL,               HELP_SUMMARY,      "Show or select how external commands are started: `spawnmode [posix_spawn|vfork|fork]`." },
+    { CMD_HASH,             executeHash,                NULL,               HELP_SUMMARY,      "Show, fill or flush (-r) the command path cache: `hash [-r] [name ...]`." },
+    { CMD_JOBS,             executeJobs,                NULL,               HELP_SUMMARY,      "List background jobs started with `&`." },
+    { CMD_WAIT,             executeWait,                NULL,               HELP_SUMMARY,      "Wait for background jobs: `wait [%job|pid ...]`." },
+    { CMD_FOREGROUND,       executeForeground,          NULL,               HELP_SUMMARY,      "Wait for a background job in the foreground, resuming it if stopped: `fg [%job]`." },
+    { CMD_BACKGROUND,       executeBackground,          NULL,               HELP_SUMMARY,      "Resume a stopped job in the background: `bg [%job]`." },
+    { CMD_PARALLEL,         executeParallel,            runParallelCommand, HELP_SUMMARY,      "Run the rest of the line as a parallel batch: `parallel [-j jobs] [-t] command [; command ...]`." },
+    { CMD_CREATE_PROCESS,   executeCreateProcess,       NULL,               HELP_SUMMARY,      "Create a simulated process: `createproc <pid> <memory_size> [burst_time]`." },
+    { CMD_ALLOCATE_MEMORY,  executeAllocateMemory,      NULL,               HELP_SUMMARY,      "Allocate memory to a process: `allocmem <pid> <size>`." },
+    { CMD_ACCESS_MEMORY,    executeAccessMemory,        NULL,               HELP_SUMMARY,      "Read or write a virtual address: `accessmem <pid> <virtual_address> [r|w]`." },
+    { CMD_FREE_MEMORY,      executeFreeMemory,          NULL,               HELP_SUMMARY,      "Free memory from a process: `freemem <pid> <size>`." },
+    { CMD_FORK_PROCESS,     executeForkProcess,         NULL,               HELP_SUMMARY,      "Fork a process, sharing its memory copy-on-write: `forkproc <parent_pid> <child_pid>`." },
+    { CMD_SWAP_ON,          executeSwapOn,              NULL,               HELP_SUMMARY,      "Swap evicted pages to a file, or show swap statistics: `swapon [<file> [size] [readahead_pages]]`." },
+    { CMD_SAVE,             executeSave,                NULL,               HELP_SUMMARY,      "Save every process, page table and frame, and the scheduler queue, to an image: `save <file>`." },
+    { CMD_LOAD,             executeLoad,                NULL,               HELP_SUMMARY,      "Restore a saved image into a shell with no processes or swap yet: `load <file>`." },
+    { CMD_VMM_STATS,        executeVMMStats,            NULL,               HELP_SUMMARY,      "Show hits, faults, evictions and write-backs: `vmmstats [pid|all]`." },
+    { CMD_TLB,              executeTLB,                 NULL,               HELP_SUMMARY,      "Show TLB statistics, reconfigure it or flush it: `tlb`, `tlb config <entries> <ways> [lru|fifo|random]`, `tlb flush [pid]`." },
+    { CMD_VMM_TRACE,        executeVMMTrace,            NULL,               HELP_SUMMARY,      "Replay a file of memory accesses: `vmmtrace <file> [cpus]`, `vmmtrace scale <file>`, `vmmtrace convert <text_file> <binary_file>`." },
+    { CMD_TRACE,            executeTrace,               NULL,               HELP_SUMMARY,      "Set VMM and scheduler output: `trace [silent|summary|event]`, `trace file <path> [text|binary]`, `trace stats|tail|flush`." },
+    { CMD_DELETE_DIR_EMPTY, executeRemoveDirectory,     NULL,               HELP_SUMMARY,      "Delete an empty directory: `rmdir <dir_name>`." },
+    { CMD_CHANGE_DIR,       executeChangeDirectory,     NULL,               HELP_SUMMARY,      "Change the active directory: `cd <path>`." },
+    { CMD_WRITE_LINE,       executeWriteLine,           NULL,               HELP_SUMMARY,      "Append lines to a file: `writeline <filename> [args] ...` (`-g on|off|flush` for group commit)." },
+    { CMD_RANDOM_WRITE,     executeRandomText,          NULL,               HELP_SUMMARY,      "Append random characters to a file: `randomtxt [-p] [-s seed] [-t threads] <filename> <numChars>`." },
+    { CMD_COPY,             executeCopy,                NULL,               HELP_SUMMARY,      "Copy files, or directory trees with -r: `cp <source> ... <destination> [-r]`." },
+    { CMD_MOVE,             executeMove,                NULL,               HELP_SUMMARY,      "Move or rename files and directories: `mv <source> ... <destination>`." },
+    { CMD_REMOVE,           executeRemove,              NULL,               HELP_SUMMARY,      "Delete files, or directory trees with -r: `rm [-r] [-f] <path> ...`." },
+    { CMD_MAKE_DIR,         executeMakeDirectory,       NULL,               HELP_SUMMARY,      "Create directories, with their parents if -p is given: `mkdir [-p] <dir_name> ...`." },
+    { CMD_TOUCH,            executeTouch,               NULL,               HELP_SUMMARY,      "Create empty files or update their times: `touch <filename> ...`." },
+    { CMD_FIND,             executeFind,                NULL,               HELP_SUMMARY,      "Search a directory tree: `find [path ...] [-name pattern] [-type f|d|l]`." },
+    { CMD_DISK_USAGE,       executeDiskUsage,           NULL,               HELP_SUMMARY,      "Show the space used by a directory tree: `du [-h] [-s] [directory ...]`." },
+};
+
+#define NUM_BUILTINS (sizeof(builtinTable) / sizeof(builtinTable[0]))
+#define MAX_BUILTIN_SLOTS 1024
+
+// Perfect hash over the registry: slot = hash(name, seed) & mask maps every builtin to a
+// distinct slot, so a lookup is one hash and at most one string comparison.
+static const BuiltinCommand *builtinSlots[MAX_BUILTIN_SLOTS];
+static uint32_t builtinSeed = 0;
+static uint32_t builtinMask = 0;
+
+// FNV-1a hash of a command name, perturbed by a seed.
+static inline uint32_t hashName(const char* name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// Searches for a seed and table size that place every registered builtin in its own slot.
+void initializeBuiltins() {
+    uint32_t numSlots = 1;
+    while (numSlots < 2 * NUM_BUILTINS) {
+        numSlots <<= 1;
+    }
+
+    for (; numSlots <= MAX_BUILTIN_SLOTS; numSlots <<= 1) {
+        for (uint32_t seed = 0; seed < 4096; seed++) {
+            bool collision = false;
+            memset(builtinSlots, 0, sizeof(builtinSlots));
+            for (size_t i = 0; i < NUM_BUILTINS && !collision; i++) {
+                uint32_t slot = hashName(builtinTable[i].name, seed) & (numSlots - 1);
+                if (builtinSlots[slot] != NULL) {
+                    collision = true;
+                } else {
+                    builtinSlots[slot] = &builtinTable[i];
+                }
+            }
+            if (!collision) {
+                builtinSeed = seed;
+                builtinMask = numSlots - 1;
+                return;
+            }
+        }
+    }
+
+    fprintf(stderr, "Failed to build the builtin command table\n");
+    exit(EXIT_FAILURE);
+}
+
+// Returns the registry entry for a command name, or NULL if it is not a builtin.
+const BuiltinCommand* findBuiltin(const char* name) {
+    const BuiltinCommand *entry = builtinSlots[hashName(name, builtinSeed) & builtinMask];
+    if (entry != NULL && strcmp(entry->name, name) == 0) {
+        return entry;
+    }
+    return NULL;
+}
+
+// Exits the shell.
+static void executeQuit(char** arguments) {
+    printf("Exiting shell...\n");
+    exit(EXIT_SUCCESS); // Exit the program successfully.
+}
+
+// Executes a batch file. With `-j N` or `-t` the file's commands run as a parallel batch.
+static void executeFile(char** arguments) {
+    ParallelOptions options;
+    int fileArgument = parseParallelOptions(arguments, &options);
+    if (fileArgument < 0 || arguments[fileArgument] == NULL) {
+        printf("Usage: %s [-j jobs] [-t] [fileName]\n", CMD_EXECUTE_FILE);
+        return;
+    }
+    if (fileArgument > 1) {
+        runParallelScript(arguments[fileArgument], &options);
+        return;
+    }
+
+    printf("Executing file!\n");
+    // Run the script's lines through the same dispatch path as the prompt.
+    if (!executeScriptFile(arguments[fileArgument])) {
+        perror("argument file does not exist");
+    }
+}
+
+// Shows or changes the backend used to start external commands.
+static void executeSpawnMode(char** arguments) {
+    if (arguments[1] == NULL) {
+        printf("%s: %s\n", CMD_SPAWN_MODE, spawnBackendName(getSpawnBackend()));
+        return;
+    }
+
+    SpawnBackend backend;
+    if (!parseSpawnBackend(arguments[1], &backend)) {
+        printf("Usage: %s [posix_spawn|vfork|fork]\n", CMD_SPAWN_MODE);
+        return;
     }
+    setSpawnBackend(backend);
+}
 
-    // If the first argument is 'help', display the help information.
-    if (strcmp(arguments[0], CMD_HELP) == 0) {
-        showHelp(arguments); // Call the function to show help information.
-        return 1; // Indicate that a built-in command was processed.
+// Shows the command path cache, flushes it with -r, or resolves the given names into it.
+static void executeHash(char** arguments) {
+    if (arguments[1] == NULL) {
+        printPathCache();
+        return;
     }
 
-    // If the first argument is 'execute file', execute a batch file.
-    if (strcmp(arguments[0], CMD_EXECUTE_FILE) == 0) {
-        printf("Executing file!\n");
-        // Call the function to create and execute a file process.
-        createFileProcess(arguments, arguments[1]);
-        return 1; // Indicate that a built-in command was processed.
+    for (int i = 1; arguments[i] != NULL; i++) {
+        if (strcmp(arguments[i], "-r") == 0) {
+            flushPathCache();
+        } else if (resolveCommandPath(arguments[i]) == NULL) {
+            printf("%s: %s: not found\n", CMD_HASH, arguments[i]);
+        }
     }
-    
-    return 0; // Return 0 if it's a standard command and not a built-in command.
 }
 
 // Function to display help information based on the arguments provided.
 void showHelp(char** arguments) {
     int helpInfo = HELP_DEFAULT; // Default help information.
+    const BuiltinCommand *entry = NULL;
 
     // Check if a specific help topic is requested.
     if (arguments[1] != NULL) {
         // Determine the type of help information needed based on the second argument.
-        if (strcmp(arguments[1], CMD_EXECUTE_FILE) == 0) {
-            helpInfo = HELP_EXECUTE_FILE;
-        } else if (strcmp(arguments[1], CMD_HELP) == 0) {
-            helpInfo = HELP_HELP;
-        } else if (strcmp(arguments[1], CMD_QUIT) == 0) {
-            helpInfo = HELP_QUIT;
-        } else {
-            helpInfo = HELP_ERROR; // If the command is not recognized.
-        }
+        entry = findBuiltin(arguments[1]);
+        helpInfo = entry ? entry->helpPage : HELP_ERROR;
     }
 
     // Display help information based on the determined help type.
@@ -54,15 +194,16 @@ void showHelp(char** arguments) {
         default:
             // General help information for various commands.
             printf("Enter `help [commandName]` to learn more about a shell given command.\n");
-            printf("- %s: Execute a bash script file.\n", CMD_EXECUTE_FILE);
-            printf("- %s: Info on using lopesShell. Use `%s %s` for additional information on features.\n", CMD_HELP, CMD_HELP, CMD_HELP);
-            printf("- %s: Exit lopesShell.\n", CMD_QUIT);
+            for (size_t i = 0; i < NUM_BUILTINS; i++) {
+                printf("- %s: %s\n", builtinTable[i].name, builtinTable[i].summary);
+            }
             break;
         case HELP_EXECUTE_FILE:
             // Help information for executing a file.
-            printf("%s: Execute a bash script file.\n", CMD_EXECUTE_FILE);
+            printf("%s: Execute a lopesShell script file.\n", CMD_EXECUTE_FILE);
             printf("Syntax: `%s [fileName]`\n", CMD_EXECUTE_FILE);
-            printf("- fileName: The name of the file containing the bash script. Ideally, the file should be a .txt file.\n");
+            printf("- fileName: The name of the file containing the script. Ideally, the file should be a .txt file.\n");
+            printf("- Each line is run by lopesShell itself, exactly as if it had been typed at the prompt.\n");
             break;
         case HELP_HELP:
             // Help information for the help command itself.
@@ -72,7 +213,7 @@ void showHelp(char** arguments) {
             printf("Additional Information:\n");
             printf("- When in prompt, multiple commands can be entered at once, separated by semicolons (;).\n");
             printf("- When executing from files, multiple commands can be entered at once, separated by line breaks or semicolons (;).\n");
-            printf("  - NOTE: Bash script files WILL NOT run lopesShell-specific commands!\n");
+            printf("  - Script files can use every lopesShell command, including the VMM commands.\n");
             break;
         case HELP_QUIT:
             // Help information for the quit command.
@@ -80,6 +221,10 @@ void showHelp(char** arguments) {
             printf("Syntax: `%s`\n", CMD_QUIT);
             printf("- No arguments required.\n");
             break;
+        case HELP_SUMMARY:
+            // Commands without a dedicated page show their registry summary.
+            printf("%s: %s\n", entry->name, entry->summary);
+            break;
         case HELP_ERROR:
             // Display error message for invalid command name in help request.
             printf("Error! Invalid command name.\n");
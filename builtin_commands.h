@@ -1,4 +1,23 @@
 #pragma once
+#include "command_parser.h"
+#include <stddef.h>
 
-int checkAdditionalCommands(char** arguments);
+// Handler invoked with the full argument vector of a built-in command.
+typedef void (*BuiltinHandler)(char** arguments);
+
+// Handler for a built-in command that takes over the commands after it on the same line.
+typedef void (*RestOfLineHandler)(char** arguments, Command* following, size_t numFollowing);
+
+// One entry in the built-in command registry.
+typedef struct {
+    const char *name;           // Command name as typed at the prompt.
+    BuiltinHandler handler;     // Function that executes the command.
+    RestOfLineHandler restOfLine; // If set, used instead of handler to run the command
+                                  // together with the rest of its line (e.g. parallel).
+    int helpPage;               // Detailed page shown by `help name`, or HELP_ERROR if none.
+    const char *summary;        // One-line description for the default help page.
+} BuiltinCommand;
+
+void initializeBuiltins();
+const BuiltinCommand* findBuiltin(const char* name);
 void showHelp(char** arguments);
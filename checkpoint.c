@@ -0,0 +1,308 @@
+#include "checkpoint.h"
+#include "vmm.h"
+#include "frame_manager.h"
+#include "process_registry.h"
+#include "scheduler.h"
+#include "swap.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Sections start at multiples of this offset, so the data of every section is aligned for
+// the arrays it holds when the image is mapped.
+#define IMAGE_ALIGNMENT 16
+#define IMAGE_WRITE_BUFFER (1024 * 1024)
+
+// Each section starts with its kind and the length of its data.
+typedef struct {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t length;
+} SectionHeader;
+
+// A process as saved in an image, followed by its page table.
+typedef struct {
+    uint32_t pid;
+    int32_t state;
+    int32_t burst_time;
+    uint32_t reserved;
+    uint64_t memory_requirement;
+    MemoryStats stats;
+} SavedProcess;
+
+// The image processes are being written to. forEachProcess passes no context.
+static ImageWriter *process_image;
+
+// The image loaded into the shell. Page tables borrow its memory, so it is never unmapped.
+static void *loaded_image;
+
+// Appends bytes to the image.
+void writeImageData(ImageWriter *writer, const void *data, uint64_t length) {
+    if (length > 0 && !writer->failed && fwrite(data, 1, length, writer->file) != length) {
+        writer->failed = true;
+    }
+    writer->offset += length;
+}
+
+// Starts a section of length bytes.
+void beginImageSection(ImageWriter *writer, ImageSection tag, uint64_t length) {
+    SectionHeader header = { tag, 0, length };
+    writeImageData(writer, &header, sizeof(header));
+    writer->section_end = writer->offset + length;
+}
+
+// Ends a section, padding it to the alignment of the next one.
+void endImageSection(ImageWriter *writer) {
+    static const unsigned char padding[IMAGE_ALIGNMENT];
+    if (writer->offset != writer->section_end) {
+        writer->failed = true;
+    }
+    writeImageData(writer, padding, (IMAGE_ALIGNMENT - writer->offset % IMAGE_ALIGNMENT) % IMAGE_ALIGNMENT);
+}
+
+// Writes a whole section.
+void writeImageSection(ImageWriter *writer, ImageSection tag, const void *data, uint64_t length) {
+    beginImageSection(writer, tag, length);
+    writeImageData(writer, data, length);
+    endImageSection(writer);
+}
+
+// Returns the data of the next section, or NULL if it is not a section of the given kind
+// and length.
+void* readImageSection(ImageReader *reader, ImageSection tag, uint64_t length) {
+    SectionHeader header;
+    if (reader->size - reader->offset < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, reader->data + reader->offset, sizeof(header));
+    uint64_t start = reader->offset + sizeof(header);
+    if (header.tag != tag || header.length != length || reader->size - start < length) {
+        return NULL;
+    }
+    uint64_t end = start + length;
+    reader->offset = end + (IMAGE_ALIGNMENT - end % IMAGE_ALIGNMENT) % IMAGE_ALIGNMENT;
+    if (reader->offset > reader->size) {
+        reader->offset = reader->size;
+    }
+    return reader->data + start;
+}
+
+// Returns the time elapsed since start, in milliseconds.
+static double millisecondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) * 1e3 + (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Writes one process and its page table.
+static void saveProcess(PCB *pcb) {
+    SavedProcess saved = { pcb->pid, pcb->process.state, pcb->process.burst_time, 0, pcb->memory_requirement, pcb->stats };
+    writeImageSection(process_image, SECTION_PROCESS, &saved, sizeof(saved));
+    savePageTable(process_image, &pcb->page_table);
+}
+
+// Writes the whole image to an open file.
+static void saveImage(ImageWriter *writer) {
+    const MemoryGeometry *geometry = memoryGeometry();
+    CheckpointHeader header = { CHECKPOINT_MAGIC, CHECKPOINT_VERSION, sizeof(CheckpointHeader), 0, geometry->page_size,
+                                geometry->physical_memory, geometry->address_bits, geometry->huge_pages,
+                                replacementPolicyType(), pageTableLayout(), processCount() };
+    writeImageData(writer, &header, sizeof(header));
+
+    saveSwap(writer);
+    process_image = writer;
+    forEachProcess(saveProcess);
+    process_image = NULL;
+    saveFrameManager(writer);
+    save_scheduler(writer);
+    writeImageSection(writer, SECTION_END, NULL, 0);
+
+    // The size is known once everything else is written.
+    header.image_size = writer->offset;
+    if (!writer->failed && (fflush(writer->file) != 0 || fseek(writer->file, 0, SEEK_SET) != 0 ||
+                            fwrite(&header, sizeof(header), 1, writer->file) != 1 || fflush(writer->file) != 0 ||
+                            fsync(fileno(writer->file)) != 0)) {
+        writer->failed = true;
+    }
+}
+
+// save <file>
+// The image is written next to the file and renamed over it once complete, so an image the
+// shell has loaded, and still maps, is never changed in place.
+void executeSave(char** arguments) {
+    if (arguments[1] == NULL || arguments[2] != NULL) {
+        printf("Usage: save <file>\n");
+        return;
+    }
+    size_t path_length = strlen(arguments[1]);
+    char *temporary_path = (char *)malloc(path_length + 5);
+    if (!temporary_path) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(temporary_path, path_length + 5, "%s.tmp", arguments[1]);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ImageWriter writer = { fopen(temporary_path, "wb"), 0, 0, false };
+    if (!writer.file) {
+        printf("save: %s: %s\n", temporary_path, strerror(errno));
+        free(temporary_path);
+        return;
+    }
+    char *buffer = (char *)malloc(IMAGE_WRITE_BUFFER);
+    if (!buffer) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    setvbuf(writer.file, buffer, _IOFBF, IMAGE_WRITE_BUFFER);
+
+    saveImage(&writer);
+    int error = writer.failed ? errno : 0;
+    if (fclose(writer.file) != 0 && !writer.failed) {
+        writer.failed = true;
+        error = errno;
+    }
+    free(buffer);
+    if (!writer.failed && rename(temporary_path, arguments[1]) != 0) {
+        writer.failed = true;
+        error = errno;
+    }
+    if (writer.failed) {
+        printf("save: %s: %s\n", arguments[1], error ? strerror(error) : "write failed");
+        unlink(temporary_path);
+    } else {
+        printf("Saved %zu processes and %u frames in use to %s (%llu bytes) in %.1f ms\n", processCount(), framesInUse(),
+               arguments[1], (unsigned long long)writer.offset, millisecondsSince(&start));
+    }
+    free(temporary_path);
+}
+
+// Maps an image and checks its header. Returns NULL after reporting the problem.
+static unsigned char* mapImage(const char *path, CheckpointHeader *header, uint64_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        printf("load: %s: %s\n", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    *size = (uint64_t)info.st_size;
+    if (*size < sizeof(CheckpointHeader)) {
+        printf("load: %s: not a VMM image\n", path);
+        close(fd);
+        return NULL;
+    }
+    // Private and writable: pages of the image that the shell changes are copied on write.
+    unsigned char *data = (unsigned char *)mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("load: %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    memcpy(header, data, sizeof(CheckpointHeader));
+    const char *problem = NULL;
+    MemoryGeometry geometry = { .page_size = header->page_size, .physical_memory = header->physical_memory,
+                                .address_bits = header->address_bits };
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        problem = "not a VMM image";
+    } else if (header->version != CHECKPOINT_VERSION || header->header_size != sizeof(CheckpointHeader)) {
+        problem = "unsupported image version";
+    } else if (header->image_size != *size) {
+        problem = "the image is truncated";
+    } else if ((problem = validateMemoryGeometry(&geometry)) != NULL) {
+        // The geometry's own description says whether it is damaged or too large for this machine.
+    } else if (header->policy > POLICY_ARC || header->layout > PAGE_TABLE_HASHED ||
+               (header->huge_pages && header->layout != PAGE_TABLE_RADIX) || header->num_processes > *size / sizeof(SavedProcess)) {
+        problem = "the image is damaged";
+    }
+    if (problem) {
+        printf("load: %s: %s\n", path, problem);
+        munmap(data, *size);
+        return NULL;
+    }
+    return data;
+}
+
+// Looks a process up for the scheduler.
+static Process* findQueuedProcess(int process_id) {
+    PCB *pcb = process_id >= 0 ? findProcess((unsigned int)process_id) : NULL;
+    return pcb ? &pcb->process : NULL;
+}
+
+// Restores the processes, the frame table and the scheduler queue. Returns false if the
+// image does not hold them.
+static bool loadImage(ImageReader *reader, uint64_t num_processes) {
+    for (uint64_t i = 0; i < num_processes; i++) {
+        const SavedProcess *saved = (const SavedProcess *)readImageSection(reader, SECTION_PROCESS, sizeof(SavedProcess));
+        PCB *pcb = saved ? registerProcess(saved->pid) : NULL;
+        if (!pcb || saved->state < READY || saved->state > TERMINATED) {
+            return false;
+        }
+        pcb->memory_requirement = saved->memory_requirement;
+        pcb->process.state = (ProcessState)saved->state;
+        pcb->process.burst_time = saved->burst_time;
+        pcb->stats = saved->stats;
+        pthread_rwlock_init(&pcb->table_lock, NULL);
+        if (!loadPageTable(reader, &pcb->page_table)) {
+            return false;
+        }
+    }
+    return loadFrameManager(reader) && load_scheduler(reader, findQueuedProcess) &&
+           readImageSection(reader, SECTION_END, 0) != NULL && reader->offset == reader->size;
+}
+
+// load <file>
+// Restores a saved image into a shell that has no processes and no swap yet, replacing the
+// geometry, replacement policy and page table layout it was started with. Flat and hashed
+// page tables are used where they lie in the mapped image, so only the pages of the image
+// that are touched are ever read.
+void executeLoad(char** arguments) {
+    if (arguments[1] == NULL || arguments[2] != NULL) {
+        printf("Usage: load <file>\n");
+        return;
+    }
+    if (processCount() > 0 || swapEnabled() || loaded_image) {
+        printf("load: the shell already has processes or swap; images are loaded into a fresh shell\n");
+        return;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CheckpointHeader header;
+    uint64_t size;
+    unsigned char *data = mapImage(arguments[1], &header, &size);
+    if (!data) {
+        return;
+    }
+    ImageReader reader = { data, size, sizeof(CheckpointHeader) };
+    const char *problem = loadSwap(&reader, header.page_size);
+    if (problem) {
+        printf("load: %s: %s\n", arguments[1], problem);
+        munmap(data, size);
+        return;
+    }
+
+    MemoryGeometry geometry = { .page_size = header.page_size, .physical_memory = header.physical_memory,
+                                .address_bits = header.address_bits, .huge_pages = header.huge_pages != 0 };
+    validateMemoryGeometry(&geometry);
+    cleanupFrameManager();
+    initializeVMM(&geometry, (ReplacementPolicyType)header.policy, (PageTableLayout)header.layout);
+    loaded_image = data;
+    // The shell's state is now partly replaced and cannot be rolled back.
+    if (!loadImage(&reader, header.num_processes)) {
+        fprintf(stderr, "load: %s: the image is damaged; the shell's state is incomplete\n", arguments[1]);
+        exit(EXIT_FAILURE);
+    }
+    printf("Loaded %zu processes and %u frames in use from %s in %.1f ms\n", processCount(), framesInUse(), arguments[1],
+           millisecondsSince(&start));
+}
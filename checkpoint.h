@@ -0,0 +1,70 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Images start with this header, followed by tagged sections. They hold no pointers:
+// processes are named by pid and radix tables by their index in the image, so an image can
+// be mapped anywhere and its page tables used in place.
+#define CHECKPOINT_MAGIC "LSVMIMG"
+#define CHECKPOINT_VERSION 3
+
+typedef struct {
+    char magic[8];                  // "LSVMIMG\0"
+    uint32_t version;
+    uint32_t header_size;           // sizeof(CheckpointHeader)
+    uint64_t image_size;            // Bytes in the whole image.
+    uint64_t page_size;             // Geometry and settings of the VMM that saved the image.
+    uint64_t physical_memory;
+    uint32_t address_bits;
+    uint32_t huge_pages;
+    uint32_t policy;                // ReplacementPolicyType
+    uint32_t layout;                // PageTableLayout
+    uint64_t num_processes;
+} CheckpointHeader;
+
+// Kinds of section, in the order they appear: the swap device, then each process followed
+// by its page table, the frame table, the replacement policy and the scheduler queue.
+typedef enum {
+    SECTION_SWAP = 1,
+    SECTION_PROCESS,
+    SECTION_PAGE_TABLE,
+    SECTION_FRAMES,
+    SECTION_REPLACEMENT_POLICY,
+    SECTION_SCHEDULER,
+    SECTION_END
+} ImageSection;
+
+// An image being written. Write errors are remembered and reported when it is finished.
+typedef struct {
+    FILE *file;
+    uint64_t offset;                // Bytes written so far.
+    uint64_t section_end;           // Offset where the current section's data must end.
+    bool failed;
+} ImageWriter;
+
+// An image mapped for reading. Sections are read in the order they were written.
+typedef struct {
+    unsigned char *data;
+    uint64_t size;
+    uint64_t offset;
+} ImageReader;
+
+// Writes a section of length bytes, all at once or with writeImageData calls between
+// beginImageSection and endImageSection.
+void writeImageSection(ImageWriter *writer, ImageSection tag, const void *data, uint64_t length);
+void beginImageSection(ImageWriter *writer, ImageSection tag, uint64_t length);
+void writeImageData(ImageWriter *writer, const void *data, uint64_t length);
+void endImageSection(ImageWriter *writer);
+
+// Returns the data of the next section, or NULL if it is not a section of the given kind
+// and length. The data stays mapped, privately and writable, for the life of the shell.
+void* readImageSection(ImageReader *reader, ImageSection tag, uint64_t length);
+
+// save and load builtins.
+void executeSave(char** arguments);
+void executeLoad(char** arguments);
+
+#endif // CHECKPOINT_H
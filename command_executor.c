@@ -1,205 +1,627 @@
+#define _GNU_SOURCE
 #include "command_executor.h"
 #include "utilities.h"
+#include "append_cache.h"
 #include "constants.h"
-#include "vmm.h" // Include the VMM header
+#include "pipe_io.h"
+#include "pipeline.h"
+#include "process_spawn.h"
+#include "random_text.h"
+#include "file_operations.h"
+#include "file_search.h"
+#include "process_registry.h"
+#include "frame_manager.h"
 
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
-// VMM commands
-#define CMD_CREATE_PROCESS "createproc"
-#define CMD_ALLOCATE_MEMORY "allocmem"
-#define CMD_ACCESS_MEMORY "accessmem"
-#define CMD_FREE_MEMORY "freemem"
-
-//Modified commands
-#define CMD_DELETE_DIR_EMPTY "rmdir"
-#define CMD_CHANGE_DIR "cd"
-#define CMD_WRITE_LINE "writeline"
-#define CMD_RANDOM_WRITE "randomtxt"
-
-// Utility function to check if the command is a VMM command
-int isVMMCommand(const char *command) {
-    return strcmp(command, CMD_CREATE_PROCESS) == 0 ||
-           strcmp(command, CMD_ALLOCATE_MEMORY) == 0 ||
-           strcmp(command, CMD_ACCESS_MEMORY) == 0 ||
-           strcmp(command, CMD_FREE_MEMORY) == 0;
-}
-
-// Function to execute VMM commands
-void executeVMMCommand(char **arguments) {
-    if (strcmp(arguments[0], CMD_CREATE_PROCESS) == 0) {
-        if (arguments[1] == NULL || arguments[2] == NULL) {
-            printf("Usage: %s <pid> <memory_size>\n", CMD_CREATE_PROCESS);
-            return;
-        }
-        unsigned int pid = (unsigned int)atoi(arguments[1]);
-        size_t memory_size = (size_t)atoi(arguments[2]);
-        PCB pcb;
-        createProcess(&pcb, pid, memory_size);
-    } else if (strcmp(arguments[0], CMD_ALLOCATE_MEMORY) == 0) {
-        // Handle memory allocation command
-        // Add the logic for allocating memory to a process
-    } else if (strcmp(arguments[0], CMD_ACCESS_MEMORY) == 0) {
-        // Handle memory access command
-        // Add the logic for accessing a process's memory
-    } else if (strcmp(arguments[0], CMD_FREE_MEMORY) == 0) {
-        // Handle memory free command
-        // Add the logic for freeing a process's memory
-    } else {
-        printf("Unknown VMM command.\n");
+#define DEFAULT_BURST_TIME 10 // Scheduler ticks given to processes created without a burst time.
+#define MAX_PROCESS_ID INT32_MAX // Largest pid; the scheduler keeps pids as int.
+
+// Parses an unsigned number (decimal, or hex with 0x). Returns false if the text is not one.
+static bool parseNumber(const char* text, uint64_t* value) {
+    char *end;
+    if (text == NULL || *text == '-') {
+        return false;
+    }
+    *value = strtoull(text, &end, 0);
+    return end != text && *end == '\0';
+}
+
+// Looks up the simulated process named by a pid argument, reporting unknown pids.
+static PCB* processArgument(const char* argument) {
+    uint64_t pid;
+    if (!parseNumber(argument, &pid) || pid > MAX_PROCESS_ID) {
+        printf("Invalid process ID: %s\n", argument);
+        return NULL;
     }
+    PCB *pcb = findProcess((unsigned int)pid);
+    if (pcb == NULL) {
+        printf("Process %u not found.\n", (unsigned int)pid);
+    }
+    return pcb;
 }
 
-int isModifiedCommand(const char *command) {
-    return strcmp(command, CMD_DELETE_DIR_EMPTY) == 0 ||
-           strcmp(command, CMD_CHANGE_DIR) == 0 ||
-           strcmp(command, CMD_WRITE_LINE) == 0 ||
-           strcmp(command, CMD_RANDOM_WRITE) == 0;
+// Handle process creation command: createproc <pid> <memory_size> [burst_time]
+// The process is registered, given its memory and queued with the scheduler.
+void executeCreateProcess(char **arguments) {
+    uint64_t pid, memorySize, burstTime = DEFAULT_BURST_TIME;
+    if (arguments[1] == NULL || arguments[2] == NULL || !parseNumber(arguments[1], &pid) || pid > MAX_PROCESS_ID ||
+        !parseSize(arguments[2], &memorySize) || (arguments[3] != NULL && (!parseNumber(arguments[3], &burstTime) || burstTime > INT32_MAX))) {
+        printf("Usage: %s <pid> <memory_size> [burst_time]\n", CMD_CREATE_PROCESS);
+        return;
+    }
+
+    PCB *pcb = registerProcess((unsigned int)pid);
+    if (pcb == NULL) {
+        printf("Process %u already exists.\n", (unsigned int)pid);
+        return;
+    }
+    createProcess(pcb, (unsigned int)pid, memorySize);
+    pcb->process.state = READY;
+    pcb->process.burst_time = (int)burstTime;
+    if (!add_process(&pcb->process)) {
+        printf("Failed to add process: %u\n", (unsigned int)pid);
+    }
+}
+
+// Handle memory allocation command: allocmem <pid> <size>
+void executeAllocateMemory(char **arguments) {
+    uint64_t size;
+    if (arguments[1] == NULL || arguments[2] == NULL || !parseSize(arguments[2], &size)) {
+        printf("Usage: %s <pid> <size>\n", CMD_ALLOCATE_MEMORY);
+        return;
+    }
+    PCB *pcb = processArgument(arguments[1]);
+    if (pcb != NULL) {
+        allocateMemory(pcb, size);
+    }
 }
 
-// Execute modified UNIX command. Modified terminal commands share similar functionality/syntax to their UNIX counterparts, but cannot be executed directly from
+// Handle memory access command: accessmem <pid> <virtual_address> [r|w]
+void executeAccessMemory(char **arguments) {
+    uint64_t address;
+    if (arguments[1] == NULL || !parseNumber(arguments[2], &address) || address >= memoryGeometry()->max_virtual_memory ||
+        (arguments[3] != NULL && strcmp(arguments[3], "r") != 0 && strcmp(arguments[3], "w") != 0)) {
+        printf("Usage: %s <pid> <virtual_address> [r|w]\n", CMD_ACCESS_MEMORY);
+        return;
+    }
+    PCB *pcb = processArgument(arguments[1]);
+    if (pcb != NULL) {
+        accessMemory(pcb, address, arguments[3] != NULL && arguments[3][0] == 'w');
+    }
+}
+
+// Handle memory free command: freemem <pid> <size>
+void executeFreeMemory(char **arguments) {
+    uint64_t size;
+    if (arguments[1] == NULL || arguments[2] == NULL || !parseSize(arguments[2], &size)) {
+        printf("Usage: %s <pid> <size>\n", CMD_FREE_MEMORY);
+        return;
+    }
+    PCB *pcb = processArgument(arguments[1]);
+    if (pcb != NULL) {
+        freeMemory(pcb, size);
+    }
+}
+
+// Handle process fork command: forkproc <parent_pid> <child_pid>
+// The child gets the parent's address space, shared copy-on-write, and its burst time.
+void executeForkProcess(char **arguments) {
+    uint64_t childPid;
+    if (arguments[1] == NULL || arguments[2] == NULL || !parseNumber(arguments[2], &childPid) || childPid > MAX_PROCESS_ID) {
+        printf("Usage: %s <parent_pid> <child_pid>\n", CMD_FORK_PROCESS);
+        return;
+    }
+    PCB *parent = processArgument(arguments[1]);
+    if (parent == NULL) {
+        return;
+    }
+    PCB *child = registerProcess((unsigned int)childPid);
+    if (child == NULL) {
+        printf("Process %u already exists.\n", (unsigned int)childPid);
+        return;
+    }
+
+    forkProcess(parent, child, (unsigned int)childPid);
+    child->process.state = READY;
+    child->process.burst_time = parent->process.burst_time;
+    if (!add_process(&child->process)) {
+        printf("Failed to add process: %u\n", child->pid);
+    }
+}
+
+// Prints one line of memory counters.
+static void printMemoryStats(const char* label, const MemoryStats* stats) {
+    uint64_t accesses = stats->hits + stats->faults;
+    printf("%s: %llu accesses, %llu hits, %llu faults (%.2f%% hit rate), %llu evictions, %llu write-backs\n", label,
+           (unsigned long long)accesses, (unsigned long long)stats->hits, (unsigned long long)stats->faults,
+           accesses ? 100.0 * (double)stats->hits / (double)accesses : 0.0,
+           (unsigned long long)stats->evictions, (unsigned long long)stats->writebacks);
+    if (stats->huge_faults > 0) {
+        printf("  %llu faults loaded a huge page\n", (unsigned long long)stats->huge_faults);
+    }
+    if (stats->cow_copies > 0) {
+        printf("  %llu frames copied on write to shared pages\n", (unsigned long long)stats->cow_copies);
+    }
+    if (stats->swap_ins > 0 || stats->swap_outs > 0) {
+        printf("  %llu pages read from swap, %llu written to swap\n", (unsigned long long)stats->swap_ins,
+               (unsigned long long)stats->swap_outs);
+    }
+}
+
+// Prints the counters of one process.
+static void printProcessStats(PCB* pcb) {
+    char label[32];
+    snprintf(label, sizeof(label), "Process %u", pcb->pid);
+    printMemoryStats(label, &pcb->stats);
+
+    const PageTable *table = &pcb->page_table;
+    printf("  %s page table: %llu pages, %llu bytes of table, %llu huge mappings, %llu walks (%.2f steps per walk)\n",
+           pageTableLayoutName(table->layout), (unsigned long long)table->num_pages, (unsigned long long)table->table_bytes,
+           (unsigned long long)table->huge_mappings, (unsigned long long)table->walks,
+           table->walks ? (double)table->walk_steps / (double)table->walks : 0.0);
+}
+
+// Handle memory statistics command: vmmstats [pid|all]
+void executeVMMStats(char **arguments) {
+    if (arguments[1] != NULL && strcmp(arguments[1], "all") != 0) {
+        PCB *pcb = processArgument(arguments[1]);
+        if (pcb != NULL) {
+            printProcessStats(pcb);
+        }
+        return;
+    }
+
+    const MemoryGeometry *geometry = memoryGeometry();
+    printf("Replacement policy: %s, %u of %u frames in use, %zu processes\n", replacementPolicyName(),
+           framesInUse(), totalFrames(), processCount());
+    printf("Geometry: %llu-byte pages, %llu bytes of physical memory, %u-bit virtual addresses, huge pages %s\n",
+           (unsigned long long)geometry->page_size, (unsigned long long)geometry->physical_memory, geometry->address_bits,
+           geometry->huge_pages ? "on" : "off");
+    printMemoryStats("Total", memoryTotals());
+    const CowStats *cow = cowTotals();
+    if (cow->forks > 0) {
+        printf("Copy-on-write: %llu forks shared %llu frames, %llu copied on write, %llu saved, %llu references to shared frames\n",
+               (unsigned long long)cow->forks, (unsigned long long)cow->frames_shared, (unsigned long long)cow->frames_copied,
+               (unsigned long long)(cow->frames_shared - cow->frames_copied), (unsigned long long)cow->shared_references);
+    }
+    if (swapEnabled()) {
+        printSwapStats();
+    }
+    if (arguments[1] != NULL) {
+        forEachProcess(printProcessStats);
+    }
+}
+
+// Modified UNIX commands. Modified terminal commands share similar functionality/syntax to their UNIX counterparts, but cannot be executed directly from
 // an exec system call or may be otherwise confusing for inexperienced users.
-void executeModifiedCommand(char **arguments)
+
+// rmdir [dir_name]
+void executeRemoveDirectory(char **arguments)
 {
-    
-    if (strcmp(arguments[0], CMD_DELETE_DIR_EMPTY) == 0) //rmdir -r [dir_name]
+    int errorState = rmdir(arguments[1]);
+    //printf("%d\n",errno);
+
+    if (errorState != 0) //File does not exist
     {
-        int errorState = rmdir(arguments[1]);
-        //printf("%d\n",errno);
+        printf("rmdir: ");
+        if (errno == 14) //file not found
+        {
+            printf("Directory not found! Please review the syntax: `rmdir [dir_name]`\n");
+        }
+        else if (errno == 20) //attempted non-empty directory deletion
+        {
+            printf("File is not a directory!\n");
+        }
+        else if (errno == 39) //attempted non-empty directory deletion
+        {
+            printf("Directory not empty! To delete non-empty directories, use `rm -r [dir_name]`\n");
+        }
+        else
+        {
+            printf("An unknown error occurred.\n");
+        }
+    }
+}
 
-        if (errorState != 0) //File does not exist
+// cd [path]
+void executeChangeDirectory(char **arguments)
+{
+    int errorState = chdir(arguments[1]);
+    //printf("%d\n",errno);
+    if (errorState != 0) //File does not exist
+    {
+        printf("cd: ");
+        if (errno == 14) //directory not found
         {
-            printf("rmdir: ");
-            if (errno == 14) //file not found
-            {
-                printf("Directory not found! Please review the syntax: `rmdir [dir_name]`\n");
-            }
-            else if (errno == 20) //attempted non-empty directory deletion
-            {
-                printf("File is not a directory!\n");
-            }
-            else if (errno == 39) //attempted non-empty directory deletion
-            {
-                printf("Directory not empty! To delete non-empty directories, use `rm -r [dir_name]`\n");
-            }
-            else
-            {
-                printf("An unknown error occurred.\n");
-            }
+            printf("Directory not found! Please review the syntax: `cd [dir_name]`\n");
+        }
+        else if (errno == 20) //attempted non-empty directory deletion
+        {
+            printf("File is not a directory!\n");
+        }
+        else
+        {
+            printf("rmdir: An unknown error occurred.\n");
         }
     }
-    else if (strcmp(arguments[0], CMD_CHANGE_DIR) == 0) //rm -r [dir_name]
+}
+
+// Checks the options of a modified command. Options may appear anywhere among the operands
+// (as in `cp [src] [dst] -r`) and may be combined (`-rf`). Returns a bit per option letter,
+// with -R treated as -r, or -1 if an option outside allowed is present; such commands are
+// left to the system's own tools. On success the operands are moved to the front of
+// arguments[1..] and their count is stored in numOperands.
+static long parseModifiedOptions(char **arguments, const char* allowed, int* numOperands)
+{
+    long options = 0;
+    for (int i = 1; arguments[i] != NULL; i++)
     {
-        int errorState = chdir(arguments[1]);
-        //printf("%d\n",errno);
-        if (errorState != 0) //File does not exist
+        if (arguments[i][0] != '-' || arguments[i][1] == '\0')
         {
-            printf("cd: ");
-            if (errno == 14) //directory not found
-            {
-                printf("Directory not found! Please review the syntax: `cd [dir_name]`\n");
-            }
-            else if (errno == 20) //attempted non-empty directory deletion
-            {
-                printf("File is not a directory!\n");
-            }
-            else
+            continue;
+        }
+        for (const char *c = arguments[i] + 1; *c != '\0'; c++)
+        {
+            char option = *c == 'R' ? 'r' : *c;
+            if (option < 'a' || option > 'z' || strchr(allowed, option) == NULL)
             {
-                printf("rmdir: An unknown error occurred.\n");
+                return -1;
             }
+            options |= 1L << (option - 'a');
         }
     }
-    else if (strcmp(arguments[0], CMD_WRITE_LINE) == 0)
+
+    *numOperands = 0;
+    for (int i = 1; arguments[i] != NULL; i++)
     {
-        FILE* writeFile = fopen(arguments[1],"a");
-        for (int i = 2; arguments[i] != NULL; i++)
+        if (arguments[i][0] != '-' || arguments[i][1] == '\0')
         {
-            //printf("%s\n", arguments[i]);
-            fprintf(writeFile, "%s\n", arguments[i]);
+            arguments[1 + (*numOperands)++] = arguments[i];
         }
-        fclose(writeFile);
     }
-    else if (strcmp(arguments[0], CMD_RANDOM_WRITE) == 0)
+    arguments[1 + *numOperands] = NULL;
+    return options;
+}
+
+#define HAS_OPTION(options, letter) (((options) >> ((letter) - 'a')) & 1)
+
+// Returns true if path names a directory (following symbolic links).
+static bool isDirectory(const char* path)
+{
+    struct stat info;
+    return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Returns the path of source's last component inside directory. The result must be freed.
+static char* pathInside(const char* directory, const char* source)
+{
+    size_t length = strlen(source);
+    while (length > 1 && source[length - 1] == '/')
+    {
+        length--;
+    }
+    size_t start = length;
+    while (start > 0 && source[start - 1] != '/')
+    {
+        start--;
+    }
+
+    char *path;
+    if (asprintf(&path, "%s/%.*s", directory, (int)(length - start), source + start) < 0)
+    {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return path;
+}
+
+// Shared body of cp (isCopy) and mv: each source goes to target, or into target if it is a
+// directory. Only cp accepts -r.
+static void transferPaths(char **arguments, const char* command, bool isCopy)
+{
+    int numOperands = 0;
+    long options = parseModifiedOptions(arguments, isCopy ? "r" : "", &numOperands);
+    if (options < 0)
+    {
+        createCommandProcess(arguments);
+        return;
+    }
+    if (numOperands < 2)
+    {
+        printf("Usage: %s [source] ... [destination]%s\n", command, isCopy ? " [-r]" : "");
+        return;
+    }
+
+    const char *target = arguments[numOperands];
+    bool targetIsDirectory = isDirectory(target);
+    if (numOperands > 2 && !targetIsDirectory)
+    {
+        printf("%s: target '%s' is not a directory\n", command, target);
+        return;
+    }
+    for (int i = 1; i < numOperands; i++)
     {
-        int numBytes = atoi(arguments[2]);
-        char *data = malloc(sizeof(char) * (numBytes));
-        for (int i = 0; i < numBytes; i++)
+        char *destination = targetIsDirectory ? pathInside(target, arguments[i]) : NULL;
+        if (isCopy)
+        {
+            copyPath(arguments[i], destination ? destination : target, HAS_OPTION(options, 'r'));
+        }
+        else
         {
-            data[i] = (random() % 256);
-            printf("%s\n",data);
+            movePath(arguments[i], destination ? destination : target);
         }
-        printf("Checkpoint!\n");
-        FILE* writeFile = fopen(arguments[1],"a");
-        fprintf(writeFile, "%s", data);
-        fclose(writeFile);
+        free(destination);
     }
 }
 
-// Function to create a process and execute a command
-void createCommandProcess(char **arguments) {
-    if (isVMMCommand(arguments[0])) {
-        executeVMMCommand(arguments);
-    } else if (isModifiedCommand(arguments[0])) {
-        printf("Modified command executed!\n");
-        executeModifiedCommand(arguments);
-    } else {
-        pid_t processID = fork();
-        if (processID > 0) {
-            int status = 0;
-            waitpid(processID, &status, 0);
-        } else if (processID == 0) {
-            execvp(arguments[0], arguments);
-            _exit(EXIT_FAILURE); // If execvp fails.
-        } else {
-            perror("fork failed");
-            _exit(EXIT_FAILURE); // If fork fails.
-        }
-    }
-}
-
-// Function to create a process for executing a script file
-void createFileProcess(char **arguments, char *fileName) {
-    FILE *file = fopen(fileName, "r");
-    if (file) {
-        fclose(file);
-
-        pid_t processID = fork();
-        char **execArgv = prepareArguments(arguments);
-        if (processID > 0) {
-            // Parent process
-        } else if (processID == 0) {
-            execv("./file-handler", execArgv);
-            _exit(EXIT_FAILURE); // If execv fails.
-        } else {
-            perror("fork failed");
-            _exit(EXIT_FAILURE); // If fork fails.
-        }
-
-        int status;
-        waitpid(processID, &status, 0);
-    } else {
-        perror("argument file does not exist");
-        exit(EXIT_FAILURE);
+// cp [source] ... [destination] [-r]
+void executeCopy(char **arguments)
+{
+    transferPaths(arguments, CMD_COPY, true);
+}
+
+// mv [source] ... [destination]
+void executeMove(char **arguments)
+{
+    transferPaths(arguments, CMD_MOVE, false);
+}
+
+// rm [-r] [-f] [path] ...
+void executeRemove(char **arguments)
+{
+    int numOperands = 0;
+    long options = parseModifiedOptions(arguments, "rf", &numOperands);
+    if (options < 0)
+    {
+        createCommandProcess(arguments);
+        return;
+    }
+    if (numOperands == 0 && !HAS_OPTION(options, 'f'))
+    {
+        printf("Usage: %s [-r] [-f] [path] ...\n", CMD_REMOVE);
+        return;
+    }
+    for (int i = 1; i <= numOperands; i++)
+    {
+        const char *path = arguments[i];
+        const char *last = strrchr(path, '/');
+        last = last != NULL && last[1] != '\0' ? last + 1 : path;
+        if (strcmp(last, ".") == 0 || strcmp(last, "..") == 0 || strspn(path, "/") == strlen(path))
+        {
+            printf("%s: refusing to remove '%s'\n", CMD_REMOVE, path);
+            continue;
+        }
+        removePath(path, HAS_OPTION(options, 'r'), HAS_OPTION(options, 'f'));
+    }
+}
+
+// mkdir [-p] [dir_name] ...
+void executeMakeDirectory(char **arguments)
+{
+    int numOperands = 0;
+    long options = parseModifiedOptions(arguments, "p", &numOperands);
+    if (options < 0)
+    {
+        createCommandProcess(arguments);
+        return;
+    }
+    if (numOperands == 0)
+    {
+        printf("Usage: %s [-p] [dir_name] ...\n", CMD_MAKE_DIR);
+        return;
+    }
+    for (int i = 1; i <= numOperands; i++)
+    {
+        makeDirectory(arguments[i], HAS_OPTION(options, 'p'));
+    }
+}
+
+// touch [filename] ...
+void executeTouch(char **arguments)
+{
+    int numOperands = 0;
+    if (parseModifiedOptions(arguments, "", &numOperands) < 0)
+    {
+        createCommandProcess(arguments);
+        return;
+    }
+    if (numOperands == 0)
+    {
+        printf("Usage: %s [filename] ...\n", CMD_TOUCH);
+        return;
+    }
+    for (int i = 1; i <= numOperands; i++)
+    {
+        touchFile(arguments[i]);
+    }
+}
+
+// find [path] ... [-name pattern] [-type f|d|l]
+void executeFind(char **arguments)
+{
+    FindOptions options = { NULL, 0 };
+    int numPaths = 0;
+    while (arguments[1 + numPaths] != NULL && arguments[1 + numPaths][0] != '-')
+    {
+        numPaths++;
+    }
+    for (int i = 1 + numPaths; arguments[i] != NULL; i += 2)
+    {
+        if (strcmp(arguments[i], "-name") == 0 && arguments[i + 1] != NULL)
+        {
+            options.namePattern = arguments[i + 1];
+        }
+        else if (strcmp(arguments[i], "-type") == 0 && arguments[i + 1] != NULL &&
+                 strlen(arguments[i + 1]) == 1 && strchr("fdl", arguments[i + 1][0]) != NULL)
+        {
+            options.type = arguments[i + 1][0];
+        }
+        else
+        {
+            // Other expressions are left to the system's find.
+            createCommandProcess(arguments);
+            return;
+        }
+    }
+
+    if (numPaths == 0)
+    {
+        findFiles(".", &options);
+    }
+    for (int i = 1; i <= numPaths; i++)
+    {
+        findFiles(arguments[i], &options);
+    }
+}
+
+// du [-h] [-s] [directory] ...
+void executeDiskUsage(char **arguments)
+{
+    int numOperands = 0;
+    long flags = parseModifiedOptions(arguments, "hs", &numOperands);
+    if (flags < 0)
+    {
+        createCommandProcess(arguments);
+        return;
+    }
+
+    DiskUsageOptions options = { HAS_OPTION(flags, 'h'), HAS_OPTION(flags, 's') };
+    if (numOperands == 0)
+    {
+        diskUsage(".", &options);
+    }
+    for (int i = 1; i <= numOperands; i++)
+    {
+        diskUsage(arguments[i], &options);
+    }
+}
+
+// writeline [filename] [args] ...
+// writeline -g on [interval_ms] | off | flush
+// Each argument is appended to the file as its own line with a single writev on a descriptor
+// that stays open between calls. With -g on, lines are buffered and committed together when
+// the interval passes, when a file has 1 MiB pending, at the end of a script or on exit.
+// With no lines given as a pipeline stage reading the stage before it (e.g. `ls | writeline f`),
+// the piped data is appended to the file with splice instead.
+void executeWriteLine(char **arguments)
+{
+    if (arguments[1] == NULL)
+    {
+        printf("Usage: %s [filename] [args] ...\n", CMD_WRITE_LINE);
+        return;
+    }
+
+    if (strcmp(arguments[1], "-g") == 0)
+    {
+        if (arguments[2] != NULL && strcmp(arguments[2], "on") == 0)
+        {
+            setGroupCommit(true, arguments[3] != NULL ? atol(arguments[3]) : 0);
+        }
+        else if (arguments[2] != NULL && strcmp(arguments[2], "off") == 0)
+        {
+            setGroupCommit(false, 0);
+        }
+        else if (arguments[2] != NULL && strcmp(arguments[2], "flush") == 0)
+        {
+            flushAppendCache();
+        }
+        else
+        {
+            printf("Usage: %s -g on [interval_ms] | off | flush\n", CMD_WRITE_LINE);
+        }
+        return;
+    }
+
+    if (arguments[2] == NULL && builtinReadsPipeline() && isPipe(STDIN_FILENO))
+    {
+        flushAppendCache();
+        int fileFd = open(arguments[1], O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        if (fileFd < 0 || !spliceToFile(STDIN_FILENO, fileFd))
+        {
+            perror(CMD_WRITE_LINE);
+        }
+        if (fileFd >= 0)
+        {
+            close(fileFd);
+        }
+        return;
+    }
+
+    if (!appendLines(arguments[1], &arguments[2]))
+    {
+        perror(CMD_WRITE_LINE);
     }
 }
 
-// Function to prepare arguments for script file execution
-char **prepareArguments(char **arguments) {
-    int numArguments = 0;
-    for (numArguments = 0; arguments[numArguments] != NULL; numArguments++);
+// randomtxt [-p] [-s seed] [-t threads] [filename] [numChars]
+// Appends random bytes to a file (K/M/G suffixes are accepted for the size). -p limits the
+// output to printable characters, -s fixes the seed and -t sets the number of writer threads.
+// A filename of `-` writes to standard output, which is handed to a pipe with vmsplice.
+void executeRandomText(char **arguments)
+{
+    RandomTextOptions options = { randomSeed(), false, 0 };
+    int i = 1;
+    for (; arguments[i] != NULL && arguments[i][0] == '-' && arguments[i][1] != '\0'; i++)
+    {
+        if (strcmp(arguments[i], "-p") == 0)
+        {
+            options.printable = true;
+        }
+        else if (strcmp(arguments[i], "-s") == 0 && arguments[i + 1] != NULL)
+        {
+            options.seed = strtoull(arguments[++i], NULL, 0);
+        }
+        else if (strcmp(arguments[i], "-t") == 0 && arguments[i + 1] != NULL && atoi(arguments[i + 1]) > 0)
+        {
+            options.numThreads = (size_t)atoi(arguments[++i]);
+        }
+        else
+        {
+            break;
+        }
+    }
 
-    char **returnArgs = malloc(sizeof(char*) * (numArguments + 2)); // for the process name and null terminator
-    returnArgs[0] = "./file-handler"; // Hard-coded, but the first element of argv should be the name of the process
-    for (int i = 1; i <= numArguments; i++) {
-        returnArgs[i] = arguments[i-1];
+    uint64_t numBytes = 0;
+    if (arguments[i] == NULL || arguments[i + 1] == NULL || !parseSize(arguments[i + 1], &numBytes))
+    {
+        printf("Usage: %s [-p] [-s seed] [-t threads] [filename] [numChars]\n", CMD_RANDOM_WRITE);
+        return;
     }
-    returnArgs[numArguments + 1] = NULL; // null terminator
 
-    return returnArgs;
+    bool ok;
+    if (strcmp(arguments[i], "-") == 0)
+    {
+        fflush(stdout);
+        ok = streamRandomText(STDOUT_FILENO, numBytes, &options);
+    }
+    else
+    {
+        int fileFd = open(arguments[i], O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        ok = fileFd >= 0 && writeRandomText(fileFd, numBytes, &options);
+        if (fileFd >= 0)
+        {
+            close(fileFd);
+        }
+    }
+    if (!ok)
+    {
+        perror(CMD_RANDOM_WRITE);
+    }
 }
 
+// Function to create a process and execute a command
+void createCommandProcess(char **arguments) {
+    pid_t processID = spawnCommand(arguments, -1, -1, -1);
+    if (processID > 0) {
+        int status = 0;
+        waitpid(processID, &status, 0);
+    }
+}
@@ -2,5 +2,24 @@
 #include <errno.h>
 
 void createCommandProcess(char** arguments);
-void createFileProcess(char** arguments, char* fileName);
-char** prepareArguments(char** arguments);
+
+// VMM command handlers
+void executeCreateProcess(char** arguments);
+void executeAllocateMemory(char** arguments);
+void executeAccessMemory(char** arguments);
+void executeFreeMemory(char** arguments);
+void executeForkProcess(char** arguments);
+void executeVMMStats(char** arguments);
+
+// Modified UNIX command handlers
+void executeRemoveDirectory(char** arguments);
+void executeChangeDirectory(char** arguments);
+void executeWriteLine(char** arguments);
+void executeRandomText(char** arguments);
+void executeCopy(char** arguments);
+void executeMove(char** arguments);
+void executeRemove(char** arguments);
+void executeMakeDirectory(char** arguments);
+void executeTouch(char** arguments);
+void executeFind(char** arguments);
+void executeDiskUsage(char** arguments);
@@ -1,92 +1,135 @@
 #include "command_parser.h"
-#include "utilities.h"
-#include <string.h>
-#include <stdlib.h>
+#include <stdio.h>
 
-// Splits a string of commands separated by semicolons into an array of commands.
-char** splitCommands(char* commands) {
-    // Get the length of the commands string.
-    size_t commandsLength = strlen(commands);
-    if (commandsLength == 0) {
-        return NULL; // Return NULL for empty command strings.
-    }
-
-    char *delim = ";"; // Delimiter for splitting commands.
-    char *commands_copy = copyString(commands); // Make a copy of the commands to avoid modifying the original string.
+#define INITIAL_TOKEN_CAPACITY 16
 
-    // Count the number of commands separated by the delimiter.
-    int numTokens = 0;
-    char *token = strtok(commands, delim);
-    while (token != NULL) {
-        numTokens++;
-        token = strtok(NULL, delim);
-    }
-    numTokens++;
-    // Allocate memory for the array of command strings.
-    char **argumentsV = malloc(sizeof(char *) * (numTokens + 1));
+// Placed in the token storage after the last stage of each command.
+static char commandEnd;
+static char backgroundCommandEnd;
+#define COMMAND_END (&commandEnd)
+#define BACKGROUND_COMMAND_END (&backgroundCommandEnd)
 
-    // Split the copied commands string into individual commands.
-    token = strtok(commands_copy, delim);
-    int i = 0;
-    for (i = 0; token != NULL; i++) {
-        argumentsV[i] = malloc(sizeof(char) * (strlen(token) + 1));
-        strcpy(argumentsV[i], token); // Copy each command into the array.
-        token = strtok(NULL, delim);
-    }
-    argumentsV[i] = NULL; // Null-terminate the array of commands.
-    
-    free(commands_copy); // Free the copied commands string.
-
-    return argumentsV; // Return the array of commands.
+// Returns true for characters that separate the arguments of a single command.
+static inline bool isArgumentDelimiter(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-// Parses a list of commands into a list of argument vectors.
-char*** parseCommandList(char** commandList) {
-    // Count the number of commands in the command list.
-    int numCommands = 0;
-    for (numCommands = 0; commandList[numCommands] != NULL; numCommands++);
+// Returns true for characters that end an argument and have a meaning of their own.
+static inline bool isOperator(char c) {
+    return c == ';' || c == '|' || c == '&';
+}
 
-    if (numCommands == 0) {
-        return NULL; // Return NULL for empty command lists.
-    }
+// Reports a malformed line and leaves the command list empty so callers run nothing.
+static int syntaxError(CommandList* commandList, const char* token) {
+    fprintf(stderr, "syntax error near unexpected token `%s'\n", token);
+    commandList->numCommands = 0;
+    return PARSE_SYNTAX_ERROR;
+}
 
-    // Allocate memory for the array of argument vectors.
-    char ***argList = malloc(sizeof(char**) * (numCommands + 1));
-    for (int i = 0; commandList[i] != NULL; i++) {
-        argList[i] = getArgumentList(commandList[i]); // Convert each command into an argument vector.
+// Appends a token pointer to the token storage, growing it geometrically when full.
+static void pushToken(Arena* arena, CommandList* commandList, size_t* numTokens, size_t* tokenCapacity, char* token) {
+    if (*numTokens == *tokenCapacity) {
+        commandList->tokens = arenaGrow(arena, commandList->tokens, sizeof(char *) * (*tokenCapacity),
+                                        sizeof(char *) * (*tokenCapacity) * 2);
+        *tokenCapacity *= 2;
     }
-    argList[numCommands] = NULL; // Null-terminate the array of argument vectors.
-    
-    return argList; // Return the array of argument vectors.
+    commandList->tokens[(*numTokens)++] = token;
 }
 
-// Converts a single command string into an argument vector.
-char** getArgumentList(char* command) {
-    char *delim = " \n"; // Delimiters for splitting the command into arguments.
-    char *command_copy = copyString(command); // Make a copy of the command.
+// Tokenizes a command line in a single pass. Commands are separated by semicolons (or by '&',
+// which also marks the command before it as a background job), pipeline stages by '|' and
+// arguments by whitespace; every separator is overwritten with NUL so that
+// each argument can be used directly from the input buffer. Empty commands are skipped.
+// All storage comes from the arena and is released when the caller releases the arena.
+// Returns the number of commands found, or PARSE_SYNTAX_ERROR for an empty pipeline stage or
+// a '&' with no command before it.
+int parseCommandList(Arena* arena, char* commandLine, CommandList* commandList) {
+    size_t numTokens = 0;
+    size_t tokenCapacity = INITIAL_TOKEN_CAPACITY;
+    size_t argumentsInStage = 0;
+    size_t stagesInCommand = 0;
+    size_t totalStages = 0;
+    bool pipePending = false;   // A '|' was seen and still needs a stage after it.
+
+    commandList->commands = NULL;
+    commandList->numCommands = 0;
+    commandList->tokens = arenaAlloc(arena, sizeof(char *) * tokenCapacity);
+
+    char *cursor = commandLine;
+    while (*cursor != '\0') {
+        if (*cursor == '|') {
+            // End of a pipeline stage: a stage must exist on both sides of the bar.
+            *cursor++ = '\0';
+            if (argumentsInStage == 0) {
+                return syntaxError(commandList, "|");
+            }
+            pushToken(arena, commandList, &numTokens, &tokenCapacity, NULL);
+            stagesInCommand++;
+            argumentsInStage = 0;
+            pipePending = true;
+        } else if (*cursor == ';' || *cursor == '&') {
+            // End of a command: terminate its last stage if the command had any arguments.
+            char separator = *cursor;
+            *cursor++ = '\0';
+            if ((pipePending || separator == '&') && argumentsInStage == 0) {
+                return syntaxError(commandList, separator == '&' ? "&" : ";");
+            }
+            if (argumentsInStage > 0) {
+                pushToken(arena, commandList, &numTokens, &tokenCapacity, NULL);
+                pushToken(arena, commandList, &numTokens, &tokenCapacity, separator == '&' ? BACKGROUND_COMMAND_END : COMMAND_END);
+                totalStages += stagesInCommand + 1;
+                commandList->numCommands++;
+            }
+            argumentsInStage = 0;
+            stagesInCommand = 0;
+            pipePending = false;
+        } else if (isArgumentDelimiter(*cursor)) {
+            *cursor++ = '\0';
+        } else {
+            // Start of an argument: record it and skip to its end.
+            pushToken(arena, commandList, &numTokens, &tokenCapacity, cursor);
+            argumentsInStage++;
+            pipePending = false;
+            while (*cursor != '\0' && !isOperator(*cursor) && !isArgumentDelimiter(*cursor)) {
+                cursor++;
+            }
+        }
+    }
+    if (pipePending) {
+        return syntaxError(commandList, "newline");
+    }
+    if (argumentsInStage > 0) {
+        pushToken(arena, commandList, &numTokens, &tokenCapacity, NULL);
+        pushToken(arena, commandList, &numTokens, &tokenCapacity, COMMAND_END);
+        totalStages += stagesInCommand + 1;
+        commandList->numCommands++;
+    }
 
-    // Count the number of arguments in the command.
-    int numTokens = 0;
-    char *token = strtok(command, delim);
-    while (token != NULL) {
-        numTokens++;
-        token = strtok(NULL, delim);
+    if (commandList->numCommands == 0) {
+        return 0;
     }
-    numTokens++;
-    // Allocate memory for the argument vector.
-    char **argumentsV = malloc(sizeof(char *) * (numTokens + 1));
 
-    // Split the copied command string into individual arguments.
-    token = strtok(command_copy, delim);
-    int i = 0;
-    for (i = 0; token != NULL; i++) {
-        argumentsV[i] = malloc(sizeof(char) * (strlen(token) + 1));
-        strcpy(argumentsV[i], token); // Copy each argument into the vector.
-        token = strtok(NULL, delim);
+    // Point each command's stages at their argument vectors inside the token storage. All
+    // stage arrays share one allocation, each followed by its NULL terminator.
+    commandList->commands = arenaAlloc(arena, sizeof(Command) * commandList->numCommands);
+    char ***stageStorage = arenaAlloc(arena, sizeof(char **) * (totalStages + commandList->numCommands));
+    char **argumentVector = commandList->tokens;
+    for (size_t i = 0; i < commandList->numCommands; i++) {
+        Command *command = &commandList->commands[i];
+        command->stages = stageStorage;
+        command->numStages = 0;
+        while (*argumentVector != COMMAND_END && *argumentVector != BACKGROUND_COMMAND_END) {
+            command->stages[command->numStages++] = argumentVector;
+            while (*argumentVector != NULL) {
+                argumentVector++;
+            }
+            argumentVector++; // Step past the NULL that terminates this stage.
+        }
+        command->background = (*argumentVector == BACKGROUND_COMMAND_END);
+        argumentVector++; // Step past the end-of-command marker.
+        command->stages[command->numStages] = NULL;
+        stageStorage += command->numStages + 1;
     }
-    argumentsV[i] = NULL; // Null-terminate the argument vector.
-    
-    free(command_copy); // Free the copied command string.
 
-    return argumentsV; // Return the argument vector.
+    return (int)commandList->numCommands;
 }
@@ -1,5 +1,24 @@
 #pragma once
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
 
-char** splitCommands(char* commands);
-char*** parseCommandList(char** commandList);
-char** getArgumentList(char* commands);
+// One command from a command line: a pipeline of one or more stages.
+typedef struct {
+    char ***stages;         // NULL-terminated array of argument vectors, one per pipeline stage.
+    size_t numStages;       // Number of stages; 1 for a simple command.
+    bool background;        // True if the command was terminated by '&'.
+} Command;
+
+// A command line broken into commands. Every argument points directly into the original
+// input line, which the parser NUL-terminates in place.
+typedef struct {
+    Command *commands;      // Commands in the order they appear on the line.
+    size_t numCommands;     // Number of non-empty commands on the line.
+    char **tokens;          // Backing storage for the argument vectors.
+} CommandList;
+
+// Returned by parseCommandList when the line is malformed.
+#define PARSE_SYNTAX_ERROR -1
+
+int parseCommandList(Arena* arena, char* commandLine, CommandList* commandList);
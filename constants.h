@@ -2,13 +2,52 @@
 #pragma once
 
 #define SHELL_NAME "$lopesShell: "
+
+// Shell commands
 #define CMD_EXECUTE_FILE "exec"
 #define CMD_QUIT "quit"
 #define CMD_HELP "help"
+#define CMD_SPAWN_MODE "spawnmode"
+#define CMD_HASH "hash"
+
+// Job control commands
+#define CMD_JOBS "jobs"
+#define CMD_WAIT "wait"
+#define CMD_FOREGROUND "fg"
+#define CMD_BACKGROUND "bg"
+#define CMD_PARALLEL "parallel"
+
+// VMM commands
+#define CMD_CREATE_PROCESS "createproc"
+#define CMD_ALLOCATE_MEMORY "allocmem"
+#define CMD_ACCESS_MEMORY "accessmem"
+#define CMD_FREE_MEMORY "freemem"
+#define CMD_FORK_PROCESS "forkproc"
+#define CMD_SWAP_ON "swapon"
+#define CMD_SAVE "save"
+#define CMD_LOAD "load"
+#define CMD_VMM_STATS "vmmstats"
+#define CMD_TLB "tlb"
+#define CMD_VMM_TRACE "vmmtrace"
+#define CMD_TRACE "trace"
+
+// Modified commands
+#define CMD_DELETE_DIR_EMPTY "rmdir"
+#define CMD_CHANGE_DIR "cd"
+#define CMD_WRITE_LINE "writeline"
+#define CMD_RANDOM_WRITE "randomtxt"
+#define CMD_COPY "cp"
+#define CMD_MOVE "mv"
+#define CMD_REMOVE "rm"
+#define CMD_MAKE_DIR "mkdir"
+#define CMD_TOUCH "touch"
+#define CMD_FIND "find"
+#define CMD_DISK_USAGE "du"
 
 // Help info pages
 #define HELP_DEFAULT 1
 #define HELP_EXECUTE_FILE 2
 #define HELP_HELP 3
 #define HELP_QUIT 4
+#define HELP_SUMMARY 5
 #define HELP_ERROR -1
@@ -1,6 +0,0 @@
-#ifndef CREATE_FILE_PROCESS_H
-#define CREATE_FILE_PROCESS_H
-
-void createFileProcess(char** arguments, char* fileName);
-
-#endif // CREATE_FILE_PROCESS_H
@@ -0,0 +1,351 @@
+#define _GNU_SOURCE
+#include "dir_walk.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_WALK_THREADS 16
+#define DIRENT_BUFFER_SIZE (64 * 1024)
+#define INITIAL_DEQUE_CAPACITY 64
+
+// Directories waiting to be read by one worker. The owner pushes and pops at the tail, so it
+// goes deep into the subtree it is working on (keeping few directories open); idle workers
+// steal from the head, where the oldest and usually largest subtrees are.
+typedef struct {
+    pthread_mutex_t lock;
+    DirNode **items;            // Ring buffer of queued directories.
+    size_t head;
+    size_t count;
+    size_t capacity;
+} WorkDeque;
+
+// State shared by the workers of one walk.
+typedef struct {
+    DirWalk *walk;
+    WorkDeque *deques;          // One per worker.
+    size_t numWorkers;
+    atomic_size_t queued;       // Directories sitting in any deque.
+    atomic_size_t outstanding;  // Directories queued or being read; the walk ends at zero.
+    atomic_size_t numSleeping;  // Workers waiting for work.
+    pthread_mutex_t idleLock;
+    pthread_cond_t idleWake;
+} WalkPool;
+
+// One worker thread of a walk.
+typedef struct {
+    WalkPool *pool;
+    size_t index;               // Index of the worker's own deque.
+    char *direntBuffer;         // getdents64 buffer.
+} WalkWorker;
+
+// Prints an error for path (or path/name) using errno and marks the walk as failed.
+void reportWalkError(DirWalk* walk, const char* path, const char* name) {
+    const char *message = strerror(errno);
+    if (name != NULL) {
+        fprintf(stderr, "%s: %s/%s: %s\n", walk->command, path, name, message);
+    } else {
+        fprintf(stderr, "%s: %s: %s\n", walk->command, path, message);
+    }
+    atomic_store(&walk->failed, true);
+}
+
+// Allocates the node for a subdirectory of parent. Its descriptor is opened by the worker
+// that reads it.
+static DirNode* newNode(DirNode* parent, const char* name) {
+    DirNode *node = malloc(sizeof(DirNode));
+    if (node == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    if (parent == NULL) {
+        node->path = strdup(name);
+    } else if (asprintf(&node->path, "%s/%s", parent->path, name) < 0) {
+        node->path = NULL;
+    }
+    if (node->path == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    node->parent = parent;
+    node->fd = -1;
+    node->auxFd = -1;
+    node->name = parent == NULL ? node->path : node->path + strlen(parent->path) + 1;
+    atomic_init(&node->pending, 1);
+    atomic_init(&node->total, 0);
+    return node;
+}
+
+// Drops one unit of pending work from a node. When nothing is left below it, the node is
+// left (onLeave), closed and freed, and the same is done for its parent.
+static void finishNode(DirWalk* walk, DirNode* node) {
+    while (node != NULL && atomic_fetch_sub(&node->pending, 1) == 1) {
+        if (walk->callbacks->onLeave != NULL) {
+            walk->callbacks->onLeave(walk, node);
+        }
+        DirNode *parent = node->parent;
+        if (node->fd >= 0) {
+            close(node->fd);
+        }
+        if (node->auxFd >= 0) {
+            close(node->auxFd);
+        }
+        free(node->path);
+        free(node);
+        node = parent;
+    }
+}
+
+// Queues a directory on a worker's own deque and wakes a sleeping worker to steal it.
+static void pushNode(WalkWorker* worker, DirNode* node) {
+    WalkPool *pool = worker->pool;
+    WorkDeque *deque = &pool->deques[worker->index];
+    atomic_fetch_add(&pool->outstanding, 1);
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        size_t capacity = deque->capacity * 2;
+        DirNode **items = malloc(sizeof(DirNode *) * capacity);
+        if (items == NULL) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < deque->count; i++) {
+            items[i] = deque->items[(deque->head + i) % deque->capacity];
+        }
+        free(deque->items);
+        deque->items = items;
+        deque->head = 0;
+        deque->capacity = capacity;
+    }
+    deque->items[(deque->head + deque->count) % deque->capacity] = node;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+
+    atomic_fetch_add(&pool->queued, 1);
+    if (atomic_load(&pool->numSleeping) > 0) {
+        pthread_mutex_lock(&pool->idleLock);
+        pthread_cond_signal(&pool->idleWake);
+        pthread_mutex_unlock(&pool->idleLock);
+    }
+}
+
+// Takes the newest directory from the tail of a deque (owner) or the oldest from its head (thief).
+static DirNode* takeNode(WalkPool* pool, WorkDeque* deque, bool fromTail) {
+    DirNode *node = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        if (fromTail) {
+            node = deque->items[(deque->head + deque->count - 1) % deque->capacity];
+        } else {
+            node = deque->items[deque->head];
+            deque->head = (deque->head + 1) % deque->capacity;
+        }
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    if (node != NULL) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return node;
+}
+
+// Finds the next directory for a worker: its own newest one, or one stolen from another worker.
+static DirNode* findWork(WalkWorker* worker) {
+    WalkPool *pool = worker->pool;
+    DirNode *node = takeNode(pool, &pool->deques[worker->index], true);
+    for (size_t i = 1; node == NULL && i < pool->numWorkers && atomic_load(&pool->queued) > 0; i++) {
+        node = takeNode(pool, &pool->deques[(worker->index + i) % pool->numWorkers], false);
+    }
+    return node;
+}
+
+// Classifies an entry whose type the file system did not report.
+static unsigned char statEntryType(int directoryFd, const char* name) {
+    struct stat info;
+    if (fstatat(directoryFd, name, &info, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT) != 0) {
+        return DT_UNKNOWN;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        return DT_DIR;
+    }
+    if (S_ISLNK(info.st_mode)) {
+        return DT_LNK;
+    }
+    return S_ISREG(info.st_mode) ? DT_REG : IFTODT(info.st_mode);
+}
+
+// Opens and reads one directory with getdents64. Files are passed to onEntry; subdirectories
+// are queued on the worker's deque.
+static void readDirectory(WalkWorker* worker, DirNode* node) {
+    DirWalk *walk = worker->pool->walk;
+    int parentFd = node->parent != NULL ? node->parent->fd : AT_FDCWD;
+    node->fd = openat(parentFd, node->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (node->fd < 0) {
+        reportWalkError(walk, node->path, NULL);
+        finishNode(walk, node);
+        return;
+    }
+    if (walk->callbacks->onEnter != NULL && !walk->callbacks->onEnter(walk, node)) {
+        finishNode(walk, node);
+        return;
+    }
+
+    while (true) {
+        ssize_t numRead = getdents64(node->fd, worker->direntBuffer, DIRENT_BUFFER_SIZE);
+        if (numRead <= 0) {
+            if (numRead < 0) {
+                reportWalkError(walk, node->path, NULL);
+            }
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < numRead;) {
+            struct dirent64 *entry = (struct dirent64 *)(worker->direntBuffer + offset);
+            offset += entry->d_reclen;
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                type = statEntryType(node->fd, name);
+            }
+            if (type != DT_DIR) {
+                if (walk->callbacks->onEntry != NULL) {
+                    walk->callbacks->onEntry(walk, node, name, type);
+                }
+                continue;
+            }
+
+            atomic_fetch_add(&node->pending, 1);
+            pushNode(worker, newNode(node, name));
+        }
+    }
+
+    finishNode(walk, node);
+}
+
+// Worker loop: reads directories from its own deque, steals when it runs dry and sleeps
+// when there is nothing to steal, until no directory is queued or being read.
+static void* walkWorker(void* argument) {
+    WalkWorker *worker = argument;
+    WalkPool *pool = worker->pool;
+    while (true) {
+        DirNode *node = findWork(worker);
+        if (node != NULL) {
+            readDirectory(worker, node);
+            if (atomic_fetch_sub(&pool->outstanding, 1) == 1) {
+                pthread_mutex_lock(&pool->idleLock);
+                pthread_cond_broadcast(&pool->idleWake);
+                pthread_mutex_unlock(&pool->idleLock);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idleLock);
+        atomic_fetch_add(&pool->numSleeping, 1);
+        while (atomic_load(&pool->queued) == 0 && atomic_load(&pool->outstanding) > 0) {
+            pthread_cond_wait(&pool->idleWake, &pool->idleLock);
+        }
+        atomic_fetch_sub(&pool->numSleeping, 1);
+        pthread_mutex_unlock(&pool->idleLock);
+        if (atomic_load(&pool->outstanding) == 0) {
+            return NULL;
+        }
+    }
+}
+
+// Lets a walk keep as many directories open as the hard descriptor limit allows. Returns
+// the soft limit to restore once the walk is over, or RLIM_INFINITY if it was not changed.
+static rlim_t raiseDescriptorLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur >= limit.rlim_max) {
+        return RLIM_INFINITY;
+    }
+    rlim_t previous = limit.rlim_cur;
+    limit.rlim_cur = limit.rlim_max;
+    return setrlimit(RLIMIT_NOFILE, &limit) == 0 ? previous : RLIM_INFINITY;
+}
+
+// Puts back the soft limit raiseDescriptorLimit replaced, so commands started later by the
+// shell inherit the limit it was given rather than the raised one.
+static void restoreDescriptorLimit(rlim_t previous) {
+    struct rlimit limit;
+    if (previous != RLIM_INFINITY && getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = previous;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Walks the directory tree at path on a pool of threads with work-stealing deques.
+// rootAuxFd becomes the root node's auxFd and is closed by the walk. Symbolic links are
+// reported as entries and never followed. Returns false if any error was reported.
+bool walkDirectoryTree(DirWalk* walk, const char* path, int rootAuxFd) {
+    rlim_t previousLimit = raiseDescriptorLimit();
+    atomic_store(&walk->failed, false);
+
+    size_t numThreads = walk->numThreads;
+    if (numThreads == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = processors > 0 ? (size_t)processors : 1;
+    }
+    if (numThreads > MAX_WALK_THREADS) {
+        numThreads = MAX_WALK_THREADS;
+    }
+
+    WorkDeque deques[numThreads];
+    WalkWorker workers[numThreads];
+    WalkPool pool = { .walk = walk, .deques = deques, .numWorkers = numThreads };
+    atomic_init(&pool.queued, 0);
+    atomic_init(&pool.outstanding, 0);
+    atomic_init(&pool.numSleeping, 0);
+    pthread_mutex_init(&pool.idleLock, NULL);
+    pthread_cond_init(&pool.idleWake, NULL);
+    for (size_t i = 0; i < numThreads; i++) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].items = malloc(sizeof(DirNode *) * INITIAL_DEQUE_CAPACITY);
+        deques[i].head = 0;
+        deques[i].count = 0;
+        deques[i].capacity = INITIAL_DEQUE_CAPACITY;
+        workers[i] = (WalkWorker){ &pool, i, malloc(DIRENT_BUFFER_SIZE) };
+        if (deques[i].items == NULL || workers[i].direntBuffer == NULL) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    DirNode *root = newNode(NULL, path);
+    root->auxFd = rootAuxFd;
+    pushNode(&workers[0], root);
+
+    // The calling thread is one of the workers.
+    pthread_t threads[numThreads];
+    size_t numStarted = 1;
+    for (; numStarted < numThreads; numStarted++) {
+        if (pthread_create(&threads[numStarted], NULL, walkWorker, &workers[numStarted]) != 0) {
+            break;
+        }
+    }
+    walkWorker(&workers[0]);
+    for (size_t i = 1; i < numStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < numThreads; i++) {
+        pthread_mutex_destroy(&deques[i].lock);
+        free(deques[i].items);
+        free(workers[i].direntBuffer);
+    }
+    pthread_mutex_destroy(&pool.idleLock);
+    pthread_cond_destroy(&pool.idleWake);
+    restoreDescriptorLimit(previousLimit);
+    return !atomic_load(&walk->failed);
+}
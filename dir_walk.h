@@ -0,0 +1,42 @@
+#pragma once
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A directory visited by a walk. Each node keeps its descriptor open until every entry below
+// it has been handled, so callbacks can work relative to it with the *at system calls.
+typedef struct DirNode {
+    struct DirNode *parent;     // Directory containing this one, or NULL for the root.
+    int fd;                     // Descriptor of this directory.
+    int auxFd;                  // Second descriptor owned by the callbacks (e.g. a copy target), or -1.
+    char *path;                 // Path of the directory, for messages.
+    const char *name;           // Name relative to parent->fd (the whole path for the root).
+    atomic_size_t pending;      // Unfinished work below this node, plus one while it is being read.
+    atomic_ullong total;        // Running total kept by the callbacks (e.g. bytes used below it).
+} DirNode;
+
+typedef struct DirWalk DirWalk;
+
+// Callbacks of a walk. They may run on several threads at once, but never on the same
+// directory from two threads. Any of them may be NULL.
+typedef struct {
+    // Called once a directory has been opened, before its entries are read. Returning false
+    // skips the directory.
+    bool (*onEnter)(DirWalk* walk, DirNode* directory);
+    // Called for every entry that is not a directory. type is a DT_* value from the entry,
+    // or from fstatat when the file system does not report one.
+    void (*onEntry)(DirWalk* walk, DirNode* directory, const char* name, unsigned char type);
+    // Called after every entry below a directory has been handled.
+    void (*onLeave)(DirWalk* walk, DirNode* directory);
+} DirWalkCallbacks;
+
+struct DirWalk {
+    const DirWalkCallbacks *callbacks;
+    const char *command;        // Command name used in error messages.
+    void *context;              // Data for the callbacks.
+    size_t numThreads;          // Worker threads; 0 picks one per processor.
+    atomic_bool failed;         // Set by the engine or by a callback when anything went wrong.
+};
+
+bool walkDirectoryTree(DirWalk* walk, const char* path, int rootAuxFd);
+void reportWalkError(DirWalk* walk, const char* path, const char* name);
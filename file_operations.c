@@ -0,0 +1,373 @@
+#define _GNU_SOURCE
+#include "file_operations.h"
+#include "dir_walk.h"
+#include "pipe_io.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COPY_CHUNK (1024 * 1024 * 1024)    // Largest request passed to copy_file_range and sendfile.
+#define COPY_BUFFER_SIZE (128 * 1024)
+
+// Prints "command: path: error" for the current errno.
+static void reportError(const char* command, const char* path) {
+    fprintf(stderr, "%s: %s: %s\n", command, path, strerror(errno));
+}
+
+// Copies the rest of sourceFd into targetFd. The kernel is asked to share the data first
+// (FICLONE reflinks on btrfs/XFS), then to copy it without passing through user space
+// (copy_file_range, then sendfile); a plain read/write loop is the last resort.
+bool copyFileData(int sourceFd, int targetFd) {
+    if (ioctl(targetFd, FICLONE, sourceFd) == 0) {
+        return true;
+    }
+
+    bool copiedAny = false;
+    while (true) {
+        ssize_t copied = copy_file_range(sourceFd, NULL, targetFd, NULL, COPY_CHUNK, 0);
+        if (copied > 0) {
+            copiedAny = true;
+            continue;
+        }
+        if (copied == 0 && copiedAny) {
+            return true;
+        }
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        // Nothing copied (files such as /proc entries report a size of zero) or not supported
+        // between these files: carry on with sendfile from the current offsets.
+        if (copied < 0 && errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP && errno != EBADF) {
+            return false;
+        }
+        break;
+    }
+
+    while (true) {
+        ssize_t copied = sendfile(targetFd, sourceFd, NULL, COPY_CHUNK);
+        if (copied > 0) {
+            continue;
+        }
+        if (copied == 0) {
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EINVAL && errno != ENOSYS) {
+            return false;
+        }
+        break;
+    }
+
+    char buffer[COPY_BUFFER_SIZE];
+    while (true) {
+        ssize_t numRead = read(sourceFd, buffer, sizeof(buffer));
+        if (numRead == 0) {
+            return true;
+        }
+        if (numRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (!writeAll(targetFd, buffer, (size_t)numRead)) {
+            return false;
+        }
+    }
+}
+
+// Copies the file sourceName (relative to sourceDirFd) to targetName (relative to
+// targetDirFd), keeping its permission bits. Symbolic links are followed only if follow is set.
+static bool copyFileAt(int sourceDirFd, const char* sourceName, int targetDirFd, const char* targetName, bool follow) {
+    int sourceFd = openat(sourceDirFd, sourceName, O_RDONLY | O_CLOEXEC | (follow ? 0 : O_NOFOLLOW));
+    if (sourceFd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(sourceFd, &info) != 0) {
+        close(sourceFd);
+        return false;
+    }
+    int targetFd = openat(targetDirFd, targetName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, info.st_mode & 07777);
+    if (targetFd < 0) {
+        close(sourceFd);
+        return false;
+    }
+
+    bool ok = copyFileData(sourceFd, targetFd);
+    int savedErrno = errno;
+    close(sourceFd);
+    if (close(targetFd) != 0) {
+        ok = false;
+    } else {
+        errno = savedErrno;
+    }
+    return ok;
+}
+
+// Identity of the copy's top directory, which must not be copied into itself.
+typedef struct {
+    dev_t device;
+    ino_t inode;
+} CopyTarget;
+
+// Creates the copy of a directory under the copy of its parent. Directories are created
+// writable so they can be filled; their real permissions are applied when they are left.
+static bool enterCopiedDirectory(DirWalk* walk, DirNode* directory) {
+    const CopyTarget *target = walk->context;
+    struct stat info;
+    if (fstat(directory->fd, &info) != 0) {
+        reportWalkError(walk, directory->path, NULL);
+        return false;
+    }
+    if (info.st_dev == target->device && info.st_ino == target->inode) {
+        fprintf(stderr, "%s: cannot copy a directory into itself: %s\n", walk->command, directory->path);
+        atomic_store(&walk->failed, true);
+        return false;
+    }
+    if (directory->parent == NULL) {
+        return true;
+    }
+
+    int parentFd = directory->parent->auxFd;
+    if (mkdirat(parentFd, directory->name, (info.st_mode & 07777) | S_IRWXU) != 0 && errno != EEXIST) {
+        reportWalkError(walk, directory->path, NULL);
+        return false;
+    }
+    directory->auxFd = openat(parentFd, directory->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory->auxFd < 0) {
+        reportWalkError(walk, directory->path, NULL);
+        return false;
+    }
+    return true;
+}
+
+// Copies one non-directory entry: regular files with copyFileData, symbolic links as links,
+// and FIFOs and device nodes with mknodat.
+static void copyEntry(DirWalk* walk, DirNode* directory, const char* name, unsigned char type) {
+    bool ok;
+    if (type == DT_REG) {
+        ok = copyFileAt(directory->fd, name, directory->auxFd, name, false);
+    } else if (type == DT_LNK) {
+        char link[PATH_MAX];
+        ssize_t length = readlinkat(directory->fd, name, link, sizeof(link) - 1);
+        ok = length >= 0;
+        if (ok) {
+            link[length] = '\0';
+            ok = symlinkat(link, directory->auxFd, name) == 0;
+            if (!ok && errno == EEXIST) {
+                ok = unlinkat(directory->auxFd, name, 0) == 0 && symlinkat(link, directory->auxFd, name) == 0;
+            }
+        }
+    } else {
+        struct stat info;
+        ok = fstatat(directory->fd, name, &info, AT_SYMLINK_NOFOLLOW) == 0 &&
+             mknodat(directory->auxFd, name, info.st_mode, info.st_rdev) == 0;
+    }
+    if (!ok) {
+        reportWalkError(walk, directory->path, name);
+    }
+}
+
+// Gives a copied directory the permissions of the original.
+static void leaveCopiedDirectory(DirWalk* walk, DirNode* directory) {
+    struct stat info;
+    if (directory->auxFd >= 0 && fstat(directory->fd, &info) == 0 && (info.st_mode & S_IRWXU) != S_IRWXU) {
+        fchmod(directory->auxFd, info.st_mode & 07777);
+    }
+}
+
+static const DirWalkCallbacks copyCallbacks = { enterCopiedDirectory, copyEntry, leaveCopiedDirectory };
+
+// Copies the directory tree at source to target, creating target if needed.
+static bool copyTree(const char* source, const char* target, mode_t mode) {
+    if (mkdir(target, mode | S_IRWXU) != 0 && errno != EEXIST) {
+        reportError("cp", target);
+        return false;
+    }
+    int targetFd = open(target, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat info;
+    if (targetFd < 0 || fstat(targetFd, &info) != 0) {
+        reportError("cp", target);
+        if (targetFd >= 0) {
+            close(targetFd);
+        }
+        return false;
+    }
+
+    CopyTarget copyTarget = { info.st_dev, info.st_ino };
+    DirWalk walk = { .callbacks = &copyCallbacks, .command = "cp", .context = &copyTarget };
+    return walkDirectoryTree(&walk, source, targetFd);
+}
+
+// Copies a file, or with recursive set a directory tree, from source to target. Symbolic
+// links named on the command line are followed; links inside a tree are copied as links.
+bool copyPath(const char* source, const char* target, bool recursive) {
+    struct stat sourceInfo;
+    if (stat(source, &sourceInfo) != 0) {
+        reportError("cp", source);
+        return false;
+    }
+    if (S_ISDIR(sourceInfo.st_mode)) {
+        if (!recursive) {
+            fprintf(stderr, "cp: -r not specified; omitting directory '%s'\n", source);
+            return false;
+        }
+        return copyTree(source, target, sourceInfo.st_mode & 07777);
+    }
+
+    struct stat targetInfo;
+    if (stat(target, &targetInfo) == 0 && targetInfo.st_dev == sourceInfo.st_dev && targetInfo.st_ino == sourceInfo.st_ino) {
+        fprintf(stderr, "cp: '%s' and '%s' are the same file\n", source, target);
+        return false;
+    }
+    if (!copyFileAt(AT_FDCWD, source, AT_FDCWD, target, true)) {
+        reportError("cp", target);
+        return false;
+    }
+    return true;
+}
+
+// Unlinks one non-directory entry.
+static void removeEntry(DirWalk* walk, DirNode* directory, const char* name, unsigned char type) {
+    if (unlinkat(directory->fd, name, 0) != 0 && errno != ENOENT) {
+        reportWalkError(walk, directory->path, name);
+    }
+}
+
+// Removes a directory once everything inside it is gone.
+static void removeEmptiedDirectory(DirWalk* walk, DirNode* directory) {
+    int parentFd = directory->parent != NULL ? directory->parent->fd : AT_FDCWD;
+    if (unlinkat(parentFd, directory->name, AT_REMOVEDIR) != 0) {
+        // A failure below this directory has already been reported.
+        if (errno != ENOTEMPTY || !atomic_load(&walk->failed)) {
+            reportWalkError(walk, directory->path, NULL);
+        }
+    }
+}
+
+static const DirWalkCallbacks removeCallbacks = { NULL, removeEntry, removeEmptiedDirectory };
+
+// Removes a file, or with recursive set a whole directory tree. Subdirectories are emptied
+// in parallel with unlinkat relative to their own descriptors. With force set, a missing
+// path is not an error.
+bool removePath(const char* path, bool recursive, bool force) {
+    struct stat info;
+    if (lstat(path, &info) != 0) {
+        if (force && errno == ENOENT) {
+            return true;
+        }
+        reportError("rm", path);
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        if (unlink(path) != 0) {
+            reportError("rm", path);
+            return false;
+        }
+        return true;
+    }
+    if (!recursive) {
+        fprintf(stderr, "rm: cannot remove '%s': Is a directory\n", path);
+        return false;
+    }
+
+    DirWalk walk = { .callbacks = &removeCallbacks, .command = "rm" };
+    return walkDirectoryTree(&walk, path, -1);
+}
+
+// Moves source to target with rename. Across file systems the source is copied and then
+// removed; symbolic links are recreated rather than followed.
+bool movePath(const char* source, const char* target) {
+    if (rename(source, target) == 0) {
+        return true;
+    }
+    if (errno != EXDEV) {
+        reportError("mv", source);
+        return false;
+    }
+
+    struct stat info;
+    if (lstat(source, &info) != 0) {
+        reportError("mv", source);
+        return false;
+    }
+    if (S_ISLNK(info.st_mode)) {
+        char link[PATH_MAX];
+        ssize_t length = readlink(source, link, sizeof(link) - 1);
+        if (length < 0) {
+            reportError("mv", source);
+            return false;
+        }
+        link[length] = '\0';
+        unlink(target);
+        if (symlink(link, target) != 0) {
+            reportError("mv", target);
+            return false;
+        }
+    } else if (!copyPath(source, target, true)) {
+        return false;
+    }
+    return removePath(source, true, false);
+}
+
+// Creates a directory. With parents set, missing parent directories are created too and an
+// existing directory is not an error.
+bool makeDirectory(const char* path, bool parents) {
+    if (parents) {
+        char partial[PATH_MAX];
+        size_t length = strlen(path);
+        if (length >= sizeof(partial)) {
+            errno = ENAMETOOLONG;
+            reportError("mkdir", path);
+            return false;
+        }
+        memcpy(partial, path, length + 1);
+        for (size_t i = 1; i < length; i++) {
+            if (partial[i] == '/' && partial[i - 1] != '/') {
+                partial[i] = '\0';
+                if (mkdir(partial, 0777) != 0 && errno != EEXIST) {
+                    reportError("mkdir", partial);
+                    return false;
+                }
+                partial[i] = '/';
+            }
+        }
+    }
+
+    if (mkdir(path, 0777) != 0) {
+        struct stat info;
+        if (!(parents && errno == EEXIST && stat(path, &info) == 0 && S_ISDIR(info.st_mode))) {
+            reportError("mkdir", path);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sets a file's times to now, creating it empty if it does not exist.
+bool touchFile(const char* path) {
+    if (utimensat(AT_FDCWD, path, NULL, 0) == 0) {
+        return true;
+    }
+    if (errno == ENOENT) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC | O_NOCTTY, 0666);
+        if (fd >= 0) {
+            close(fd);
+            return true;
+        }
+    }
+    reportError("touch", path);
+    return false;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <stdbool.h>
+#include <sys/types.h>
+
+bool copyFileData(int sourceFd, int targetFd);
+bool copyPath(const char* source, const char* target, bool recursive);
+bool removePath(const char* path, bool recursive, bool force);
+bool movePath(const char* source, const char* target);
+bool makeDirectory(const char* path, bool parents);
+bool touchFile(const char* path);
@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+#include "file_search.h"
+#include "dir_walk.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Returns the last component of a path given on the command line.
+static const char* lastComponent(const char* path) {
+    const char *slash = strrchr(path, '/');
+    return slash != NULL && slash[1] != '\0' ? slash + 1 : path;
+}
+
+// Returns true if an entry passes every test of a find.
+static bool findMatches(const FindOptions* options, const char* name, unsigned char type) {
+    if (options->type != 0) {
+        unsigned char wanted = options->type == 'd' ? DT_DIR : options->type == 'l' ? DT_LNK : DT_REG;
+        if (type != wanted) {
+            return false;
+        }
+    }
+    return options->namePattern == NULL || fnmatch(options->namePattern, name, 0) == 0;
+}
+
+// Writes one result line. Workers share standard output, so each line is written under the
+// stream's lock and results stream out while the walk is still running.
+static void printPath(const char* directory, const char* name) {
+    flockfile(stdout);
+    fputs_unlocked(directory, stdout);
+    if (name != NULL) {
+        putc_unlocked('/', stdout);
+        fputs_unlocked(name, stdout);
+    }
+    putc_unlocked('\n', stdout);
+    funlockfile(stdout);
+}
+
+// find: tests each directory as it is opened.
+static bool findInDirectory(DirWalk* walk, DirNode* directory) {
+    const char *name = directory->parent != NULL ? directory->name : lastComponent(directory->path);
+    if (findMatches(walk->context, name, DT_DIR)) {
+        printPath(directory->path, NULL);
+    }
+    return true;
+}
+
+// find: tests every other entry.
+static void findEntry(DirWalk* walk, DirNode* directory, const char* name, unsigned char type) {
+    if (findMatches(walk->context, name, type)) {
+        printPath(directory->path, name);
+    }
+}
+
+static const DirWalkCallbacks findCallbacks = { findInDirectory, findEntry, NULL };
+
+// Prints every path under root that passes the tests in options, starting with root itself.
+// Directories are searched in parallel, so the order of the results is not fixed.
+bool findFiles(const char* root, const FindOptions* options) {
+    struct stat info;
+    if (lstat(root, &info) != 0) {
+        fprintf(stderr, "find: %s: %s\n", root, strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        if (findMatches(options, lastComponent(root), S_ISLNK(info.st_mode) ? DT_LNK : IFTODT(info.st_mode))) {
+            printPath(root, NULL);
+        }
+        return true;
+    }
+
+    DirWalk walk = { .callbacks = &findCallbacks, .command = "find", .context = (void *)options };
+    bool ok = walkDirectoryTree(&walk, root, -1);
+    fflush(stdout);
+    return ok;
+}
+
+// Files with several hard links seen during a du, so each is counted once.
+typedef struct {
+    const DiskUsageOptions *options;
+    pthread_mutex_t lock;
+    struct { dev_t device; ino_t inode; } *slots;
+    size_t numUsed;
+    size_t capacity;            // Power of two; zero until the first linked file is seen.
+} DiskUsage;
+
+// Records a multiply linked file. Returns false if it was already counted.
+static bool firstLink(DiskUsage* usage, dev_t device, ino_t inode) {
+    pthread_mutex_lock(&usage->lock);
+    if ((usage->numUsed + 1) * 2 > usage->capacity) {
+        size_t capacity = usage->capacity ? usage->capacity * 2 : 256;
+        __typeof__(usage->slots) slots = calloc(capacity, sizeof(*slots));
+        if (slots == NULL) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < usage->capacity; i++) {
+            if (usage->slots[i].inode != 0) {
+                size_t slot = (size_t)(usage->slots[i].inode * 0x9e3779b97f4a7c15ULL) & (capacity - 1);
+                while (slots[slot].inode != 0) {
+                    slot = (slot + 1) & (capacity - 1);
+                }
+                slots[slot] = usage->slots[i];
+            }
+        }
+        free(usage->slots);
+        usage->slots = slots;
+        usage->capacity = capacity;
+    }
+
+    size_t slot = (size_t)(inode * 0x9e3779b97f4a7c15ULL) & (usage->capacity - 1);
+    bool first = true;
+    while (usage->slots[slot].inode != 0) {
+        if (usage->slots[slot].inode == inode && usage->slots[slot].device == device) {
+            first = false;
+            break;
+        }
+        slot = (slot + 1) & (usage->capacity - 1);
+    }
+    if (first) {
+        usage->slots[slot].device = device;
+        usage->slots[slot].inode = inode;
+        usage->numUsed++;
+    }
+    pthread_mutex_unlock(&usage->lock);
+    return first;
+}
+
+// Formats a size like du -h: one decimal below 10, rounded up, with a unit suffix.
+static void formatSize(unsigned long long bytes, bool humanReadable, char* text, size_t size) {
+    if (!humanReadable) {
+        snprintf(text, size, "%llu", (bytes + 1023) / 1024);
+        return;
+    }
+    if (bytes < 1024) {
+        snprintf(text, size, "%llu", bytes);
+        return;
+    }
+    const char *units = "KMGTPE";
+    unsigned long long divisor = 1024;
+    int unit = 0;
+    while (unit < 5 && (bytes + divisor - 1) / divisor >= 1024) {
+        divisor *= 1024;
+        unit++;
+    }
+    unsigned long long tenths = (bytes * 10 + divisor - 1) / divisor;
+    if (tenths < 100) {
+        snprintf(text, size, "%llu.%llu%c", tenths / 10, tenths % 10, units[unit]);
+    } else {
+        snprintf(text, size, "%llu%c", (bytes + divisor - 1) / divisor, units[unit]);
+    }
+}
+
+// du: counts the space used by the directory itself.
+static bool enterMeasuredDirectory(DirWalk* walk, DirNode* directory) {
+    struct stat info;
+    if (fstat(directory->fd, &info) == 0) {
+        atomic_fetch_add(&directory->total, (unsigned long long)info.st_blocks * 512);
+    }
+    return true;
+}
+
+// du: counts the space used by a file, once per inode.
+static void measureEntry(DirWalk* walk, DirNode* directory, const char* name, unsigned char type) {
+    struct stat info;
+    if (fstatat(directory->fd, name, &info, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT) != 0) {
+        reportWalkError(walk, directory->path, name);
+        return;
+    }
+    if (info.st_nlink > 1 && !firstLink(walk->context, info.st_dev, info.st_ino)) {
+        return;
+    }
+    atomic_fetch_add(&directory->total, (unsigned long long)info.st_blocks * 512);
+}
+
+// du: prints a directory's total once everything below it is counted and adds it to its parent.
+static void leaveMeasuredDirectory(DirWalk* walk, DirNode* directory) {
+    const DiskUsage *usage = walk->context;
+    unsigned long long total = atomic_load(&directory->total);
+    if (directory->parent != NULL) {
+        atomic_fetch_add(&directory->parent->total, total);
+    }
+    if (directory->parent == NULL || !usage->options->summarize) {
+        char size[32];
+        formatSize(total, usage->options->humanReadable, size, sizeof(size));
+        flockfile(stdout);
+        fputs_unlocked(size, stdout);
+        putc_unlocked('\t', stdout);
+        fputs_unlocked(directory->path, stdout);
+        putc_unlocked('\n', stdout);
+        funlockfile(stdout);
+    }
+}
+
+static const DirWalkCallbacks diskUsageCallbacks = { enterMeasuredDirectory, measureEntry, leaveMeasuredDirectory };
+
+// Prints the space used by every directory under root, each once its subtree is finished,
+// ending with the total for root.
+bool diskUsage(const char* root, const DiskUsageOptions* options) {
+    struct stat info;
+    if (lstat(root, &info) != 0) {
+        fprintf(stderr, "du: %s: %s\n", root, strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        char size[32];
+        formatSize((unsigned long long)info.st_blocks * 512, options->humanReadable, size, sizeof(size));
+        printf("%s\t%s\n", size, root);
+        return true;
+    }
+
+    DiskUsage usage = { .options = options };
+    pthread_mutex_init(&usage.lock, NULL);
+    DirWalk walk = { .callbacks = &diskUsageCallbacks, .command = "du", .context = &usage };
+    bool ok = walkDirectoryTree(&walk, root, -1);
+    fflush(stdout);
+    pthread_mutex_destroy(&usage.lock);
+    free(usage.slots);
+    return ok;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdbool.h>
+
+// Tests applied by find. Unset tests match everything.
+typedef struct {
+    const char *namePattern;    // Shell pattern the entry's name must match (-name), or NULL.
+    char type;                  // 'f', 'd' or 'l' to match only files, directories or links (-type), or 0.
+} FindOptions;
+
+// Output settings for du.
+typedef struct {
+    bool humanReadable;         // Print sizes with K/M/G suffixes (-h) instead of 1K blocks.
+    bool summarize;             // Print only the total for each argument (-s).
+} DiskUsageOptions;
+
+bool findFiles(const char* root, const FindOptions* options);
+bool diskUsage(const char* root, const DiskUsageOptions* options);
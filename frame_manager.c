@@ -0,0 +1,609 @@
+#include "frame_manager.h"
+#include "process_registry.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Free frames are tracked in a bitmap (a set bit marks a frame in use) and found with a
+// count-trailing-zeros scan starting at the word where the last free frame was found. The
+// arrays are frame tables (see allocateFrameTable), so with a large physical memory only the
+// parts covering frames in use are ever touched or take memory.
+static uint64_t *frame_bitmap;
+static unsigned int num_words;
+static unsigned int search_word;
+static FrameMapping *frame_map;     // Reverse mapping from frame to (process, page).
+static unsigned int num_frames;
+static unsigned int frames_in_use;
+static const ReplacementPolicy *policy;
+static MemoryStats totals;
+
+// Processes sharing a frame beyond its owner, in a pool of list nodes with a free list.
+typedef struct {
+    PCB *owner;
+    int next;                       // Next node index + 1, or 0.
+} FrameSharer;
+
+static FrameSharer *sharer_pool;
+static unsigned int sharer_capacity;
+static unsigned int sharers_used;   // Nodes handed out at least once.
+static int free_sharers;            // Free list head: node index + 1, or 0.
+static CowStats cow_totals;
+
+// Free frames held by the calling thread's CPU in a concurrent replay, so that most faults
+// need no lock to find a frame. They are handed out from cache_next up to cache_count and
+// count as in use while cached.
+#define FRAME_CACHE_SIZE 8
+static __thread unsigned int frame_cache[FRAME_CACHE_SIZE];
+static __thread unsigned int cache_next;
+static __thread unsigned int cache_count;
+
+// A search for a free run of frames that failed is not repeated until frames are freed.
+static uint64_t release_generation;
+static uint64_t failed_run_search[HUGE_PAGE_LEVELS + 1];
+
+// Allocates a zeroed table of count entries of the given size, or returns NULL. The table is
+// mapped without reserving swap for it, so pages take memory only once they are written.
+void* allocateFrameTable(size_t count, size_t size) {
+    void *table = mmap(NULL, (count ? count : 1) * size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return table == MAP_FAILED ? NULL : table;
+}
+
+// Releases a table from allocateFrameTable, given the count and size it was allocated with.
+void freeFrameTable(void *table, size_t count, size_t size) {
+    if (table) {
+        munmap(table, (count ? count : 1) * size);
+    }
+}
+
+// Returns true if the tables for num_frames frames, with the replacement policy needing the
+// most, can be allocated.
+bool canReserveFrameTables(unsigned int frame_count) {
+    size_t length = ((size_t)frame_count + 63) / 64 * sizeof(uint64_t) +
+                    (size_t)frame_count * sizeof(FrameMapping) + replacementPolicyTableSize(frame_count);
+    void *tables = allocateFrameTable(length, 1);
+    freeFrameTable(tables, length, 1);
+    return tables != NULL;
+}
+
+// Sets up num_frames free frames managed with the given replacement policy.
+void initializeFrameManager(unsigned int frame_count, ReplacementPolicyType policy_type) {
+    num_frames = frame_count;
+    num_words = (frame_count + 63) / 64;
+    frame_bitmap = (uint64_t *)allocateFrameTable(num_words, sizeof(uint64_t));
+    frame_map = (FrameMapping *)allocateFrameTable(frame_count, sizeof(FrameMapping));
+    if (!frame_bitmap || !frame_map) {
+        perror("Failed to initialize the frame table");
+        exit(EXIT_FAILURE);
+    }
+    // Mark the bits past the last frame as used so the scan never returns them.
+    if (frame_count % 64 != 0) {
+        frame_bitmap[num_words - 1] = ~0ULL << (frame_count % 64);
+    }
+    search_word = 0;
+    frames_in_use = 0;
+    release_generation = 1;
+    memset(failed_run_search, 0, sizeof(failed_run_search));
+    policy = getReplacementPolicy(policy_type);
+    policy->initialize(frame_count);
+}
+
+// Takes a free frame from the bitmap, or returns -1 if every frame is in use.
+static int allocateFrame() {
+    if (frames_in_use == num_frames) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < num_words; i++) {
+        unsigned int word = (search_word + i) % num_words;
+        if (frame_bitmap[word] != ~0ULL) {
+            unsigned int bit = (unsigned int)__builtin_ctzll(~frame_bitmap[word]);
+            frame_bitmap[word] |= 1ULL << bit;
+            search_word = word;
+            frames_in_use++;
+            return (int)(word * 64 + bit);
+        }
+    }
+    return -1;
+}
+
+// Marks the count frames starting at first as free. Runs of huge pages are aligned to
+// their size, so whole words are cleared at a time.
+static void freeFrameRun(unsigned int first, uint64_t count) {
+    if (count >= 64) {
+        memset(&frame_bitmap[first / 64], 0, count / 64 * sizeof(uint64_t));
+    } else {
+        for (uint64_t frame = first; frame < first + count; frame++) {
+            frame_bitmap[frame / 64] &= ~(1ULL << (frame % 64));
+        }
+    }
+    frames_in_use -= (unsigned int)count;
+    release_generation++;
+}
+
+// Takes a free run of 2^order frames aligned to its size, or returns -1. Huge page orders
+// are at least RADIX_BITS, so runs are whole bitmap words.
+static int64_t allocateFrameRun(unsigned int order) {
+    uint64_t count = 1ULL << order;
+    unsigned int level = order / RADIX_BITS;
+    if (num_frames - frames_in_use < count || failed_run_search[level] == release_generation) {
+        return -1;
+    }
+    uint64_t words_per_run = count / 64;
+    for (uint64_t start = 0; start + words_per_run <= num_words; start += words_per_run) {
+        uint64_t word = start;
+        while (word < start + words_per_run && frame_bitmap[word] == 0) {
+            word++;
+        }
+        if (word == start + words_per_run) {
+            memset(&frame_bitmap[start], 0xff, words_per_run * sizeof(uint64_t));
+            frames_in_use += (unsigned int)count;
+            return (int64_t)(start * 64);
+        }
+    }
+    failed_run_search[level] = release_generation;
+    return -1;
+}
+
+// Takes a sharer node from the pool, growing it when every node is in use.
+static int allocateSharer() {
+    if (free_sharers != 0) {
+        int node = free_sharers - 1;
+        free_sharers = sharer_pool[node].next;
+        return node;
+    }
+    if (sharers_used == sharer_capacity) {
+        unsigned int capacity = sharer_capacity ? sharer_capacity * 2 : 64;
+        FrameSharer *pool = (FrameSharer *)realloc(sharer_pool, capacity * sizeof(FrameSharer));
+        if (!pool) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        sharer_pool = pool;
+        sharer_capacity = capacity;
+    }
+    return (int)sharers_used++;
+}
+
+// Returns a sharer node to the pool.
+static void freeSharer(int node) {
+    sharer_pool[node].owner = NULL;
+    sharer_pool[node].next = free_sharers;
+    free_sharers = node + 1;
+}
+
+// Takes a frame away from the page it holds: the page table entry of its owner, and of
+// every process sharing it, is invalidated and a dirty page is counted as written back.
+// With swap on, a dirty page is written to swap and the entries point to its slots; a
+// clean page with a copy in swap points to the copy. The frames of a huge page after the
+// first are freed; the first is reused by the caller.
+static void evictFrame(unsigned int frame) {
+    FrameMapping *mapping = &frame_map[frame];
+    PCB *owner = mapping->owner;
+    SwapOut swap_out = { mapping->swap_copy, 1ULL << mapping->order, 0, false, false };
+    SwapOut *swap = swapEnabled() ? &swap_out : NULL;
+    bool dirty = unmapPage(owner, mapping->page, swap);
+    while (mapping->sharers != 0) {
+        int node = mapping->sharers - 1;
+        dirty = unmapPage(sharer_pool[node].owner, mapping->page, swap) || dirty;
+        mapping->sharers = sharer_pool[node].next;
+        freeSharer(node);
+    }
+    cow_totals.shared_references -= mapping->references - 1;
+    owner->stats.evictions++;
+    totals.evictions++;
+    traceEvent(TRACE_PAGE_EVICTED, owner->pid, mapping->page, frame, 0);
+    if (dirty) {
+        owner->stats.writebacks++;
+        totals.writebacks++;
+        traceEvent(TRACE_PAGE_WRITTEN_BACK, owner->pid, mapping->page, frame, 0);
+    }
+    if (swap_out.write) {
+        writeSwapSlots(swap_out.slot - 1, mapping->page, swap_out.count);
+        owner->stats.swap_outs += swap_out.count;
+        totals.swap_outs += swap_out.count;
+        traceEvent(TRACE_PAGE_SWAPPED_OUT, owner->pid, mapping->page, frame, swap_out.slot - 1);
+    }
+    if (mapping->swap_copy) {
+        releaseSwapSlots(mapping->swap_copy - 1, swap_out.count);
+    }
+    if (mapping->order > 0) {
+        uint64_t count = 1ULL << mapping->order;
+        freeFrameRun(frame, count);
+        frame_bitmap[frame / 64] |= 1ULL << (frame % 64);
+        frames_in_use++;
+    }
+}
+
+// Records that a page of pcb was loaded into a frame taken for it.
+void recordPageLoad(PCB *pcb, uint64_t page, unsigned int frame) {
+    pcb->stats.faults++;
+    totals.faults++;
+    frame_map[frame] = (FrameMapping){ pcb, page, 0, 1, 0, 0 };
+    policy->onLoad(frame, pcb->pid, page);
+}
+
+// Handles a page fault: finds a frame for a page of pcb, evicting another page if memory is
+// full, and returns the frame number. Frames cached by the calling CPU are used first.
+unsigned int loadPage(PCB *pcb, uint64_t page) {
+    int free_frame = cache_next < cache_count ? (int)frame_cache[cache_next++] : allocateFrame();
+    unsigned int frame;
+    if (free_frame >= 0) {
+        frame = (unsigned int)free_frame;
+    } else {
+        frame = policy->selectVictim(pcb->pid, page);
+        evictFrame(frame);
+    }
+    recordPageLoad(pcb, page, frame);
+    return frame;
+}
+
+// Takes a frame from the calling CPU's cache, or returns -1 if it is empty. Needs no lock.
+int64_t takeCachedFrame() {
+    return cache_next < cache_count ? (int64_t)frame_cache[cache_next++] : -1;
+}
+
+// Puts back the frame just taken from the calling CPU's cache.
+void returnCachedFrame(unsigned int frame) {
+    frame_cache[--cache_next] = frame;
+}
+
+// Fills the calling CPU's empty cache with free frames, as many as there are up to its size.
+// Returns false if no frame is free.
+bool refillFrameCache() {
+    if (cache_next < cache_count) {
+        return true;
+    }
+    cache_next = cache_count = 0;
+    int frame;
+    while (cache_count < FRAME_CACHE_SIZE && (frame = allocateFrame()) >= 0) {
+        frame_cache[cache_count++] = (unsigned int)frame;
+    }
+    return cache_count > 0;
+}
+
+// Returns the frames left in the calling CPU's cache to the free pool.
+void drainFrameCache() {
+    for (; cache_next < cache_count; cache_next++) {
+        freeFrameRun(frame_cache[cache_next], 1);
+    }
+    cache_next = cache_count = 0;
+}
+
+// Handles a page fault with a huge page, if a free aligned run of frames exists. The
+// replacement policy tracks the huge page through its first frame.
+int64_t loadHugePage(PCB *pcb, uint64_t page, unsigned int order) {
+    int64_t frame = allocateFrameRun(order);
+    if (frame < 0) {
+        return -1;
+    }
+    pcb->stats.faults++;
+    pcb->stats.huge_faults++;
+    totals.faults++;
+    totals.huge_faults++;
+    frame_map[frame] = (FrameMapping){ pcb, page, order, 1, 0, 0 };
+    policy->onLoad((unsigned int)frame, pcb->pid, page);
+    return frame;
+}
+
+// Reads a page back from swap into the frame just loaded for it.
+void readSwappedPage(PCB *pcb, unsigned int frame, uint64_t page, uint64_t slot, unsigned int order) {
+    readSwapSlots(slot, page, 1ULL << order);
+    frame_map[frame].swap_copy = slot + 1;
+    pcb->stats.swap_ins += 1ULL << order;
+    totals.swap_ins += 1ULL << order;
+    traceEvent(TRACE_PAGE_SWAPPED_IN, pcb->pid, page, slot, frame);
+}
+
+// Records an access that hit a resident page.
+void touchFrame(PCB *pcb, unsigned int frame) {
+    pcb->stats.hits++;
+    totals.hits++;
+    policy->onHit(frame);
+}
+
+// Records an access that hit a page while it was resident. By the time a concurrent replay
+// records it the page may have been evicted; the replacement policy is then left alone.
+void touchMappedFrame(PCB *pcb, unsigned int frame, uint64_t page) {
+    pcb->stats.hits++;
+    totals.hits++;
+    if (frame_map[frame].references > 0 && frame_map[frame].page == page) {
+        policy->onHit(frame);
+    }
+}
+
+// Returns a frame to the free pool after its page has been freed, with its copy in swap.
+void releaseFrame(PCB *pcb, unsigned int frame) {
+    FrameMapping *mapping = &frame_map[frame];
+    if (mapping->references > 1) {
+        // Unlink pcb; if it was the owner, the first sharer takes its place.
+        int *link = &mapping->sharers;
+        if (mapping->owner == pcb) {
+            mapping->owner = sharer_pool[*link - 1].owner;
+        } else {
+            while (sharer_pool[*link - 1].owner != pcb) {
+                link = &sharer_pool[*link - 1].next;
+            }
+        }
+        int node = *link - 1;
+        *link = sharer_pool[node].next;
+        freeSharer(node);
+        mapping->references--;
+        cow_totals.shared_references--;
+        return;
+    }
+
+    policy->onRelease(frame);
+    if (mapping->swap_copy) {
+        releaseSwapSlots(mapping->swap_copy - 1, 1ULL << mapping->order);
+        mapping->swap_copy = 0;
+    }
+    mapping->owner = NULL;
+    mapping->references = 0;
+    freeFrameRun(frame, 1ULL << mapping->order);
+}
+
+// Adds pcb as a sharer of a frame mapped by its parent at the same page.
+void shareFrame(PCB *pcb, unsigned int frame) {
+    FrameMapping *mapping = &frame_map[frame];
+    int node = allocateSharer();
+    sharer_pool[node].owner = pcb;
+    sharer_pool[node].next = mapping->sharers;
+    mapping->sharers = node + 1;
+    mapping->references++;
+    cow_totals.shared_references++;
+}
+
+// Returns true if more than one process maps the frame.
+bool isFrameShared(unsigned int frame) {
+    return frame_map[frame].references > 1;
+}
+
+// Records a fork that shared the given number of frames.
+void recordFork(uint64_t frames_shared) {
+    cow_totals.forks++;
+    cow_totals.frames_shared += frames_shared;
+}
+
+// Records frames copied because pcb wrote to a shared page.
+void recordCopyOnWrite(PCB *pcb, uint64_t frames_copied) {
+    pcb->stats.cow_copies += frames_copied;
+    totals.cow_copies += frames_copied;
+    cow_totals.frames_copied += frames_copied;
+}
+
+// Returns the copy-on-write counters.
+const CowStats* cowTotals() {
+    return &cow_totals;
+}
+
+// Returns the name of the replacement policy in use.
+const char* replacementPolicyName() {
+    return policy->name;
+}
+
+// Returns the number of frames holding a page.
+unsigned int framesInUse() {
+    return frames_in_use;
+}
+
+// Returns the total number of frames.
+unsigned int totalFrames() {
+    return num_frames;
+}
+
+// Returns the counters summed over every process.
+const MemoryStats* memoryTotals() {
+    return &totals;
+}
+
+// The frame manager as saved in an image, followed by sections holding the frame table
+// entries of the resident pages and the sharer pool. Free frames are not saved: the bitmap
+// is rebuilt from the runs of the resident pages. Processes are named by pid + 1, or 0 for
+// none.
+typedef struct {
+    uint64_t num_frames;
+    uint64_t frames_in_use;
+    uint64_t search_word;
+    uint64_t sharers_used;
+    int64_t free_sharers;
+    uint64_t saved_frames;          // Frame table entries saved, one per resident page.
+    MemoryStats totals;
+    CowStats cow_totals;
+} SavedFrameManager;
+
+// Frame table entry of the first frame of a resident page.
+typedef struct {
+    uint64_t owner;
+    uint64_t page;
+    uint64_t swap_copy;
+    uint32_t frame;
+    uint32_t order;
+    uint32_t references;
+    int32_t sharers;
+} SavedFrame;
+
+typedef struct {
+    uint64_t owner;
+    int64_t next;
+} SavedSharer;
+
+// Frame table entries converted at a time.
+#define SAVED_FRAME_CHUNK 1024
+
+// Returns the pid + 1 of a process, or 0 for none.
+static inline uint64_t savedOwner(const PCB *pcb) {
+    return pcb ? (uint64_t)pcb->pid + 1 : 0;
+}
+
+// Returns the first frame of every resident page, in increasing order, and their number in
+// *count. The bitmap is scanned a word at a time and the other frames of a huge page are
+// skipped, so only the entries of resident pages are read.
+static unsigned int* residentFrames(unsigned int *count) {
+    unsigned int *frames = (unsigned int *)malloc((frames_in_use ? frames_in_use : 1) * sizeof(unsigned int));
+    if (!frames) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    *count = 0;
+    for (unsigned int word = 0; word < num_words; word++) {
+        uint64_t bits = frame_bitmap[word];
+        while (bits != 0) {
+            unsigned int frame = word * 64 + (unsigned int)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (frame >= num_frames || frame_map[frame].references == 0) {
+                continue;
+            }
+            frames[(*count)++] = frame;
+            if (frame_map[frame].order > 0) {
+                // Huge page runs are whole words.
+                word += (unsigned int)((1ULL << frame_map[frame].order) / 64) - 1;
+                bits = 0;
+            }
+        }
+    }
+    return frames;
+}
+
+// Writes the frame table and counters to an image.
+void saveFrameManager(ImageWriter *writer) {
+    unsigned int num_resident;
+    unsigned int *resident = residentFrames(&num_resident);
+    SavedFrameManager saved = { num_frames, frames_in_use, search_word, sharers_used, free_sharers, num_resident, totals, cow_totals };
+    writeImageSection(writer, SECTION_FRAMES, &saved, sizeof(saved));
+
+    SavedFrame frames[SAVED_FRAME_CHUNK];
+    beginImageSection(writer, SECTION_FRAMES, (uint64_t)num_resident * sizeof(SavedFrame));
+    for (unsigned int start = 0; start < num_resident; start += SAVED_FRAME_CHUNK) {
+        unsigned int count = num_resident - start < SAVED_FRAME_CHUNK ? num_resident - start : SAVED_FRAME_CHUNK;
+        for (unsigned int i = 0; i < count; i++) {
+            const FrameMapping *mapping = &frame_map[resident[start + i]];
+            frames[i] = (SavedFrame){ savedOwner(mapping->owner), mapping->page, mapping->swap_copy, resident[start + i],
+                                      mapping->order, mapping->references, mapping->sharers };
+        }
+        writeImageData(writer, frames, count * sizeof(SavedFrame));
+    }
+    endImageSection(writer);
+
+    beginImageSection(writer, SECTION_FRAMES, (uint64_t)sharers_used * sizeof(SavedSharer));
+    for (unsigned int i = 0; i < sharers_used; i++) {
+        SavedSharer sharer = { savedOwner(sharer_pool[i].owner), sharer_pool[i].next };
+        writeImageData(writer, &sharer, sizeof(sharer));
+    }
+    endImageSection(writer);
+    policy->save(writer, resident, num_resident);
+    free(resident);
+}
+
+// Returns the process named by a saved pid + 1, or NULL. *found is false if the process
+// does not exist. The last process looked up is remembered, since neighbouring frames
+// usually belong to the same one.
+static PCB* loadedOwner(uint64_t owner, bool *found) {
+    static PCB *last;
+    if (owner == 0) {
+        return NULL;
+    }
+    if (!last || (uint64_t)last->pid + 1 != owner) {
+        last = owner - 1 <= UINT32_MAX ? findProcess((unsigned int)(owner - 1)) : NULL;
+    }
+    *found = *found && last != NULL;
+    return last;
+}
+
+// Marks the count frames starting at first as in use.
+static void markFrameRun(unsigned int first, uint64_t count) {
+    if (count >= 64) {
+        memset(&frame_bitmap[first / 64], 0xff, count / 64 * sizeof(uint64_t));
+    } else {
+        for (uint64_t frame = first; frame < first + count; frame++) {
+            frame_bitmap[frame / 64] |= 1ULL << (frame % 64);
+        }
+    }
+}
+
+// Restores the saved frame table entries into the frame table and the bitmap, filling
+// resident with their frames. Returns false unless the entries are in increasing order,
+// their runs are aligned and do not overlap, and they cover frames_in_use frames.
+static bool loadFrames(const SavedFrame *frames, unsigned int count, uint64_t sharers_used_saved, uint64_t frames_in_use_saved,
+                       unsigned int *resident) {
+    uint64_t next_free = 0;
+    uint64_t used = 0;
+    bool found = true;
+    for (unsigned int i = 0; i < count && found; i++) {
+        const SavedFrame *entry = &frames[i];
+        if (entry->order > HUGE_PAGE_LEVELS * RADIX_BITS || entry->order % RADIX_BITS != 0 || entry->frame < next_free ||
+            entry->frame % (1ULL << entry->order) != 0 || entry->frame + (1ULL << entry->order) > num_frames ||
+            entry->owner == 0 || entry->references == 0 || entry->sharers < 0 || (uint64_t)entry->sharers > sharers_used_saved) {
+            return false;
+        }
+        frame_map[entry->frame] = (FrameMapping){ loadedOwner(entry->owner, &found), entry->page, entry->order, entry->references,
+                                                  entry->sharers, entry->swap_copy };
+        markFrameRun(entry->frame, 1ULL << entry->order);
+        resident[i] = entry->frame;
+        next_free = entry->frame + (1ULL << entry->order);
+        used += 1ULL << entry->order;
+    }
+    return found && used == frames_in_use_saved;
+}
+
+// Restores the frame table and counters from an image, after the processes have been
+// restored and with the frame manager initialized for the same number of frames. Returns
+// false if the image does not hold a valid frame table.
+bool loadFrameManager(ImageReader *reader) {
+    const SavedFrameManager *saved = (const SavedFrameManager *)readImageSection(reader, SECTION_FRAMES, sizeof(SavedFrameManager));
+    if (!saved || saved->num_frames != num_frames || saved->frames_in_use > num_frames || saved->search_word >= num_words ||
+        saved->saved_frames > saved->frames_in_use || saved->sharers_used > INT32_MAX || saved->free_sharers < 0 ||
+        (uint64_t)saved->free_sharers > saved->sharers_used) {
+        return false;
+    }
+    const SavedFrame *frames = (const SavedFrame *)readImageSection(reader, SECTION_FRAMES, saved->saved_frames * sizeof(SavedFrame));
+    const SavedSharer *sharers = (const SavedSharer *)readImageSection(reader, SECTION_FRAMES, saved->sharers_used * sizeof(SavedSharer));
+    if (!frames || !sharers) {
+        return false;
+    }
+
+    unsigned int num_resident = (unsigned int)saved->saved_frames;
+    unsigned int *resident = (unsigned int *)malloc((num_resident ? num_resident : 1) * sizeof(unsigned int));
+    if (!resident) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    bool found = loadFrames(frames, num_resident, saved->sharers_used, saved->frames_in_use, resident);
+    frames_in_use = (unsigned int)saved->frames_in_use;
+    search_word = (unsigned int)saved->search_word;
+    totals = saved->totals;
+    cow_totals = saved->cow_totals;
+
+    free(sharer_pool);
+    sharer_capacity = saved->sharers_used > 64 ? (unsigned int)saved->sharers_used : 64;
+    sharer_pool = (FrameSharer *)malloc(sharer_capacity * sizeof(FrameSharer));
+    if (!sharer_pool) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    sharers_used = (unsigned int)saved->sharers_used;
+    free_sharers = (int)saved->free_sharers;
+    for (unsigned int i = 0; i < sharers_used && found; i++) {
+        if (sharers[i].next < 0 || (uint64_t)sharers[i].next > sharers_used) {
+            found = false;
+            break;
+        }
+        sharer_pool[i] = (FrameSharer){ loadedOwner(sharers[i].owner, &found), (int)sharers[i].next };
+    }
+    found = found && policy->load(reader, resident, num_resident);
+    free(resident);
+    return found;
+}
+
+// Releases the frame manager's memory.
+void cleanupFrameManager() {
+    freeFrameTable(frame_bitmap, num_words, sizeof(uint64_t));
+    freeFrameTable(frame_map, num_frames, sizeof(FrameMapping));
+    frame_bitmap = NULL;
+    frame_map = NULL;
+    free(sharer_pool);
+    sharer_pool = NULL;
+    sharer_capacity = sharers_used = 0;
+    free_sharers = 0;
+}
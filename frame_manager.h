@@ -0,0 +1,105 @@
+#ifndef FRAME_MANAGER_H
+#define FRAME_MANAGER_H
+
+#include "vmm.h"
+#include "replacement_policy.h"
+
+// Reverse mapping entry: the page held by a physical frame. A huge page occupies a run of
+// frames and is described by the entry of its first frame. After a fork, the frame is
+// shared copy-on-write by several processes, all at the same page number.
+typedef struct {
+    PCB *owner;                     // Process owning the page, or NULL for a free frame.
+    uint64_t page;                  // Virtual page number within the owner.
+    unsigned int order;             // The page spans 2^order frames.
+    unsigned int references;        // Processes mapping the frame: the owner and its sharers.
+    int sharers;                    // Other processes mapping the frame: sharer pool index + 1, or 0.
+    uint64_t swap_copy;             // First swap slot + 1 of a copy of the page, or 0.
+} FrameMapping;
+
+// Copy-on-write counters.
+typedef struct {
+    uint64_t forks;                 // Address spaces duplicated.
+    uint64_t frames_shared;         // Frames shared at fork time, which an eager copy would have duplicated.
+    uint64_t frames_copied;         // Frames copied later because a shared page was written.
+    uint64_t shared_references;     // References beyond the first to frames that are currently shared.
+} CowStats;
+
+// Per-frame tables are allocated zeroed and take memory only for the pages written, so a
+// large physical memory costs what its frames in use need. canReserveFrameTables checks that
+// the tables for num_frames frames fit in the address space the shell may use.
+void* allocateFrameTable(size_t count, size_t size);
+void freeFrameTable(void *table, size_t count, size_t size);
+bool canReserveFrameTables(unsigned int num_frames);
+
+// Sets up num_frames free frames managed with the given replacement policy.
+void initializeFrameManager(unsigned int num_frames, ReplacementPolicyType policy);
+
+// Handles a page fault: finds a frame for a page of pcb, evicting another page if memory is
+// full, and returns the frame number.
+unsigned int loadPage(PCB *pcb, uint64_t page);
+
+// In a concurrent replay each CPU keeps a small cache of free frames, so that faults can
+// take a frame without the VMM lock. takeCachedFrame and returnCachedFrame need no lock;
+// the other functions here must be called with the lock held. recordPageLoad completes a
+// fault handled with a cached frame, and drainFrameCache gives the cache back when the CPU
+// stops.
+int64_t takeCachedFrame();
+void returnCachedFrame(unsigned int frame);
+bool refillFrameCache();
+void drainFrameCache();
+void recordPageLoad(PCB *pcb, uint64_t page, unsigned int frame);
+
+// Handles a page fault with a huge page: takes a free, aligned run of 2^order frames for the
+// pages of pcb starting at page and returns its first frame. Never evicts; returns -1 if
+// no such run is free.
+int64_t loadHugePage(PCB *pcb, uint64_t page, unsigned int order);
+
+// Reads the page of pcb just loaded into frame (2^order pages, for a huge page) back from
+// the swap slots starting at slot. The entry's reference to the slots passes to the frame,
+// which keeps them as a copy of its page until it is dirtied and evicted, or released.
+void readSwappedPage(PCB *pcb, unsigned int frame, uint64_t page, uint64_t slot, unsigned int order);
+
+// Records an access that hit a resident page (the first frame of a huge page).
+void touchFrame(PCB *pcb, unsigned int frame);
+
+// Like touchFrame, for a hit recorded after the fact: the replacement policy only hears of
+// it if the frame still holds the page (the first page of a huge page).
+void touchMappedFrame(PCB *pcb, unsigned int frame, uint64_t page);
+
+// Drops pcb's reference to a frame after its page has been freed, or copied on write. The
+// frame, or the run of a huge page, returns to the free pool with its last reference.
+void releaseFrame(PCB *pcb, unsigned int frame);
+
+// Adds pcb as a sharer of a frame mapped by its parent at the same page (fork).
+void shareFrame(PCB *pcb, unsigned int frame);
+
+// Returns true if more than one process maps the frame.
+bool isFrameShared(unsigned int frame);
+
+// Records a fork that shared the given number of frames, and frames copied on write.
+void recordFork(uint64_t frames_shared);
+void recordCopyOnWrite(PCB *pcb, uint64_t frames_copied);
+
+// Returns the copy-on-write counters.
+const CowStats* cowTotals();
+
+// Returns the name of the replacement policy in use.
+const char* replacementPolicyName();
+
+// Returns the number of frames holding a page and the total number of frames.
+unsigned int framesInUse();
+unsigned int totalFrames();
+
+// Returns the counters summed over every process.
+const MemoryStats* memoryTotals();
+
+// Writes the frame table, the replacement policy's state and the counters to an image, or
+// restores them once the processes have been restored into a frame manager initialized
+// for the same memory. loadFrameManager returns false if the image does not hold them.
+void saveFrameManager(ImageWriter *writer);
+bool loadFrameManager(ImageReader *reader);
+
+// Releases the frame manager's memory.
+void cleanupFrameManager();
+
+#endif // FRAME_MANAGER_H
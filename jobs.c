@@ -0,0 +1,342 @@
+#include "jobs.h"
+#include "pipeline.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Table of background jobs in the order they were started.
+static Job **jobTable = NULL;
+static size_t numJobs = 0;
+static size_t jobCapacity = 0;
+
+// SIGCHLD is blocked and delivered through this descriptor, so children are only reaped when
+// the shell asks for it and never interrupt a foreground wait.
+static int childSignalFd = -1;
+
+// Blocks SIGCHLD and opens the signalfd used to learn about finished background jobs.
+// SIGTTOU is ignored so the shell can take the terminal back from a job with tcsetpgrp.
+void initializeJobs() {
+    signal(SIGTTOU, SIG_IGN);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) != 0) {
+        perror("Failed to block SIGCHLD");
+        exit(EXIT_FAILURE);
+    }
+
+    childSignalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (childSignalFd < 0) {
+        perror("Failed to create signalfd");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Builds a printable form of a pipeline, e.g. "sleep 5 | cat".
+static char* describeCommand(char*** stages, size_t numStages) {
+    size_t length = 1;
+    for (size_t i = 0; i < numStages; i++) {
+        for (size_t j = 0; stages[i][j] != NULL; j++) {
+            length += strlen(stages[i][j]) + 1;
+        }
+        length += 3;
+    }
+
+    char *text = malloc(length);
+    if (text == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    char *cursor = text;
+    for (size_t i = 0; i < numStages; i++) {
+        if (i > 0) {
+            cursor = stpcpy(cursor, " | ");
+        }
+        for (size_t j = 0; stages[i][j] != NULL; j++) {
+            if (j > 0) {
+                *cursor++ = ' ';
+            }
+            cursor = stpcpy(cursor, stages[i][j]);
+        }
+    }
+    *cursor = '\0';
+    return text;
+}
+
+// Removes a job from the table and frees it.
+static void removeJob(size_t index) {
+    Job *job = jobTable[index];
+    free(job->processIDs);
+    free(job->commandText);
+    free(job);
+    memmove(&jobTable[index], &jobTable[index + 1], sizeof(Job *) * (numJobs - index - 1));
+    numJobs--;
+}
+
+// Starts a pipeline as a background job in its own process group. Background jobs read from
+// /dev/null so they never compete with the prompt for terminal input.
+void startBackgroundJob(char*** stages, size_t numStages) {
+    pid_t processIDs[numStages];
+    int nullFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    size_t numStarted = startPipeline(stages, numStages, nullFd, -1, 0, processIDs);
+    if (numStarted == 0) {
+        return;
+    }
+
+    Job *job = calloc(1, sizeof(Job));
+    if (job == NULL || (job->processIDs = malloc(sizeof(pid_t) * numStarted)) == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(job->processIDs, processIDs, sizeof(pid_t) * numStarted);
+    job->id = numJobs > 0 ? jobTable[numJobs - 1]->id + 1 : 1;
+    job->processGroup = processIDs[0];
+    job->numProcesses = numStarted;
+    job->numLive = numStarted;
+    job->state = JOB_RUNNING;
+    job->commandText = describeCommand(stages, numStages);
+
+    if (numJobs == jobCapacity) {
+        jobCapacity = jobCapacity ? jobCapacity * 2 : 8;
+        Job **grown = realloc(jobTable, sizeof(Job *) * jobCapacity);
+        if (grown == NULL) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        jobTable = grown;
+    }
+    jobTable[numJobs++] = job;
+    printf("[%d] %d\n", job->id, (int)job->processGroup);
+}
+
+// Applies a wait status for one of a job's processes. Returns false if pid is not in the job.
+static bool updateJob(Job* job, pid_t processID, int status) {
+    for (size_t i = 0; i < job->numProcesses; i++) {
+        if (job->processIDs[i] != processID) {
+            continue;
+        }
+        if (WIFSTOPPED(status)) {
+            job->state = JOB_STOPPED;
+        } else if (WIFCONTINUED(status)) {
+            job->state = JOB_RUNNING;
+        } else {
+            job->processIDs[i] = 0; // Reaped; nothing left to wait for.
+            job->numLive--;
+            if (i == job->numProcesses - 1) {
+                job->exitStatus = status;
+            }
+            if (job->numLive == 0) {
+                job->state = JOB_DONE;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// Records a wait status collected elsewhere (e.g. by a builtin waiting for any child).
+// Returns true if the process belonged to a background job.
+bool recordChildStatus(pid_t processID, int status) {
+    for (size_t i = 0; i < numJobs; i++) {
+        if (updateJob(jobTable[i], processID, status)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Describes a job's state the way the jobs builtin prints it.
+static const char* describeState(const Job* job, char* buffer, size_t bufferSize) {
+    switch (job->state) {
+        case JOB_RUNNING:
+            return "Running";
+        case JOB_STOPPED:
+            return "Stopped";
+        case JOB_DONE:
+        default:
+            if (WIFSIGNALED(job->exitStatus)) {
+                snprintf(buffer, bufferSize, "Terminated (%s)", strsignal(WTERMSIG(job->exitStatus)));
+                return buffer;
+            }
+            if (WEXITSTATUS(job->exitStatus) != 0) {
+                snprintf(buffer, bufferSize, "Exit %d", WEXITSTATUS(job->exitStatus));
+                return buffer;
+            }
+            return "Done";
+    }
+}
+
+// Collects status changes of background children without blocking. The signalfd is only
+// readable after a SIGCHLD, so when nothing has happened this costs a single read.
+// Finished and newly stopped jobs are reported, and finished jobs leave the table.
+void reapJobs() {
+    struct signalfd_siginfo info;
+    bool signalled = false;
+    while (read(childSignalFd, &info, sizeof(info)) == sizeof(info)) {
+        signalled = true;
+    }
+    if (!signalled) {
+        return;
+    }
+
+    int status = 0;
+    pid_t processID;
+    while ((processID = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
+        for (size_t i = 0; i < numJobs; i++) {
+            JobState before = jobTable[i]->state;
+            if (updateJob(jobTable[i], processID, status)) {
+                if (jobTable[i]->state == JOB_STOPPED && before != JOB_STOPPED) {
+                    printf("[%d]  Stopped\t\t%s\n", jobTable[i]->id, jobTable[i]->commandText);
+                }
+                break;
+            }
+        }
+    }
+
+    char buffer[64];
+    for (size_t i = 0; i < numJobs; ) {
+        if (jobTable[i]->state == JOB_DONE) {
+            printf("[%d]  %s\t\t%s\n", jobTable[i]->id, describeState(jobTable[i], buffer, sizeof(buffer)), jobTable[i]->commandText);
+            removeJob(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+// Finds the table index for a job spec: `%n` for job n, a bare number for a pid, or NULL for
+// the most recent job. Returns -1 if no job matches.
+static long findJob(const char* spec) {
+    if (spec == NULL) {
+        return (long)numJobs - 1;
+    }
+    for (size_t i = 0; i < numJobs; i++) {
+        if (spec[0] == '%') {
+            if (jobTable[i]->id == atoi(spec + 1)) {
+                return (long)i;
+            }
+        } else {
+            pid_t processID = (pid_t)atoi(spec);
+            for (size_t j = 0; j < jobTable[i]->numProcesses; j++) {
+                if (jobTable[i]->processIDs[j] == processID || jobTable[i]->processGroup == processID) {
+                    return (long)i;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+// Blocks until every live process of a job exits or the job stops. Returns true if the job
+// finished (and was removed from the table).
+static bool waitForJob(size_t index) {
+    Job *job = jobTable[index];
+    for (size_t i = 0; i < job->numProcesses && job->state != JOB_STOPPED; i++) {
+        int status = 0;
+        while (job->processIDs[i] > 0 && job->state != JOB_STOPPED) {
+            pid_t processID = job->processIDs[i];
+            if (waitpid(processID, &status, WUNTRACED) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                status = 0; // Already reaped elsewhere.
+            }
+            updateJob(job, processID, status);
+        }
+    }
+
+    if (job->state == JOB_STOPPED) {
+        printf("[%d]  Stopped\t\t%s\n", job->id, job->commandText);
+        return false;
+    }
+    removeJob(index);
+    return true;
+}
+
+// jobs: lists the background jobs.
+void executeJobs(char** arguments) {
+    reapJobs();
+    char buffer[64];
+    for (size_t i = 0; i < numJobs; i++) {
+        printf("[%d]  %s\t\t%s &\n", jobTable[i]->id, describeState(jobTable[i], buffer, sizeof(buffer)), jobTable[i]->commandText);
+    }
+}
+
+// wait [job ...]: waits for the given jobs, or for every running job.
+void executeWait(char** arguments) {
+    if (arguments[1] == NULL) {
+        for (size_t i = 0; i < numJobs; ) {
+            if (jobTable[i]->state == JOB_STOPPED || !waitForJob(i)) {
+                i++;
+            }
+        }
+        return;
+    }
+
+    for (int i = 1; arguments[i] != NULL; i++) {
+        long index = findJob(arguments[i]);
+        if (index < 0) {
+            printf("wait: %s: no such job\n", arguments[i]);
+            continue;
+        }
+        waitForJob((size_t)index);
+    }
+}
+
+// Returns true if the shell's standard input is a terminal whose foreground process group is
+// the shell's own, i.e. the shell is in charge of job control on it.
+static bool ownsTerminal() {
+    return isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+}
+
+// fg [job]: resumes a job if it is stopped and waits for it in the foreground. The job is
+// given the terminal while it runs, so it can read from it and receive ^C and ^Z.
+void executeForeground(char** arguments) {
+    long index = findJob(arguments[1]);
+    if (index < 0) {
+        printf("fg: %s: no such job\n", arguments[1] ? arguments[1] : "current");
+        return;
+    }
+
+    Job *job = jobTable[index];
+    printf("%s\n", job->commandText);
+    fflush(stdout);
+    bool handOff = ownsTerminal();
+    if (handOff && tcsetpgrp(STDIN_FILENO, job->processGroup) != 0) {
+        perror("fg: tcsetpgrp");
+        handOff = false;
+    }
+    if (job->state == JOB_STOPPED) {
+        kill(-job->processGroup, SIGCONT);
+        job->state = JOB_RUNNING;
+    }
+    waitForJob((size_t)index);
+    if (handOff) {
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    }
+}
+
+// bg [job]: resumes a stopped job in the background.
+void executeBackground(char** arguments) {
+    long index = findJob(arguments[1]);
+    if (index < 0) {
+        printf("bg: %s: no such job\n", arguments[1] ? arguments[1] : "current");
+        return;
+    }
+
+    Job *job = jobTable[index];
+    if (job->state != JOB_STOPPED) {
+        printf("bg: job %d already in background\n", job->id);
+        return;
+    }
+    kill(-job->processGroup, SIGCONT);
+    job->state = JOB_RUNNING;
+    printf("[%d] %s &\n", job->id, job->commandText);
+}
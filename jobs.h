@@ -0,0 +1,34 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Lifecycle of a background job.
+typedef enum {
+    JOB_RUNNING,
+    JOB_STOPPED,
+    JOB_DONE
+} JobState;
+
+// A background pipeline tracked by the job table.
+typedef struct {
+    int id;                     // Job number shown to the user as %id.
+    pid_t processGroup;         // Process group shared by every stage of the job.
+    pid_t *processIDs;          // Pids of the job's stages.
+    size_t numProcesses;        // Number of stages started.
+    size_t numLive;             // Stages that have not exited yet.
+    int exitStatus;             // Wait status of the last stage once it exits.
+    JobState state;
+    char *commandText;          // Command line used to start the job, for display.
+} Job;
+
+void initializeJobs();
+void startBackgroundJob(char*** stages, size_t numStages);
+void reapJobs();
+bool recordChildStatus(pid_t processID, int status);
+
+// Job control builtins
+void executeJobs(char** arguments);
+void executeWait(char** arguments);
+void executeForeground(char** arguments);
+void executeBackground(char** arguments);
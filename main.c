@@ -6,15 +6,18 @@
 #include "runCommand.h"
 #include "vmm.h"
 #include "scheduler.h"
+#include "arena.h"
+#include "pipeline.h"
+#include "jobs.h"
+#include "script_file.h"
+#include "append_cache.h"
+#include "trace.h"
+#include "process_registry.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
-#define CMD_CREATE_PROCESS "createproc"
-#define CMD_ALLOCATE_MEMORY "allocmem"
-#define CMD_ACCESS_MEMORY "accessmem"
-#define CMD_FREE_MEMORY "freemem"
 
 /*  Project 6
 *   Most commands are covered by execution of UNIX shell commands
@@ -60,98 +63,159 @@
 *       - `cd [path]`
 */
 
-// Function prototypes
-void runCommand(char* inputCommand);
-void handleCreateProcessCommand(char** arguments);
+// Arena that owns every allocation made while parsing and dispatching a line. It is reused
+// for the lifetime of the shell, so steady-state command handling does not call malloc.
+static Arena lineArena;
 
 int main(int argc, char **argv) {
+    // Parse startup options: -p selects the page replacement policy of the VMM and -T the
+    // page table layout of its processes. -P, -M and -A set the page size, the physical
+    // memory size and the width of virtual addresses, and -H enables huge pages.
+    ReplacementPolicyType policy = POLICY_CLOCK;
+    PageTableLayout layout = PAGE_TABLE_FLAT;
+    MemoryGeometry geometry = { .page_size = DEFAULT_PAGE_SIZE, .physical_memory = DEFAULT_PHYS_MEM_SIZE,
+                                .address_bits = DEFAULT_ADDRESS_BITS };
+    int option;
+    while ((option = getopt(argc, argv, "p:T:P:M:A:H")) != -1) {
+        bool valid = true;
+        char *end;
+        switch (option) {
+        case 'p':
+            valid = parseReplacementPolicy(optarg, &policy);
+            break;
+        case 'T':
+            valid = parsePageTableLayout(optarg, &layout);
+            break;
+        case 'P':
+            valid = parseSize(optarg, &geometry.page_size);
+            break;
+        case 'M':
+            valid = parseSize(optarg, &geometry.physical_memory);
+            break;
+        case 'A':
+            geometry.address_bits = (unsigned int)strtoul(optarg, &end, 10);
+            valid = end != optarg && *end == '\0';
+            break;
+        case 'H':
+            geometry.huge_pages = true;
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "Usage: %s [-p fifo|clock|lru|arc] [-T flat|radix|hashed] [-P page_size] [-M memory_size] "
+                            "[-A address_bits] [-H] [script]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    const char *problem = validateMemoryGeometry(&geometry);
+    if (problem == NULL && geometry.huge_pages && layout != PAGE_TABLE_RADIX) {
+        problem = "huge pages need radix page tables (-T radix)";
+    }
+    if (problem != NULL) {
+        fprintf(stderr, "%s: %s\n", argv[0], problem);
+        exit(EXIT_FAILURE);
+    }
+
     // Initialize the virtual memory manager and the scheduler for the shell.
-    initializeVMM();
+    arenaInit(&lineArena);
+    initializeBuiltins();
+    initializeJobs();
+    initializeTrace();
+    initializeVMM(&geometry, policy, layout);
+    initializeProcessRegistry();
     initialize_scheduler();
+    atexit(closeAppendCache);
 
     // Check if any arguments (like a filename) were passed to the shell at launch.
-    if (argc > 1) {
+    if (optind < argc) {
         // Execute commands from a file if a filename is provided.
-        createFileProcess(argv, argv[1]);
+        if (!executeScriptFile(argv[optind])) {
+            perror("argument file does not exist");
+            exit(EXIT_FAILURE);
+        }
     }
 
+    // The input buffer is reused across iterations; getline only grows it for longer lines.
+    char *inputCommand = NULL;
+    size_t commandSize = 0;
+    bool interactive = isatty(STDIN_FILENO);
+
     // Main loop of the shell: continuously prompt for and process commands.
     while (true) {
-        char *inputCommand = NULL;
-        size_t commandSize = 0;
         ssize_t charsRead = 0;
 
+        // Report background jobs that finished since the last prompt.
+        reapJobs();
+
+        // Commit buffered writeline output that is due, or all of it before waiting on a terminal.
+        if (interactive) {
+            flushAppendCache();
+        } else {
+            tickAppendCache();
+        }
+
         // Display the shell prompt and read a line of input from the user.
         printf("%s", SHELL_NAME);
         charsRead = getline(&inputCommand, &commandSize, stdin);
 
-        // If the input is valid (not EOF), process the command.
+        // Treat end of input like the quit command.
+        if (charsRead < 0) {
+            printf("\nExiting shell...\n");
+            break;
+        }
+
+        // If the input is valid, process the command.
         if (charsRead > 0) {
             runCommand(inputCommand);
         }
 
-        // Free the memory allocated for the input command.
-        free(inputCommand);
-
         // Execute the scheduler to manage processes.
         execute_scheduler();
     }
-    // Return 0 from main (though in this case, the loop is infinite).
+
+    free(inputCommand);
+    arenaDestroy(&lineArena);
+    // Return 0 from main once input is exhausted.
     return 0;
 }
 
 // Function to process and execute a given command.
 void runCommand(char* inputCommand) {
-    // Split the input command into individual commands (if multiple commands are separated by semicolons).
-    char** commandList = splitCommands(inputCommand);
-    // Parse each command in the list into an array of its arguments.
-    char*** arguments = parseCommandList(commandList);
-
-    // Iterate through each command in the command list.
-    for (int i = 0; arguments && arguments[i] != NULL; i++) {
-        // Check if the command is to create a process.
-        if (strcmp(arguments[i][0], CMD_CREATE_PROCESS) == 0) {
-            handleCreateProcessCommand(arguments[i]);
+    // Everything allocated for this line is released back to the mark on return. A mark is
+    // used instead of a full reset so that nested calls (e.g. from script files) are safe.
+    ArenaMark lineMark = arenaMark(&lineArena);
+
+    // Tokenize the line in place into one pipeline per semicolon-separated command.
+    CommandList commandList;
+    parseCommandList(&lineArena, inputCommand, &commandList);
+
+    // Dispatch each command: background commands become jobs, multi-stage pipelines run all
+    // stages concurrently, builtins run through the registry, and anything else as a new process.
+    for (size_t i = 0; i < commandList.numCommands; i++) {
+        Command *command = &commandList.commands[i];
+        if (command->background) {
+            startBackgroundJob(command->stages, command->numStages);
             continue;
         }
-
-        // Check if the command is a built-in command and execute it if it is.
-        if (checkAdditionalCommands(arguments[i]) == 1) {
-            continue; // Skip to the next command if it was a built-in command.
-        } else {
-            // If not a built-in command, create a process to execute it.
-            createCommandProcess(arguments[i]);
+        if (command->numStages > 1) {
+            runPipeline(command->stages, command->numStages);
+            continue;
         }
-    }
-
-    // Clean up: free the memory allocated for the command list and its arguments.
-    for (int i = 0; commandList && commandList[i] != NULL; i++) {
-        free(commandList[i]);
-    }
-    free(commandList);
 
-    for (int i = 0; arguments && arguments[i] != NULL; i++) {
-        for (int j = 0; arguments[i][j] != NULL; j++) {
-            free(arguments[i][j]);
+        char **arguments = command->stages[0];
+        const BuiltinCommand *builtin = findBuiltin(arguments[0]);
+        if (builtin != NULL && builtin->restOfLine != NULL) {
+            // The command (e.g. parallel) takes over the rest of the line.
+            builtin->restOfLine(arguments, &commandList.commands[i + 1], commandList.numCommands - i - 1);
+            break;
+        } else if (builtin != NULL) {
+            builtin->handler(arguments);
+        } else {
+            createCommandProcess(arguments);
         }
-        free(arguments[i]);
     }
-    free(arguments);
-}
 
-// Function to handle the creation of a new process.
-void handleCreateProcessCommand(char** arguments) {
-    // Extract process details from arguments and create a new process
-    // For simplicity, assuming the process ID and burst time are provided as arguments
-    if (arguments[1] && arguments[2]) {
-        int process_id = atoi(arguments[1]);
-        int burst_time = atoi(arguments[2]);
-
-        Process new_process = {process_id, READY, burst_time};
-        if (!add_process(new_process)) {
-            printf("Failed to add process: %d\n", process_id);
-        }
-    }
+    // Clean up: the arguments point into inputCommand and the vectors live in the arena.
+    arenaRelease(&lineArena, lineMark);
 }
-
-
@@ -0,0 +1,689 @@
+#include "page_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_FANOUT (1 << RADIX_BITS)     // Entries per table at every level.
+#define RADIX_TABLE_BYTES (RADIX_FANOUT * sizeof(PageTableEntry))
+#define INITIAL_FLAT_CAPACITY 16
+#define INITIAL_HASH_CAPACITY 16
+#define EMPTY_SLOT UINT64_MAX
+
+// A slot of a hashed page table.
+typedef struct {
+    uint64_t page;                  // EMPTY_SLOT for an unused slot.
+    PageTableEntry entry;
+} HashedSlot;
+
+static const char *layout_names[] = { "flat", "radix", "hashed" };
+
+// Number of radix levels needed to translate a page number; level 0 is the top.
+static unsigned int radix_levels = 4;
+
+// Sets the width of page numbers, which fixes the number of radix levels.
+void configurePageTables(unsigned int page_number_bits) {
+    radix_levels = (page_number_bits + RADIX_BITS - 1) / RADIX_BITS;
+    if (radix_levels == 0) {
+        radix_levels = 1;
+    }
+}
+
+// Allocates zeroed memory, exiting if none is left.
+static void* allocateZeroed(size_t size) {
+    void *memory = calloc(1, size);
+    if (!memory) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+// Allocates a hashed slot array with every slot empty.
+static HashedSlot* allocateSlots(uint64_t capacity) {
+    HashedSlot *slots = (HashedSlot *)malloc(capacity * sizeof(HashedSlot));
+    if (!slots) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    for (uint64_t i = 0; i < capacity; i++) {
+        slots[i].page = EMPTY_SLOT;
+    }
+    return slots;
+}
+
+// Frees a flat or hashed table's array, unless it was borrowed from a loaded image.
+static void freeRoot(PageTable *table, void *root) {
+    if (!table->borrowed) {
+        free(root);
+    }
+    table->borrowed = false;
+}
+
+// Resizes a flat table's entry array, keeping the first kept entries. An array borrowed from
+// a loaded image is copied into memory of the table's own. Returns NULL if none is left.
+static PageTableEntry* resizeEntries(PageTable *table, uint64_t capacity, uint64_t kept) {
+    if (!table->borrowed) {
+        return (PageTableEntry *)realloc(table->root, capacity * sizeof(PageTableEntry));
+    }
+    PageTableEntry *entries = (PageTableEntry *)malloc(capacity * sizeof(PageTableEntry));
+    if (entries) {
+        memcpy(entries, table->root, kept * sizeof(PageTableEntry));
+        table->borrowed = false;
+    }
+    return entries;
+}
+
+// Hashes a page number to a slot (Fibonacci hashing).
+static inline uint64_t slotFor(uint64_t page, uint64_t capacity) {
+    return (page * 0x9e3779b97f4a7c15ULL >> 17) & (capacity - 1);
+}
+
+// log2 of the number of pages covered by one entry of a radix table at a level.
+static inline unsigned int radixOrder(unsigned int level) {
+    return RADIX_BITS * (radix_levels - 1 - level);
+}
+
+// Index of a page within the radix table at a level.
+static inline unsigned int radixIndex(uint64_t page, unsigned int level) {
+    return (unsigned int)(page >> radixOrder(level)) & (RADIX_FANOUT - 1);
+}
+
+// Returns the table an interior radix entry points to. Interior entries hold either a
+// table pointer, a huge page entry (PTE_HUGE set) or zero.
+static inline PageTableEntry* radixChild(PageTableEntry slot) {
+    return (PageTableEntry *)(uintptr_t)slot;
+}
+
+// Creates an empty page table with the given layout.
+void initializePageTable(PageTable *table, PageTableLayout layout) {
+    memset(table, 0, sizeof(PageTable));
+    table->layout = layout;
+    if (layout == PAGE_TABLE_HASHED) {
+        table->capacity = INITIAL_HASH_CAPACITY;
+        table->root = allocateSlots(table->capacity);
+        table->table_bytes = table->capacity * sizeof(HashedSlot);
+    }
+}
+
+// Looks a page up, setting *walk_steps to the table levels or hash slots visited.
+static inline PageTableEntry* findEntry(PageTable *table, uint64_t page, unsigned int *order, uint64_t *walk_steps) {
+    uint64_t steps = 0;
+    PageTableEntry *entry = NULL;
+    *order = 0;
+    switch (table->layout) {
+    case PAGE_TABLE_FLAT:
+        steps = 1;
+        if (page < table->capacity) {
+            entry = &((PageTableEntry *)table->root)[page];
+        }
+        break;
+    case PAGE_TABLE_RADIX: {
+        PageTableEntry *node = (PageTableEntry *)table->root;
+        for (unsigned int level = 0; node; level++) {
+            steps++;
+            PageTableEntry *slot = &node[radixIndex(page, level)];
+            // A huge entry may have its bits set by another walker meanwhile.
+            PageTableEntry value = __atomic_load_n(slot, __ATOMIC_RELAXED);
+            if (level == radix_levels - 1 || (value & PTE_HUGE)) {
+                entry = slot;
+                *order = radixOrder(level);
+                break;
+            }
+            node = radixChild(value);
+        }
+        break;
+    }
+    case PAGE_TABLE_HASHED: {
+        HashedSlot *slots = (HashedSlot *)table->root;
+        for (uint64_t slot = slotFor(page, table->capacity);; slot = (slot + 1) & (table->capacity - 1)) {
+            steps++;
+            if (slots[slot].page == page) {
+                entry = &slots[slot].entry;
+                break;
+            }
+            if (slots[slot].page == EMPTY_SLOT) {
+                break;
+            }
+        }
+        break;
+    }
+    }
+    *walk_steps = steps;
+    return entry;
+}
+
+// Walks the table for a page. Returns NULL if the page has no entry yet.
+PageTableEntry* walkPageTable(PageTable *table, uint64_t page, unsigned int *order) {
+    uint64_t steps;
+    PageTableEntry *entry = findEntry(table, page, order, &steps);
+    table->walks++;
+    table->walk_steps += steps;
+    return entry;
+}
+
+// Like walkPageTable, for walks that may run on several threads at once; the table must
+// not change meanwhile. The walk counters are updated atomically.
+PageTableEntry* walkPageTableShared(PageTable *table, uint64_t page, unsigned int *order) {
+    uint64_t steps;
+    PageTableEntry *entry = findEntry(table, page, order, &steps);
+    __atomic_fetch_add(&table->walks, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->walk_steps, steps, __ATOMIC_RELAXED);
+    return entry;
+}
+
+// Like walkPageTable, without counting the lookup as a walk.
+PageTableEntry* findPageTableEntry(PageTable *table, uint64_t page, unsigned int *order) {
+    uint64_t steps;
+    return findEntry(table, page, order, &steps);
+}
+
+// Doubles a hashed table and reinserts its entries.
+static void growHashedTable(PageTable *table) {
+    uint64_t capacity = table->capacity * 2;
+    HashedSlot *old_slots = (HashedSlot *)table->root;
+    HashedSlot *slots = allocateSlots(capacity);
+    for (uint64_t i = 0; i < table->capacity; i++) {
+        if (old_slots[i].page != EMPTY_SLOT) {
+            uint64_t slot = slotFor(old_slots[i].page, capacity);
+            while (slots[slot].page != EMPTY_SLOT) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            slots[slot] = old_slots[i];
+        }
+    }
+    freeRoot(table, old_slots);
+    table->root = slots;
+    table->capacity = capacity;
+    table->table_bytes = capacity * sizeof(HashedSlot);
+}
+
+// Splits a huge entry that is not resident into a table for the level below. A huge page in
+// swap becomes one entry per part, each pointing to its part of the page's slots.
+static PageTableEntry* splitHugeEntry(PageTable *table, PageTableEntry huge_entry, unsigned int level) {
+    PageTableEntry *child = (PageTableEntry *)allocateZeroed(RADIX_TABLE_BYTES);
+    table->table_bytes += RADIX_TABLE_BYTES;
+    table->huge_mappings--;
+    if (huge_entry & PTE_SWAPPED) {
+        PageTableEntry flags = PTE_SWAPPED | (level + 1 < radix_levels - 1 ? PTE_HUGE : 0);
+        for (unsigned int i = 0; i < RADIX_FANOUT; i++) {
+            child[i] = pteWithFrame(flags, pteFrame(huge_entry) + ((uint64_t)i << radixOrder(level + 1)));
+        }
+        if (flags & PTE_HUGE) {
+            table->huge_mappings += RADIX_FANOUT;
+        }
+    }
+    return child;
+}
+
+// Walks a radix table from the top down to the entry at target_level for a page, creating
+// missing tables on the way. A huge entry above the target level can only be met when it
+// is not resident (callers check), and is split.
+static PageTableEntry* radixPath(PageTable *table, uint64_t page, unsigned int target_level) {
+    if (!table->root) {
+        table->root = allocateZeroed(RADIX_TABLE_BYTES);
+        table->table_bytes += RADIX_TABLE_BYTES;
+    }
+    PageTableEntry *node = (PageTableEntry *)table->root;
+    for (unsigned int level = 0; level < target_level; level++) {
+        PageTableEntry *slot = &node[radixIndex(page, level)];
+        if (*slot & PTE_HUGE) {
+            *slot = (PageTableEntry)(uintptr_t)splitHugeEntry(table, *slot, level);
+        } else if (!*slot) {
+            *slot = (PageTableEntry)(uintptr_t)allocateZeroed(RADIX_TABLE_BYTES);
+            table->table_bytes += RADIX_TABLE_BYTES;
+        }
+        node = radixChild(*slot);
+    }
+    return &node[radixIndex(page, target_level)];
+}
+
+// Returns the entry of a page, creating an empty one if it has none. A flat table grows
+// geometrically to cover the page; a radix table allocates the missing tables on the path.
+PageTableEntry* createPageTableEntry(PageTable *table, uint64_t page) {
+    if (table->layout == PAGE_TABLE_RADIX) {
+        return radixPath(table, page, radix_levels - 1);
+    }
+
+    unsigned int order;
+    uint64_t steps;
+    PageTableEntry *entry = findEntry(table, page, &order, &steps);
+    if (entry) {
+        return entry;
+    }
+
+    if (table->layout == PAGE_TABLE_FLAT) {
+        uint64_t capacity = table->capacity ? table->capacity : INITIAL_FLAT_CAPACITY;
+        while (capacity <= page) {
+            capacity *= 2;
+        }
+        if (capacity > table->num_pages && table->num_pages > page) {
+            capacity = table->num_pages;
+        }
+        PageTableEntry *entries = resizeEntries(table, capacity, table->capacity);
+        if (!entries) {
+            perror("Failed to allocate additional page table entries");
+            exit(EXIT_FAILURE);
+        }
+        memset(&entries[table->capacity], 0, (capacity - table->capacity) * sizeof(PageTableEntry));
+        table->root = entries;
+        table->capacity = capacity;
+        table->table_bytes = capacity * sizeof(PageTableEntry);
+        return &entries[page];
+    }
+
+    if ((table->count + 1) * 2 > table->capacity) {
+        growHashedTable(table);
+    }
+    HashedSlot *slots = (HashedSlot *)table->root;
+    uint64_t slot = slotFor(page, table->capacity);
+    while (slots[slot].page != EMPTY_SLOT) {
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    slots[slot].page = page;
+    slots[slot].entry = 0;
+    table->count++;
+    return &slots[slot].entry;
+}
+
+// Returns the radix level whose entries map 2^order pages, or -1 if there is none above
+// the bottom level.
+static int hugeLevel(unsigned int order) {
+    if (order == 0 || order % RADIX_BITS != 0 || order / RADIX_BITS >= radix_levels) {
+        return -1;
+    }
+    return (int)(radix_levels - 1 - order / RADIX_BITS);
+}
+
+// Returns true if the 2^order pages starting at base could be mapped by one huge entry.
+bool canMapHugePage(PageTable *table, uint64_t base, unsigned int order) {
+    int target_level = hugeLevel(order);
+    if (table->layout != PAGE_TABLE_RADIX || target_level < 0) {
+        return false;
+    }
+    PageTableEntry *node = (PageTableEntry *)table->root;
+    for (int level = 0; node; level++) {
+        PageTableEntry slot = node[radixIndex(base, (unsigned int)level)];
+        if (slot & PTE_HUGE) {
+            // A larger huge page can be split only if it is not resident.
+            return level == target_level || !(slot & PTE_VALID);
+        }
+        if (level == target_level) {
+            return slot == 0;
+        }
+        node = radixChild(slot);
+    }
+    return true;
+}
+
+// Returns the huge entry mapping the 2^order pages starting at base, creating it if needed.
+PageTableEntry* createHugePageTableEntry(PageTable *table, uint64_t base, unsigned int order) {
+    PageTableEntry *entry = radixPath(table, base, (unsigned int)hugeLevel(order));
+    if (!(*entry & PTE_HUGE)) {
+        *entry = PTE_HUGE;
+        table->huge_mappings++;
+    }
+    return entry;
+}
+
+// Drops the part of a radix subtree at or above first_page. node covers the pages starting
+// at base at the given level. Returns true if the whole table was freed.
+static bool truncateRadix(PageTable *table, PageTableEntry *node, unsigned int level, uint64_t base, uint64_t first_page,
+                          void (*release)(void *, uint64_t, PageTableEntry *, unsigned int), void *context) {
+    unsigned int order = radixOrder(level);
+    uint64_t span = 1ULL << order;          // Pages per entry.
+    bool keep = false;
+    for (unsigned int i = 0; i < RADIX_FANOUT; i++) {
+        uint64_t entry_base = base + i * span;
+        PageTableEntry *slot = &node[i];
+        if (entry_base + span <= first_page) {
+            keep = keep || *slot != 0;
+        } else if (level == radix_levels - 1 || (*slot & PTE_HUGE)) {
+            if (pteHoldsPage(*slot)) {
+                release(context, entry_base, slot, order);
+            }
+            if (*slot & PTE_HUGE) {
+                table->huge_mappings--;
+            }
+            *slot = 0;
+        } else if (*slot) {
+            if (truncateRadix(table, radixChild(*slot), level + 1, entry_base, first_page, release, context)) {
+                *slot = 0;
+            } else {
+                keep = true;
+            }
+        }
+    }
+    if (!keep) {
+        free(node);
+        table->table_bytes -= RADIX_TABLE_BYTES;
+    }
+    return !keep;
+}
+
+// Shrinks the address space to num_pages, calling release for every entry dropped that
+// holds a page.
+// Growing only changes the size; entries appear when pages are first accessed.
+void truncatePageTable(PageTable *table, uint64_t num_pages,
+                       void (*release)(void *context, uint64_t page, PageTableEntry *entry, unsigned int order), void *context) {
+    if (num_pages >= table->num_pages) {
+        table->num_pages = num_pages;
+        return;
+    }
+    table->num_pages = num_pages;
+
+    switch (table->layout) {
+    case PAGE_TABLE_FLAT: {
+        PageTableEntry *entries = (PageTableEntry *)table->root;
+        for (uint64_t page = num_pages; page < table->capacity; page++) {
+            if (pteHoldsPage(entries[page])) {
+                release(context, page, &entries[page], 0);
+            }
+        }
+        if (num_pages < table->capacity) {
+            // Give back the memory above the new end of the table.
+            table->capacity = num_pages;
+            table->table_bytes = num_pages * sizeof(PageTableEntry);
+            if (num_pages == 0) {
+                freeRoot(table, entries);
+                table->root = NULL;
+            } else {
+                table->root = resizeEntries(table, num_pages, num_pages);
+                if (!table->root) {
+                    perror("Failed to reallocate the page table entries");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+        break;
+    }
+    case PAGE_TABLE_RADIX:
+        if (table->root && truncateRadix(table, (PageTableEntry *)table->root, 0, 0, num_pages, release, context)) {
+            table->root = NULL;
+        }
+        break;
+    case PAGE_TABLE_HASHED: {
+        // Rebuild the table from the entries that stay.
+        HashedSlot *old_slots = (HashedSlot *)table->root;
+        uint64_t old_capacity = table->capacity;
+        bool borrowed = table->borrowed;
+        table->borrowed = false;
+        table->capacity = INITIAL_HASH_CAPACITY;
+        table->count = 0;
+        table->root = allocateSlots(table->capacity);
+        table->table_bytes = table->capacity * sizeof(HashedSlot);
+        for (uint64_t i = 0; i < old_capacity; i++) {
+            if (old_slots[i].page == EMPTY_SLOT) {
+                continue;
+            }
+            if (old_slots[i].page >= num_pages) {
+                if (pteHoldsPage(old_slots[i].entry)) {
+                    release(context, old_slots[i].page, &old_slots[i].entry, 0);
+                }
+            } else {
+                *createPageTableEntry(table, old_slots[i].page) = old_slots[i].entry;
+            }
+        }
+        if (!borrowed) {
+            free(old_slots);
+        }
+        break;
+    }
+    }
+}
+
+// Visits the entries holding a page in a radix table and the tables below it. node covers the pages
+// starting at base at the given level.
+static void visitRadix(PageTableEntry *node, unsigned int level, uint64_t base,
+                       void (*visit)(void *, uint64_t, PageTableEntry *, unsigned int), void *context) {
+    unsigned int order = radixOrder(level);
+    for (unsigned int i = 0; i < RADIX_FANOUT; i++) {
+        uint64_t entry_base = base + ((uint64_t)i << order);
+        if (level == radix_levels - 1 || (node[i] & PTE_HUGE)) {
+            if (pteHoldsPage(node[i])) {
+                visit(context, entry_base, &node[i], order);
+            }
+        } else if (node[i]) {
+            visitRadix(radixChild(node[i]), level + 1, entry_base, visit, context);
+        }
+    }
+}
+
+// Calls visit for every entry holding a page, in no particular order.
+void forEachStoredPage(PageTable *table, void (*visit)(void *context, uint64_t page, PageTableEntry *entry, unsigned int order),
+                         void *context) {
+    switch (table->layout) {
+    case PAGE_TABLE_FLAT: {
+        PageTableEntry *entries = (PageTableEntry *)table->root;
+        for (uint64_t page = 0; page < table->capacity; page++) {
+            if (pteHoldsPage(entries[page])) {
+                visit(context, page, &entries[page], 0);
+            }
+        }
+        break;
+    }
+    case PAGE_TABLE_RADIX:
+        if (table->root) {
+            visitRadix((PageTableEntry *)table->root, 0, 0, visit, context);
+        }
+        break;
+    case PAGE_TABLE_HASHED: {
+        HashedSlot *slots = (HashedSlot *)table->root;
+        for (uint64_t i = 0; i < table->capacity; i++) {
+            if (slots[i].page != EMPTY_SLOT && pteHoldsPage(slots[i].entry)) {
+                visit(context, slots[i].page, &slots[i].entry, 0);
+            }
+        }
+        break;
+    }
+    }
+}
+
+// Frees a radix table and every table below it.
+static void freeRadix(PageTableEntry *node, unsigned int level) {
+    if (level < radix_levels - 1) {
+        for (unsigned int i = 0; i < RADIX_FANOUT; i++) {
+            if (node[i] && !(node[i] & PTE_HUGE)) {
+                freeRadix(radixChild(node[i]), level + 1);
+            }
+        }
+    }
+    free(node);
+}
+
+// Frees the table.
+void destroyPageTable(PageTable *table) {
+    if (table->layout == PAGE_TABLE_RADIX && table->root) {
+        freeRadix((PageTableEntry *)table->root, 0);
+    } else {
+        freeRoot(table, table->root);
+    }
+    table->root = NULL;
+    table->capacity = table->count = table->table_bytes = table->huge_mappings = 0;
+}
+
+// A page table as saved in an image, followed by a section holding its entry array (flat),
+// slot array (hashed) or tables (radix). Radix tables are stored in breadth-first order,
+// with each pointer to a table replaced by that table's index.
+typedef struct {
+    uint64_t layout;
+    uint64_t num_pages;
+    uint64_t capacity;
+    uint64_t count;
+    uint64_t table_bytes;
+    uint64_t huge_mappings;
+    uint64_t walks;
+    uint64_t walk_steps;
+} SavedPageTable;
+
+// A radix table waiting to be written, with its level.
+typedef struct {
+    PageTableEntry *node;
+    unsigned int level;
+} PendingNode;
+
+// Writes the tables of a radix page table breadth first, numbering each table as it is
+// queued. A table's number is kept in the frame field of the entry pointing to it, clear of
+// the flag bits, as a pointer's low bits are.
+static void saveRadix(ImageWriter *writer, const PageTable *table) {
+    uint64_t num_nodes = table->table_bytes / RADIX_TABLE_BYTES;
+    beginImageSection(writer, SECTION_PAGE_TABLE, table->table_bytes);
+    if (num_nodes == 0) {
+        endImageSection(writer);
+        return;
+    }
+    PendingNode *queue = (PendingNode *)malloc(num_nodes * sizeof(PendingNode));
+    if (!queue) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    PageTableEntry copy[RADIX_FANOUT];
+    queue[0] = (PendingNode){ (PageTableEntry *)table->root, 0 };
+    uint64_t queued = 1;
+    for (uint64_t i = 0; i < queued && !writer->failed; i++) {
+        memcpy(copy, queue[i].node, RADIX_TABLE_BYTES);
+        for (unsigned int j = 0; queue[i].level < radix_levels - 1 && j < RADIX_FANOUT; j++) {
+            if (copy[j] && !(copy[j] & PTE_HUGE)) {
+                if (queued == num_nodes) {
+                    writer->failed = true;
+                    break;
+                }
+                queue[queued] = (PendingNode){ radixChild(copy[j]), queue[i].level + 1 };
+                copy[j] = pteWithFrame(0, queued++);
+            }
+        }
+        writeImageData(writer, copy, RADIX_TABLE_BYTES);
+    }
+    free(queue);
+    endImageSection(writer);
+}
+
+// Writes a page table to an image.
+void savePageTable(ImageWriter *writer, const PageTable *table) {
+    SavedPageTable saved = { table->layout, table->num_pages, table->capacity, table->count, table->table_bytes,
+                             table->huge_mappings, table->walks, table->walk_steps };
+    writeImageSection(writer, SECTION_PAGE_TABLE, &saved, sizeof(saved));
+    switch (table->layout) {
+    case PAGE_TABLE_FLAT:
+        writeImageSection(writer, SECTION_PAGE_TABLE, table->root, table->capacity * sizeof(PageTableEntry));
+        break;
+    case PAGE_TABLE_RADIX:
+        saveRadix(writer, table);
+        break;
+    case PAGE_TABLE_HASHED:
+        writeImageSection(writer, SECTION_PAGE_TABLE, table->root, table->capacity * sizeof(HashedSlot));
+        break;
+    }
+}
+
+// Rebuilds a radix table from the tables of an image, in breadth-first order. Each pointer
+// must name the next table not yet reached, so every table is used exactly once. Returns
+// false, freeing what was built, if they do not.
+static bool loadRadix(PageTable *table, const PageTableEntry *saved_nodes, uint64_t num_nodes) {
+    if (num_nodes == 0) {
+        return true;
+    }
+    PendingNode *nodes = (PendingNode *)malloc(num_nodes * sizeof(PendingNode));
+    if (!nodes) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    nodes[0] = (PendingNode){ (PageTableEntry *)malloc(RADIX_TABLE_BYTES), 0 };
+    uint64_t built = 1;
+    bool valid = nodes[0].node != NULL;
+    for (uint64_t i = 0; i < built && valid; i++) {
+        PageTableEntry *node = nodes[i].node;
+        memcpy(node, &saved_nodes[i * RADIX_FANOUT], RADIX_TABLE_BYTES);
+        for (unsigned int j = 0; nodes[i].level < radix_levels - 1 && j < RADIX_FANOUT; j++) {
+            if (!node[j] || (node[j] & PTE_HUGE)) {
+                continue;
+            }
+            if (node[j] != pteWithFrame(0, built) || built == num_nodes) {
+                valid = false;
+                break;
+            }
+            PageTableEntry *child = (PageTableEntry *)malloc(RADIX_TABLE_BYTES);
+            if (!child) {
+                perror("memory allocation error");
+                exit(EXIT_FAILURE);
+            }
+            nodes[built++] = (PendingNode){ child, nodes[i].level + 1 };
+            node[j] = (PageTableEntry)(uintptr_t)child;
+        }
+    }
+    if (!valid || built != num_nodes) {
+        for (uint64_t i = 0; i < built; i++) {
+            free(nodes[i].node);
+        }
+        free(nodes);
+        return false;
+    }
+    table->root = nodes[0].node;
+    free(nodes);
+    return true;
+}
+
+// Restores a page table from an image.
+bool loadPageTable(ImageReader *reader, PageTable *table) {
+    const SavedPageTable *saved = (const SavedPageTable *)readImageSection(reader, SECTION_PAGE_TABLE, sizeof(SavedPageTable));
+    if (!saved || saved->layout > PAGE_TABLE_HASHED) {
+        return false;
+    }
+    memset(table, 0, sizeof(PageTable));
+    table->layout = (PageTableLayout)saved->layout;
+    table->num_pages = saved->num_pages;
+    table->capacity = saved->capacity;
+    table->count = saved->count;
+    table->table_bytes = saved->table_bytes;
+    table->huge_mappings = saved->huge_mappings;
+    table->walks = saved->walks;
+    table->walk_steps = saved->walk_steps;
+
+    switch (table->layout) {
+    case PAGE_TABLE_FLAT:
+        if (table->capacity > UINT64_MAX / sizeof(PageTableEntry)) {
+            return false;
+        }
+        table->root = readImageSection(reader, SECTION_PAGE_TABLE, table->capacity * sizeof(PageTableEntry));
+        if (!table->root) {
+            return false;
+        }
+        // An empty table has no array.
+        table->borrowed = table->capacity > 0;
+        if (!table->borrowed) {
+            table->root = NULL;
+        }
+        return true;
+    case PAGE_TABLE_RADIX: {
+        if (table->table_bytes % RADIX_TABLE_BYTES != 0) {
+            return false;
+        }
+        const PageTableEntry *nodes = (const PageTableEntry *)readImageSection(reader, SECTION_PAGE_TABLE, table->table_bytes);
+        return nodes && loadRadix(table, nodes, table->table_bytes / RADIX_TABLE_BYTES);
+    }
+    case PAGE_TABLE_HASHED:
+        if (table->capacity == 0 || (table->capacity & (table->capacity - 1)) != 0 || table->count * 2 > table->capacity ||
+            table->capacity > UINT64_MAX / sizeof(HashedSlot)) {
+            return false;
+        }
+        table->root = readImageSection(reader, SECTION_PAGE_TABLE, table->capacity * sizeof(HashedSlot));
+        table->borrowed = true;
+        return table->root != NULL;
+    }
+    return false;
+}
+
+// Returns the name of a layout.
+const char* pageTableLayoutName(PageTableLayout layout) {
+    return layout_names[layout];
+}
+
+// Parses a layout name (flat, radix or hashed).
+bool parsePageTableLayout(const char* name, PageTableLayout* layout) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, layout_names[i]) == 0) {
+            *layout = (PageTableLayout)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include "checkpoint.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// A page table entry, packed into 64 bits: flags in the low bits and the frame number above
+// PTE_FRAME_SHIFT, leaving room for any frame count the simulator can represent.
+typedef uint64_t PageTableEntry;
+
+#define PTE_VALID       (1ULL << 0)     // The page is in physical memory.
+#define PTE_DIRTY       (1ULL << 1)     // The page has been modified.
+#define PTE_ACCESSED    (1ULL << 2)     // The page has been accessed.
+#define PTE_HUGE        (1ULL << 3)     // Radix tables: the entry maps a huge page instead of a table.
+#define PTE_COW         (1ULL << 4)     // The frame is shared after a fork; a write must copy it.
+#define PTE_SWAPPED     (1ULL << 5)     // Not valid: the page is in swap, at the slot in the frame field.
+#define PTE_FRAME_SHIFT 12
+
+// Returns the frame number of an entry.
+static inline uint64_t pteFrame(PageTableEntry entry) {
+    return entry >> PTE_FRAME_SHIFT;
+}
+
+// Returns true if an entry holds a page, in memory or in swap. A huge page in swap occupies
+// consecutive slots, one per page.
+static inline bool pteHoldsPage(PageTableEntry entry) {
+    return (entry & (PTE_VALID | PTE_SWAPPED)) != 0;
+}
+
+// Returns an entry with the frame number replaced.
+static inline PageTableEntry pteWithFrame(PageTableEntry entry, uint64_t frame) {
+    return (entry & ((1ULL << PTE_FRAME_SHIFT) - 1)) | (frame << PTE_FRAME_SHIFT);
+}
+
+// Each radix table level translates this many bits of the page number.
+#define RADIX_BITS 9
+
+// Ways of organizing a page table.
+typedef enum {
+    PAGE_TABLE_FLAT,                // One array indexed by page number.
+    PAGE_TABLE_RADIX,               // Levels of 512-entry tables, as on x86-64.
+    PAGE_TABLE_HASHED               // Open-addressing hash table keyed by page number.
+} PageTableLayout;
+
+// Structure to represent a page table. Entries exist only for pages that have been
+// accessed, so memory use follows the pages touched rather than the highest address.
+typedef struct {
+    PageTableLayout layout;
+    uint64_t num_pages;             // Number of pages in the address space.
+    void *root;                     // Flat: entry array. Radix: top-level table. Hashed: slot array.
+    uint64_t capacity;              // Flat: entries allocated. Hashed: slots allocated.
+    uint64_t count;                 // Hashed: slots in use.
+    uint64_t table_bytes;           // Memory used by the table itself.
+    uint64_t huge_mappings;         // Radix: entries mapping a huge page.
+    uint64_t walks;                 // Lookups that walked the table.
+    uint64_t walk_steps;            // Table levels or hash slots visited by those walks.
+    bool borrowed;                  // Flat and hashed: root lies in a loaded image and is never freed.
+} PageTable;
+
+// Sets the width of page numbers, which fixes the number of radix levels. Called once at
+// startup, before any table is created.
+void configurePageTables(unsigned int page_number_bits);
+
+// Creates an empty page table with the given layout.
+void initializePageTable(PageTable *table, PageTableLayout layout);
+
+// Walks the table for a page. Returns NULL if the page has no entry yet. *order is set to
+// log2 of the number of pages the entry maps: 0, or more for a huge page.
+PageTableEntry* walkPageTable(PageTable *table, uint64_t page, unsigned int *order);
+
+// Like walkPageTable, for walks that may run on several threads at once while the table
+// does not change. The walk counters are updated atomically.
+PageTableEntry* walkPageTableShared(PageTable *table, uint64_t page, unsigned int *order);
+
+// Like walkPageTable, without counting the lookup as a walk.
+PageTableEntry* findPageTableEntry(PageTable *table, uint64_t page, unsigned int *order);
+
+// Returns the entry of a page, creating an empty one if it has none.
+PageTableEntry* createPageTableEntry(PageTable *table, uint64_t page);
+
+// Returns true if the 2^order pages starting at base could be mapped by one huge entry:
+// the table is a radix table with a level of that size, and the range has not been split
+// into smaller mappings.
+bool canMapHugePage(PageTable *table, uint64_t base, unsigned int order);
+
+// Returns the huge entry mapping the 2^order pages starting at base, creating it if needed.
+// canMapHugePage must have returned true.
+PageTableEntry* createHugePageTableEntry(PageTable *table, uint64_t base, unsigned int order);
+
+// Shrinks the address space to num_pages, calling release for every entry dropped that
+// holds a page. A huge page that straddles the new end is dropped whole.
+void truncatePageTable(PageTable *table, uint64_t num_pages,
+                       void (*release)(void *context, uint64_t page, PageTableEntry *entry, unsigned int order), void *context);
+
+// Calls visit for every entry holding a page, in memory or in swap, in no particular order.
+void forEachStoredPage(PageTable *table, void (*visit)(void *context, uint64_t page, PageTableEntry *entry, unsigned int order),
+                         void *context);
+
+// Frees the table.
+void destroyPageTable(PageTable *table);
+
+// Writes a table to an image, or restores one from it. Flat and hashed tables are used in
+// place, borrowing the image's memory until they are resized; radix tables are rebuilt.
+// loadPageTable returns false if the image does not hold a valid table.
+void savePageTable(ImageWriter *writer, const PageTable *table);
+bool loadPageTable(ImageReader *reader, PageTable *table);
+
+// Returns the name of a layout, or parses one (flat, radix or hashed).
+const char* pageTableLayoutName(PageTableLayout layout);
+bool parsePageTableLayout(const char* name, PageTableLayout* layout);
+
+#endif // PAGE_TABLE_H
@@ -0,0 +1,309 @@
+#define _GNU_SOURCE
+#include "parallel.h"
+#include "arena.h"
+#include "jobs.h"
+#include "pipe_io.h"
+#include "pipeline.h"
+#include "script_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Finished commands may wait this many commands ahead of the oldest unfinished one before
+// new commands are held back, which bounds the number of buffered outputs (and open fds).
+#define MIN_REORDER_WINDOW 256
+
+// State of one command in a parallel batch.
+typedef struct {
+    int outputFd;               // Memory file capturing the command's standard output.
+    size_t numLive;             // Processes of the command's pipeline still running.
+    int status;                 // Wait status of the pipeline's last stage.
+    pid_t lastProcessID;        // Pid of the pipeline's last stage.
+    bool finished;
+} ParallelTask;
+
+// A running process and the task it belongs to.
+typedef struct {
+    pid_t processID;
+    size_t task;
+} ParallelSlot;
+
+// Parses `-j N` and `-t` from the start of an argument vector (arguments[0] is the command
+// name). Returns the index of the first argument after the options, or -1 on a usage error.
+int parseParallelOptions(char** arguments, ParallelOptions* options) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    options->maxJobs = processors > 0 ? (size_t)processors : 1;
+    options->tagOutput = false;
+
+    int i = 1;
+    for (; arguments[i] != NULL && arguments[i][0] == '-'; i++) {
+        if (strcmp(arguments[i], "-j") == 0 && arguments[i + 1] != NULL) {
+            int jobs = atoi(arguments[++i]);
+            if (jobs <= 0) {
+                return -1;
+            }
+            options->maxJobs = (size_t)jobs;
+        } else if (strcmp(arguments[i], "-t") == 0) {
+            options->tagOutput = true;
+        } else {
+            return -1;
+        }
+    }
+    return i;
+}
+
+// Copies a finished command's captured output to standard output. In tagged mode every line
+// is prefixed with the command's number.
+static void emitOutput(ParallelTask* task, size_t index, const ParallelOptions* options) {
+    struct stat info;
+    if (fstat(task->outputFd, &info) == 0 && info.st_size > 0) {
+        fflush(stdout);
+        if (!options->tagOutput) {
+            off_t offset = 0;
+            while (offset < info.st_size) {
+                ssize_t sent = sendfile(STDOUT_FILENO, task->outputFd, &offset, (size_t)(info.st_size - offset));
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    // sendfile refuses some targets (e.g. O_APPEND files); copy through a buffer.
+                    char buffer[64 * 1024];
+                    ssize_t numRead;
+                    while ((numRead = pread(task->outputFd, buffer, sizeof(buffer), offset)) > 0 &&
+                           writeAll(STDOUT_FILENO, buffer, (size_t)numRead)) {
+                        offset += numRead;
+                    }
+                    break;
+                }
+            }
+        } else {
+            char *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, task->outputFd, 0);
+            if (data != MAP_FAILED) {
+                char *line = data;
+                char *end = data + info.st_size;
+                while (line < end) {
+                    char *newline = memchr(line, '\n', (size_t)(end - line));
+                    size_t length = newline ? (size_t)(newline - line) + 1 : (size_t)(end - line);
+                    printf("[%zu] %.*s%s", index + 1, (int)length, line, newline ? "" : "\n");
+                    line += length;
+                }
+                munmap(data, (size_t)info.st_size);
+            }
+        }
+    }
+    close(task->outputFd);
+    task->outputFd = -1;
+}
+
+// Runs a batch of commands with at most options->maxJobs running at once. Commands are
+// taken from the list in order as slots free up. Each command's output is captured and
+// written out whole, either in input order or, with tagging, as soon as it finishes.
+// Builtins in the batch run in a child copy of the shell, like pipeline stages.
+void runParallel(Command* commands, size_t numCommands, const ParallelOptions* options) {
+    if (numCommands == 0) {
+        return;
+    }
+
+    size_t maxStages = 1;
+    for (size_t i = 0; i < numCommands; i++) {
+        if (commands[i].numStages > maxStages) {
+            maxStages = commands[i].numStages;
+        }
+    }
+
+    ParallelTask *tasks = calloc(numCommands, sizeof(ParallelTask));
+    ParallelSlot *slots = malloc(sizeof(ParallelSlot) * options->maxJobs * maxStages);
+    pid_t *processIDs = malloc(sizeof(pid_t) * maxStages);
+    if (tasks == NULL || slots == NULL || processIDs == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t reorderWindow = options->maxJobs * 4 > MIN_REORDER_WINDOW ? options->maxJobs * 4 : MIN_REORDER_WINDOW;
+    size_t nextTask = 0;        // Next command to start.
+    size_t nextOutput = 0;      // Next command whose output is due (ordered mode).
+    size_t numRunning = 0;      // Commands currently running.
+    size_t numSlots = 0;        // Processes currently running.
+    size_t numFailed = 0;
+
+    fflush(stdout);
+    while (nextOutput < numCommands) {
+        // Fill free slots from the work queue.
+        while (nextTask < numCommands && numRunning < options->maxJobs &&
+               (options->tagOutput || nextTask - nextOutput < reorderWindow)) {
+            ParallelTask *task = &tasks[nextTask];
+            Command *command = &commands[nextTask];
+            task->outputFd = memfd_create("parallel-output", MFD_CLOEXEC);
+            if (task->outputFd < 0) {
+                perror("memfd_create failed");
+                task->finished = true;
+                task->status = EXIT_FAILURE << 8;
+                numFailed++;
+                nextTask++;
+                continue;
+            }
+
+            int outputFd = dup(task->outputFd);
+            int inputFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            size_t numStarted = startPipeline(command->stages, command->numStages, inputFd, outputFd, -1, processIDs);
+            for (size_t i = 0; i < numStarted; i++) {
+                slots[numSlots].processID = processIDs[i];
+                slots[numSlots].task = nextTask;
+                numSlots++;
+            }
+            task->numLive = numStarted;
+            task->lastProcessID = numStarted > 0 ? processIDs[numStarted - 1] : -1;
+            if (numStarted == 0) {
+                task->finished = true;
+                task->status = 127 << 8;
+                numFailed++;
+                if (options->tagOutput) {
+                    emitOutput(task, nextTask, options);
+                }
+            } else {
+                numRunning++;
+            }
+            nextTask++;
+        }
+
+        // Write out finished commands: all of them when tagging, otherwise in input order.
+        if (options->tagOutput) {
+            for (; nextOutput < nextTask && tasks[nextOutput].finished && tasks[nextOutput].outputFd < 0; nextOutput++);
+        } else {
+            for (; nextOutput < nextTask && tasks[nextOutput].finished; nextOutput++) {
+                emitOutput(&tasks[nextOutput], nextOutput, options);
+            }
+        }
+        if (nextOutput >= numCommands || numSlots == 0) {
+            continue;
+        }
+
+        // Wait for any child and credit it to its command.
+        int status = 0;
+        pid_t processID = waitpid(-1, &status, 0);
+        if (processID < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("waitpid failed");
+            break;
+        }
+
+        size_t slot = 0;
+        while (slot < numSlots && slots[slot].processID != processID) {
+            slot++;
+        }
+        if (slot == numSlots) {
+            recordChildStatus(processID, status); // A background job finished meanwhile.
+            continue;
+        }
+
+        ParallelTask *task = &tasks[slots[slot].task];
+        size_t index = slots[slot].task;
+        slots[slot] = slots[--numSlots];
+        if (processID == task->lastProcessID) {
+            task->status = status;
+        }
+        if (--task->numLive == 0) {
+            task->finished = true;
+            numRunning--;
+            if (!WIFEXITED(task->status) || WEXITSTATUS(task->status) != 0) {
+                numFailed++;
+            }
+            if (options->tagOutput) {
+                emitOutput(task, index, options);
+            }
+        }
+    }
+    fflush(stdout);
+
+    if (numFailed > 0) {
+        fprintf(stderr, "parallel: %zu of %zu commands failed\n", numFailed, numCommands);
+    }
+
+    free(processIDs);
+    free(slots);
+    free(tasks);
+}
+
+// parallel [-j N] [-t] [command ...]; [command ...] ...
+// Runs the command given after the options together with the commands that follow it on
+// the same line as one parallel batch.
+void runParallelCommand(char** arguments, Command* following, size_t numFollowing) {
+    ParallelOptions options;
+    int firstArgument = parseParallelOptions(arguments, &options);
+    if (firstArgument < 0) {
+        printf("Usage: %s [-j jobs] [-t] command [; command ...]\n", arguments[0]);
+        return;
+    }
+
+    Command *commands = malloc(sizeof(Command) * (numFollowing + 1));
+    if (commands == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    size_t numCommands = 0;
+    char **firstStages[2] = { &arguments[firstArgument], NULL };
+    if (arguments[firstArgument] != NULL) {
+        commands[numCommands].stages = firstStages;
+        commands[numCommands].numStages = 1;
+        commands[numCommands].background = false;
+        numCommands++;
+    }
+    if (numFollowing > 0) {
+        memcpy(&commands[numCommands], following, sizeof(Command) * numFollowing);
+        numCommands += numFollowing;
+    }
+
+    runParallel(commands, numCommands, &options);
+    free(commands);
+}
+
+// Registry handler for parallel when it has no following commands to take over.
+void executeParallel(char** arguments) {
+    runParallelCommand(arguments, NULL, 0);
+}
+
+// Runs every command in a script file as one parallel batch (`exec -j N file`).
+void runParallelScript(const char* fileName, const ParallelOptions* options) {
+    // The whole batch is parsed before it starts, so every line must stay mapped.
+    ScriptFile script;
+    if (!openScriptFile(fileName, &script, false)) {
+        perror("argument file does not exist");
+        return;
+    }
+
+    // Parsed commands live in a private arena for the length of the batch.
+    Arena scriptArena;
+    arenaInit(&scriptArena);
+    size_t numCommands = 0;
+    size_t commandCapacity = 64;
+    Command *commands = arenaAlloc(&scriptArena, sizeof(Command) * commandCapacity);
+
+    char *line;
+    while ((line = nextScriptLine(&script)) != NULL) {
+        CommandList commandList;
+        parseCommandList(&scriptArena, line, &commandList);
+        if (numCommands + commandList.numCommands > commandCapacity) {
+            size_t newCapacity = commandCapacity;
+            while (numCommands + commandList.numCommands > newCapacity) {
+                newCapacity *= 2;
+            }
+            commands = arenaGrow(&scriptArena, commands, sizeof(Command) * commandCapacity, sizeof(Command) * newCapacity);
+            commandCapacity = newCapacity;
+        }
+        memcpy(&commands[numCommands], commandList.commands, sizeof(Command) * commandList.numCommands);
+        numCommands += commandList.numCommands;
+    }
+
+    runParallel(commands, numCommands, options);
+    arenaDestroy(&scriptArena);
+    closeScriptFile(&script);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "command_parser.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// How a batch of commands is spread over concurrent child slots.
+typedef struct {
+    size_t maxJobs;             // Number of commands allowed to run at once.
+    bool tagOutput;             // Prefix output lines with the command number instead of keeping input order.
+} ParallelOptions;
+
+int parseParallelOptions(char** arguments, ParallelOptions* options);
+void runParallel(Command* commands, size_t numCommands, const ParallelOptions* options);
+void runParallelCommand(char** arguments, Command* following, size_t numFollowing);
+void runParallelScript(const char* fileName, const ParallelOptions* options);
+void executeParallel(char** arguments);
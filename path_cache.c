@@ -0,0 +1,226 @@
+#include "path_cache.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INITIAL_CACHE_CAPACITY 64
+#define DIRECTORY_CHECK_INTERVAL_NS 1000000000L // Re-check PATH directory mtimes at most once a second.
+
+// One remembered command name and the absolute path it resolved to.
+typedef struct {
+    char *name;                 // Command name, or NULL for an empty slot.
+    char *path;                 // Resolved path.
+    unsigned int hits;          // Number of times the cached path was used.
+} PathCacheEntry;
+
+// One directory from PATH together with the modification time seen when it was scanned.
+typedef struct {
+    char *directory;
+    struct timespec mtime;
+    bool cacheable;             // Relative entries depend on the working directory and are never cached.
+} PathDirectory;
+
+// Open-addressing hash table from command name to resolved path.
+static PathCacheEntry *cacheEntries = NULL;
+static size_t cacheCapacity = 0;
+static size_t cacheSize = 0;
+
+// Parsed copy of the PATH the cache was built against.
+static char *cachedPath = NULL;
+static PathDirectory *pathDirectories = NULL;
+static size_t numPathDirectories = 0;
+static struct timespec lastDirectoryCheck;
+
+// FNV-1a hash of a command name.
+static inline uint32_t hashCommandName(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+// Aborts the shell on allocation failure, like copyString.
+static void* checkedAllocation(void* allocation) {
+    if (allocation == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return allocation;
+}
+
+// Discards every cached command path.
+void flushPathCache() {
+    for (size_t i = 0; i < cacheCapacity; i++) {
+        free(cacheEntries[i].name);
+        free(cacheEntries[i].path);
+        cacheEntries[i].name = NULL;
+        cacheEntries[i].path = NULL;
+        cacheEntries[i].hits = 0;
+    }
+    cacheSize = 0;
+}
+
+// Splits the current PATH into directories and records each directory's mtime.
+static void loadPathDirectories(const char* path) {
+    for (size_t i = 0; i < numPathDirectories; i++) {
+        free(pathDirectories[i].directory);
+    }
+    free(pathDirectories);
+    free(cachedPath);
+
+    cachedPath = checkedAllocation(strdup(path));
+    numPathDirectories = 1;
+    for (const char *c = path; *c != '\0'; c++) {
+        numPathDirectories += (*c == ':');
+    }
+    pathDirectories = checkedAllocation(calloc(numPathDirectories, sizeof(PathDirectory)));
+
+    const char *start = path;
+    for (size_t i = 0; i < numPathDirectories; i++) {
+        const char *end = strchr(start, ':');
+        size_t length = end ? (size_t)(end - start) : strlen(start);
+        // An empty PATH element means the current directory.
+        PathDirectory *entry = &pathDirectories[i];
+        entry->directory = checkedAllocation(length ? strndup(start, length) : strdup("."));
+        entry->cacheable = entry->directory[0] == '/';
+
+        struct stat info;
+        if (stat(entry->directory, &info) == 0) {
+            entry->mtime = info.st_mtim;
+        }
+        start = end ? end + 1 : start + length;
+    }
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &lastDirectoryCheck);
+}
+
+// Flushes the cache if PATH changed or a PATH directory was modified since it was scanned.
+static void validatePathCache(const char* path) {
+    if (cachedPath == NULL || strcmp(cachedPath, path) != 0) {
+        flushPathCache();
+        loadPathDirectories(path);
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    long elapsed = (now.tv_sec - lastDirectoryCheck.tv_sec) * 1000000000L + (now.tv_nsec - lastDirectoryCheck.tv_nsec);
+    if (elapsed < DIRECTORY_CHECK_INTERVAL_NS) {
+        return;
+    }
+    lastDirectoryCheck = now;
+
+    bool modified = false;
+    for (size_t i = 0; i < numPathDirectories; i++) {
+        struct stat info;
+        struct timespec mtime = {0, 0};
+        if (stat(pathDirectories[i].directory, &info) == 0) {
+            mtime = info.st_mtim;
+        }
+        if (mtime.tv_sec != pathDirectories[i].mtime.tv_sec || mtime.tv_nsec != pathDirectories[i].mtime.tv_nsec) {
+            pathDirectories[i].mtime = mtime;
+            modified = true;
+        }
+    }
+    if (modified) {
+        flushPathCache();
+    }
+}
+
+// Returns the table slot holding name, or the empty slot where it should be inserted.
+static PathCacheEntry* findSlot(const char* name) {
+    size_t mask = cacheCapacity - 1;
+    size_t slot = hashCommandName(name) & mask;
+    while (cacheEntries[slot].name != NULL && strcmp(cacheEntries[slot].name, name) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return &cacheEntries[slot];
+}
+
+// Doubles the table when it becomes half full.
+static void growPathCache() {
+    PathCacheEntry *oldEntries = cacheEntries;
+    size_t oldCapacity = cacheCapacity;
+
+    cacheCapacity = oldCapacity ? oldCapacity * 2 : INITIAL_CACHE_CAPACITY;
+    cacheEntries = checkedAllocation(calloc(cacheCapacity, sizeof(PathCacheEntry)));
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (oldEntries[i].name != NULL) {
+            *findSlot(oldEntries[i].name) = oldEntries[i];
+        }
+    }
+    free(oldEntries);
+}
+
+// Searches the PATH directories for an executable regular file called name.
+// On success the full path is written to buffer and the owning directory is returned.
+static const PathDirectory* searchPath(const char* name, char* buffer, size_t bufferSize) {
+    for (size_t i = 0; i < numPathDirectories; i++) {
+        struct stat info;
+        if (snprintf(buffer, bufferSize, "%s/%s", pathDirectories[i].directory, name) >= (int)bufferSize) {
+            continue;
+        }
+        if (stat(buffer, &info) == 0 && S_ISREG(info.st_mode) && access(buffer, X_OK) == 0) {
+            return &pathDirectories[i];
+        }
+    }
+    return NULL;
+}
+
+// Resolves a command name to the path that should be executed, consulting the cache first.
+// Names containing a slash are returned unchanged. Returns NULL if the command is not found.
+// The returned string stays valid until the cache is next modified.
+const char* resolveCommandPath(const char* name) {
+    if (strchr(name, '/') != NULL) {
+        return name;
+    }
+
+    const char *path = getenv("PATH");
+    validatePathCache(path ? path : "/usr/local/bin:/usr/bin:/bin");
+
+    if (cacheCapacity > 0) {
+        PathCacheEntry *entry = findSlot(name);
+        if (entry->name != NULL) {
+            entry->hits++;
+            return entry->path;
+        }
+    }
+
+    static char resolved[4096];
+    const PathDirectory *directory = searchPath(name, resolved, sizeof(resolved));
+    if (directory == NULL) {
+        return NULL;
+    }
+    if (!directory->cacheable) {
+        return resolved;
+    }
+
+    if (2 * (cacheSize + 1) > cacheCapacity) {
+        growPathCache();
+    }
+    PathCacheEntry *entry = findSlot(name);
+    entry->name = checkedAllocation(strdup(name));
+    entry->path = checkedAllocation(strdup(resolved));
+    entry->hits = 1;
+    cacheSize++;
+    return entry->path;
+}
+
+// Prints the cached commands in the same layout as the hash builtin of other shells.
+void printPathCache() {
+    if (cacheSize == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    printf("hits\tcommand\n");
+    for (size_t i = 0; i < cacheCapacity; i++) {
+        if (cacheEntries[i].name != NULL) {
+            printf("%4u\t%s\n", cacheEntries[i].hits, cacheEntries[i].path);
+        }
+    }
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+const char* resolveCommandPath(const char* name);
+void flushPathCache();
+void printPathCache();
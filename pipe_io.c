@@ -0,0 +1,109 @@
+#define _GNU_SOURCE
+#include "pipe_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define SPLICE_CHUNK_SIZE (1 << 20)
+
+// Returns true if the descriptor refers to a pipe or FIFO.
+bool isPipe(int fd) {
+    struct stat info;
+    return fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+// Writes the whole buffer, retrying after short writes and interrupts.
+bool writeAll(int fd, const void* data, size_t length) {
+    const char *cursor = data;
+    while (length > 0) {
+        ssize_t written = write(fd, cursor, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        cursor += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Allocates page-aligned memory suitable for giftPipeBuffer. Returns NULL on failure.
+void* allocatePipeBuffer(size_t length) {
+    void *buffer = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return buffer == MAP_FAILED ? NULL : buffer;
+}
+
+// Releases a buffer from allocatePipeBuffer that was not handed to a pipe.
+void freePipeBuffer(void* buffer, size_t length) {
+    munmap(buffer, length);
+}
+
+// Hands a buffer from allocatePipeBuffer to a pipe without copying it. vmsplice maps the
+// pages into the pipe, which keeps them referenced after the buffer is unmapped here, so the
+// caller must not use the buffer again. Falls back to write() if the pipe refuses the pages.
+bool giftPipeBuffer(int pipeFd, void* buffer, size_t length) {
+    struct iovec vector = { buffer, length };
+    bool ok = true;
+    while (vector.iov_len > 0) {
+        ssize_t moved = vmsplice(pipeFd, &vector, 1, 0);
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = writeAll(pipeFd, vector.iov_base, vector.iov_len);
+            break;
+        }
+        vector.iov_base = (char *)vector.iov_base + moved;
+        vector.iov_len -= (size_t)moved;
+    }
+    munmap(buffer, length);
+    return ok;
+}
+
+// Appends everything readable from a pipe to a file inside the kernel until end of input.
+// splice refuses O_APPEND targets, so the file is written at an explicit end-of-file offset.
+// Falls back to a read/write copy if the file system does not support splice.
+bool spliceToFile(int pipeFd, int fileFd) {
+    off_t offset = lseek(fileFd, 0, SEEK_END);
+    if (offset < 0) {
+        return false;
+    }
+
+    while (true) {
+        ssize_t moved = splice(pipeFd, NULL, fileFd, &offset, SPLICE_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (moved == 0) {
+            return true;
+        }
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EINVAL) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    static char buffer[64 * 1024];
+    ssize_t numRead;
+    while ((numRead = read(pipeFd, buffer, sizeof(buffer))) != 0) {
+        if (numRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (pwrite(fileFd, buffer, (size_t)numRead, offset) != numRead) {
+            return false;
+        }
+        offset += numRead;
+    }
+    return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+bool isPipe(int fd);
+bool writeAll(int fd, const void* data, size_t length);
+void* allocatePipeBuffer(size_t length);
+void freePipeBuffer(void* buffer, size_t length);
+bool giftPipeBuffer(int pipeFd, void* buffer, size_t length);
+bool spliceToFile(int pipeFd, int fileFd);
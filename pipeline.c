@@ -0,0 +1,112 @@
+#define _GNU_SOURCE
+#include "pipeline.h"
+#include "builtin_commands.h"
+#include "process_spawn.h"
+#include "append_cache.h"
+#include "trace.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Starts one pipeline stage reading from inputFd and writing to outputFd (-1 inherits the
+// shell's descriptor). External commands are spawned directly. Builtins run in a forked copy
+// of the shell so that they execute concurrently with the other stages; unusedFd is the
+// read end of the stage's own output pipe, which the builtin child must not keep open.
+// Set in a builtin's child when its standard input is the pipe from the stage before it.
+static bool readsPipeline = false;
+
+// Returns true in a builtin running as a pipeline stage that reads the output of the stage
+// before it, as opposed to the shell's own standard input.
+bool builtinReadsPipeline() {
+    return readsPipeline;
+}
+
+static pid_t startStage(char** arguments, int inputFd, int outputFd, int unusedFd, pid_t processGroup) {
+    const BuiltinCommand *builtin = findBuiltin(arguments[0]);
+    if (builtin == NULL) {
+        return spawnCommand(arguments, inputFd, outputFd, processGroup);
+    }
+
+    // Commit pending writeline and trace output first so the child neither repeats nor loses it.
+    fflush(stdout);
+    flushAppendCache();
+    flushTrace();
+    pid_t processID = fork();
+    if (processID == 0) {
+        if (unusedFd >= 0) {
+            close(unusedFd);
+        }
+        readsPipeline = inputFd >= 0;
+        prepareChildProcess(inputFd, outputFd, processGroup);
+        builtin->handler(arguments);
+        fflush(stdout);
+        flushAppendCache();
+        flushTrace();
+        _exit(EXIT_SUCCESS);
+    } else if (processID < 0) {
+        perror("fork failed");
+    } else if (processGroup >= 0) {
+        setpgid(processID, processGroup == 0 ? processID : processGroup);
+    }
+    return processID;
+}
+
+// Starts every stage of a pipeline without waiting for any of them. Adjacent stages are
+// connected by close-on-exec pipes, so data flows between processes without the shell
+// touching it. The first stage reads from inputFd and the last writes to outputFd (-1 for
+// the shell's standard input/output); both are closed once their stage has started.
+// processGroup is -1 to keep the stages in the shell's group, or 0 to put them in a new
+// group led by the first stage. The pids of the started stages are stored in processIDs,
+// which must have room for numStages entries; the number started is returned.
+size_t startPipeline(char*** stages, size_t numStages, int inputFd, int outputFd, pid_t processGroup, pid_t* processIDs) {
+    size_t numStarted = 0;
+    size_t stage = 0;
+
+    for (; stage < numStages; stage++) {
+        int pipeFds[2] = { -1, outputFd };
+        if (stage + 1 < numStages && pipe2(pipeFds, O_CLOEXEC) != 0) {
+            perror("pipe2 failed");
+            break;
+        }
+
+        pid_t processID = startStage(stages[stage], inputFd, pipeFds[1], pipeFds[0], processGroup);
+        if (processID > 0) {
+            processIDs[numStarted++] = processID;
+            if (processGroup == 0) {
+                processGroup = processID; // Later stages join the first stage's group.
+            }
+        }
+
+        // The parent keeps only the read end that feeds the next stage.
+        if (inputFd >= 0) {
+            close(inputFd);
+        }
+        if (pipeFds[1] >= 0) {
+            close(pipeFds[1]);
+        }
+        inputFd = pipeFds[0];
+    }
+    if (inputFd >= 0) {
+        close(inputFd);
+    }
+    if (stage < numStages && outputFd >= 0) {
+        close(outputFd); // Setup failed before the last stage was reached.
+    }
+
+    return numStarted;
+}
+
+// Runs a pipeline in the foreground: all stages start concurrently and the shell waits for
+// every one of them to finish.
+void runPipeline(char*** stages, size_t numStages) {
+    pid_t processIDs[numStages];
+    size_t numStarted = startPipeline(stages, numStages, -1, -1, -1, processIDs);
+
+    for (size_t i = 0; i < numStarted; i++) {
+        int status = 0;
+        waitpid(processIDs[i], &status, 0);
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+size_t startPipeline(char*** stages, size_t numStages, int inputFd, int outputFd, pid_t processGroup, pid_t* processIDs);
+void runPipeline(char*** stages, size_t numStages);
+bool builtinReadsPipeline();
@@ -0,0 +1,117 @@
+#include "process_registry.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PCB_SLAB_SIZE 4096          // PCBs allocated at a time.
+#define INITIAL_TABLE_CAPACITY 1024 // Hash slots; always a power of two, at most half full.
+
+// A slot of the pid table. The pid is kept next to the pointer so probes do not touch the PCB.
+typedef struct {
+    unsigned int pid;
+    PCB *pcb;                       // NULL for an empty slot.
+} RegistrySlot;
+
+// Open-addressing hash table from pid to PCB. PCBs live in slabs that are never moved or
+// freed, so the pointers held by the scheduler stay valid as the registry grows.
+static RegistrySlot *slots;
+static size_t capacity = 0;
+static size_t num_processes = 0;
+static PCB *slab = NULL;            // Current slab and the number of its PCBs handed out.
+static size_t slab_used = PCB_SLAB_SIZE;
+
+// Spreads consecutive pids across the table (Fibonacci hashing).
+static inline size_t slotFor(unsigned int pid, size_t table_capacity) {
+    return (size_t)(((uint64_t)pid * 0x9e3779b97f4a7c15ULL) >> 32) & (table_capacity - 1);
+}
+
+// Allocates an empty slot table.
+static RegistrySlot* allocateSlots(size_t table_capacity) {
+    RegistrySlot *table = (RegistrySlot *)calloc(table_capacity, sizeof(RegistrySlot));
+    if (!table) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return table;
+}
+
+// Initializes the registry of simulated processes.
+void initializeProcessRegistry() {
+    capacity = INITIAL_TABLE_CAPACITY;
+    slots = allocateSlots(capacity);
+}
+
+// Doubles the table and reinserts every PCB.
+static void growTable() {
+    size_t new_capacity = capacity * 2;
+    RegistrySlot *new_slots = allocateSlots(new_capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        if (slots[i].pcb) {
+            size_t slot = slotFor(slots[i].pid, new_capacity);
+            while (new_slots[slot].pcb) {
+                slot = (slot + 1) & (new_capacity - 1);
+            }
+            new_slots[slot] = slots[i];
+        }
+    }
+    free(slots);
+    slots = new_slots;
+    capacity = new_capacity;
+}
+
+// Returns the PCB of pid, or NULL if there is none.
+PCB* findProcess(unsigned int pid) {
+    for (size_t slot = slotFor(pid, capacity); slots[slot].pcb; slot = (slot + 1) & (capacity - 1)) {
+        if (slots[slot].pid == pid) {
+            return slots[slot].pcb;
+        }
+    }
+    return NULL;
+}
+
+// Creates a zeroed PCB for pid. Returns NULL if the pid is already in use.
+PCB* registerProcess(unsigned int pid) {
+    if ((num_processes + 1) * 2 > capacity) {
+        growTable();
+    }
+
+    size_t slot = slotFor(pid, capacity);
+    for (; slots[slot].pcb; slot = (slot + 1) & (capacity - 1)) {
+        if (slots[slot].pid == pid) {
+            return NULL;
+        }
+    }
+
+    if (slab_used == PCB_SLAB_SIZE) {
+        slab = (PCB *)malloc(PCB_SLAB_SIZE * sizeof(PCB));
+        if (!slab) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        slab_used = 0;
+    }
+    PCB *pcb = &slab[slab_used++];
+    memset(pcb, 0, sizeof(PCB));
+    pcb->pid = pid;
+    pcb->process.process_id = (int)pid;
+
+    slots[slot].pid = pid;
+    slots[slot].pcb = pcb;
+    num_processes++;
+    return pcb;
+}
+
+// Returns the number of registered processes.
+size_t processCount() {
+    return num_processes;
+}
+
+// Calls visit for every registered process, in no particular order.
+void forEachProcess(void (*visit)(PCB *pcb)) {
+    for (size_t i = 0; i < capacity; i++) {
+        if (slots[i].pcb) {
+            visit(slots[i].pcb);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef PROCESS_REGISTRY_H
+#define PROCESS_REGISTRY_H
+
+#include "vmm.h"
+#include <stddef.h>
+
+// Initializes the registry of simulated processes.
+void initializeProcessRegistry();
+
+// Creates a zeroed PCB for pid. Returns NULL if the pid is already in use.
+PCB* registerProcess(unsigned int pid);
+
+// Returns the PCB of pid, or NULL if there is none.
+PCB* findProcess(unsigned int pid);
+
+// Returns the number of registered processes.
+size_t processCount();
+
+// Calls visit for every registered process, in no particular order.
+void forEachProcess(void (*visit)(PCB *pcb));
+
+#endif // PROCESS_REGISTRY_H
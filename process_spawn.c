@@ -0,0 +1,204 @@
+#define _GNU_SOURCE
+#include "process_spawn.h"
+#include "path_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+// Backend used for every external command. Selected at runtime with the spawnmode builtin.
+static SpawnBackend currentBackend = SPAWN_POSIX_SPAWN;
+
+static const char *backendNames[] = {
+    [SPAWN_POSIX_SPAWN] = "posix_spawn",
+    [SPAWN_VFORK] = "vfork",
+    [SPAWN_FORK] = "fork",
+};
+
+// Selects the backend used by later calls to spawnCommand.
+void setSpawnBackend(SpawnBackend backend) {
+    currentBackend = backend;
+}
+
+// Returns the backend currently in use.
+SpawnBackend getSpawnBackend() {
+    return currentBackend;
+}
+
+// Returns the user-facing name of a backend.
+const char* spawnBackendName(SpawnBackend backend) {
+    return backendNames[backend];
+}
+
+// Converts a backend name to its enum value. Returns false for unknown names.
+bool parseSpawnBackend(const char* name, SpawnBackend* backend) {
+    for (size_t i = 0; i < sizeof(backendNames) / sizeof(backendNames[0]); i++) {
+        if (strcmp(name, backendNames[i]) == 0) {
+            *backend = (SpawnBackend)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Prepares a freshly forked or vforked child: joins the requested process group, restores
+// the default signal mask (the shell blocks SIGCHLD) and the default SIGTTOU action (the
+// shell ignores it), and points standard input and output at the given descriptors. Only
+// async-signal-safe calls are made.
+void prepareChildProcess(int inputFd, int outputFd, pid_t processGroup) {
+    if (processGroup >= 0) {
+        setpgid(0, processGroup);
+    }
+
+    signal(SIGTTOU, SIG_DFL);
+    sigset_t emptyMask;
+    sigemptyset(&emptyMask);
+    sigprocmask(SIG_SETMASK, &emptyMask, NULL);
+
+    if (inputFd >= 0 && inputFd != STDIN_FILENO) {
+        dup2(inputFd, STDIN_FILENO);
+        close(inputFd);
+    }
+    if (outputFd >= 0 && outputFd != STDOUT_FILENO) {
+        dup2(outputFd, STDOUT_FILENO);
+        close(outputFd);
+    }
+}
+
+// Forks (or vforks) a child that execs path, and returns its pid in the parent. If the exec
+// fails, the child writes its errno to errorFd, a close-on-exec pipe, and exits. Only
+// async-signal-safe calls are made in the child, since a vfork child shares the parent's
+// memory and must not touch stdio or the heap. Kept apart from spawnResolved so that no
+// variable the parent uses after vfork returns can be clobbered by the child.
+static pid_t forkAndExec(bool useVfork, const char* path, char** arguments, int inputFd, int outputFd, pid_t processGroup, int errorFd) {
+    pid_t processID = useVfork ? vfork() : fork();
+    if (processID == 0) {
+        prepareChildProcess(inputFd, outputFd, processGroup);
+        execv(path, arguments);
+        int execError = errno;
+        write(errorFd, &execError, sizeof(execError));
+        _exit(127); // If execv fails.
+    }
+    return processID;
+}
+
+// Starts an already-resolved executable with the selected backend. If the child cannot be
+// started or its exec fails, returns -1 with the error in spawnError, for every backend.
+static pid_t spawnResolved(const char* path, char** arguments, int inputFd, int outputFd, pid_t processGroup, int* spawnError) {
+    pid_t processID = -1;
+    *spawnError = 0;
+    switch (currentBackend) {
+        case SPAWN_POSIX_SPAWN: {
+            posix_spawn_file_actions_t actions;
+            posix_spawnattr_t attributes;
+            sigset_t emptyMask;
+            sigset_t defaultSignals;
+            short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+            posix_spawn_file_actions_init(&actions);
+            if (inputFd >= 0 && inputFd != STDIN_FILENO) {
+                posix_spawn_file_actions_adddup2(&actions, inputFd, STDIN_FILENO);
+            }
+            if (outputFd >= 0 && outputFd != STDOUT_FILENO) {
+                posix_spawn_file_actions_adddup2(&actions, outputFd, STDOUT_FILENO);
+            }
+
+            posix_spawnattr_init(&attributes);
+            sigemptyset(&emptyMask);
+            posix_spawnattr_setsigmask(&attributes, &emptyMask);
+            sigemptyset(&defaultSignals);
+            sigaddset(&defaultSignals, SIGTTOU);
+            posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+            if (processGroup >= 0) {
+                posix_spawnattr_setpgroup(&attributes, processGroup);
+                flags |= POSIX_SPAWN_SETPGROUP;
+            }
+            posix_spawnattr_setflags(&attributes, flags);
+
+            *spawnError = posix_spawn(&processID, path, &actions, &attributes, arguments, environ);
+            posix_spawnattr_destroy(&attributes);
+            posix_spawn_file_actions_destroy(&actions);
+            if (*spawnError != 0) {
+                return -1;
+            }
+            break;
+        }
+        case SPAWN_VFORK:
+        case SPAWN_FORK: {
+            // The pipe is closed by a successful exec, so the read below sees end-of-file,
+            // or the child's errno if the exec failed.
+            int errorPipe[2];
+            if (pipe2(errorPipe, O_CLOEXEC) != 0) {
+                *spawnError = errno;
+                return -1;
+            }
+            processID = forkAndExec(currentBackend == SPAWN_VFORK, path, arguments, inputFd, outputFd, processGroup, errorPipe[1]);
+            int forkError = errno;
+            close(errorPipe[1]);
+            if (processID < 0) {
+                close(errorPipe[0]);
+                *spawnError = forkError;
+                return -1;
+            }
+
+            int execError = 0;
+            ssize_t length;
+            do {
+                length = read(errorPipe[0], &execError, sizeof(execError));
+            } while (length < 0 && errno == EINTR);
+            close(errorPipe[0]);
+            if (length == sizeof(execError)) {
+                waitpid(processID, NULL, 0);
+                *spawnError = execError;
+                return -1;
+            }
+            break;
+        }
+    }
+
+    if (processGroup >= 0) {
+        // Also set the group from the parent so it is in place before we signal the job.
+        setpgid(processID, processGroup == 0 ? processID : processGroup);
+    }
+    return processID;
+}
+
+// Starts an external command with the selected backend without waiting for it. The command
+// is resolved through the PATH cache, so PATH is only searched the first time a name is seen.
+// The child's standard input and output are taken from inputFd and outputFd; pass -1 to
+// inherit the shell's. processGroup is -1 to stay in the shell's process group, 0 to lead a
+// new group, or the id of an existing group to join.
+// Returns the child's pid, or -1 if no child could be started.
+pid_t spawnCommand(char** arguments, int inputFd, int outputFd, pid_t processGroup) {
+    // Flush pending output so it appears before anything the child prints.
+    fflush(stdout);
+
+    const char *path = resolveCommandPath(arguments[0]);
+    if (path == NULL) {
+        fprintf(stderr, "%s: command not found\n", arguments[0]);
+        return -1;
+    }
+
+    int spawnError = 0;
+    pid_t processID = spawnResolved(path, arguments, inputFd, outputFd, processGroup, &spawnError);
+    if (spawnError == ENOENT && path != arguments[0]) {
+        // The cached executable disappeared: forget stale entries and search PATH again.
+        flushPathCache();
+        path = resolveCommandPath(arguments[0]);
+        if (path != NULL) {
+            processID = spawnResolved(path, arguments, inputFd, outputFd, processGroup, &spawnError);
+        }
+    }
+
+    if (processID < 0) {
+        fprintf(stderr, "%s: %s\n", arguments[0], strerror(spawnError ? spawnError : ENOENT));
+    }
+    return processID;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Mechanisms available for starting external commands.
+typedef enum {
+    SPAWN_POSIX_SPAWN,  // posix_spawn: no page-table copy, the default.
+    SPAWN_VFORK,        // vfork + execv: the child borrows the shell's address space until exec.
+    SPAWN_FORK          // fork + execv: the original copy-everything path.
+} SpawnBackend;
+
+void setSpawnBackend(SpawnBackend backend);
+SpawnBackend getSpawnBackend();
+const char* spawnBackendName(SpawnBackend backend);
+bool parseSpawnBackend(const char* name, SpawnBackend* backend);
+void prepareChildProcess(int inputFd, int outputFd, pid_t processGroup);
+pid_t spawnCommand(char** arguments, int inputFd, int outputFd, pid_t processGroup);
@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+#include "random_text.h"
+#include "pipe_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Output is produced in blocks of this size. Each block's content depends only on the seed
+// and the block's index, so the result is the same whatever the number of threads.
+#define RANDOM_BLOCK_SIZE (4 * 1024 * 1024)
+#define RANDOM_BLOCK_ALIGNMENT 4096
+#define BYTES_PER_THREAD (64ULL * 1024 * 1024) // Files smaller than this per thread use fewer threads.
+#define RANDOM_LANES 4
+
+// wyrand: one 64x64->128 multiply per 8 output bytes.
+static inline uint64_t wyrand(uint64_t* state) {
+    *state += 0xa0761d6478bd642fULL;
+    __uint128_t product = (__uint128_t)*state * (*state ^ 0xe7037ed1a0b428dbULL);
+    return (uint64_t)(product >> 64) ^ (uint64_t)product;
+}
+
+// splitmix64 finalizer, used to derive independent lane states from the seed and block index.
+static inline uint64_t mixSeed(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+// Fills one block with random bytes. Several independent generator lanes are interleaved so
+// the multiplies overlap, and the printable mapping is a branch-free multiply-shift per byte
+// that the compiler vectorizes.
+static void fillBlock(unsigned char* block, size_t length, uint64_t seed, uint64_t blockIndex, bool printable) {
+    uint64_t lanes[RANDOM_LANES];
+    for (int lane = 0; lane < RANDOM_LANES; lane++) {
+        lanes[lane] = mixSeed(seed ^ mixSeed(blockIndex * RANDOM_LANES + (uint64_t)lane + 1));
+    }
+
+    size_t numWords = length / sizeof(uint64_t);
+    uint64_t *words = (uint64_t *)block;
+    size_t i = 0;
+    for (; i + RANDOM_LANES <= numWords; i += RANDOM_LANES) {
+        for (int lane = 0; lane < RANDOM_LANES; lane++) {
+            words[i + (size_t)lane] = wyrand(&lanes[lane]);
+        }
+    }
+    for (; i < numWords; i++) {
+        words[i] = wyrand(&lanes[0]);
+    }
+    if (length % sizeof(uint64_t) != 0) {
+        uint64_t last = wyrand(&lanes[1]);
+        memcpy(block + numWords * sizeof(uint64_t), &last, length % sizeof(uint64_t));
+    }
+
+    if (printable) {
+        for (size_t j = 0; j < length; j++) {
+            block[j] = (unsigned char)('!' + ((block[j] * 94u) >> 8));
+        }
+    }
+}
+
+// Returns a seed for runs without an explicit one.
+uint64_t randomSeed() {
+    uint64_t seed;
+    if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) != sizeof(seed)) {
+        seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    }
+    return seed;
+}
+
+// Work shared by the threads filling one file.
+typedef struct {
+    int fd;
+    off_t baseOffset;           // File offset where the generated data starts.
+    uint64_t numBytes;
+    uint64_t numBlocks;
+    const RandomTextOptions *options;
+    size_t numThreads;
+    size_t threadIndex;
+    bool failed;
+} RandomWriter;
+
+// Thread body: generates every numThreads-th block and writes it at its own offset.
+static void* writeBlocks(void* argument) {
+    RandomWriter *writer = argument;
+    unsigned char *block = aligned_alloc(RANDOM_BLOCK_ALIGNMENT, RANDOM_BLOCK_SIZE);
+    if (block == NULL) {
+        writer->failed = true;
+        return NULL;
+    }
+
+    for (uint64_t index = writer->threadIndex; index < writer->numBlocks; index += writer->numThreads) {
+        uint64_t start = index * RANDOM_BLOCK_SIZE;
+        size_t length = writer->numBytes - start < RANDOM_BLOCK_SIZE ? (size_t)(writer->numBytes - start) : RANDOM_BLOCK_SIZE;
+        fillBlock(block, length, writer->options->seed, index, writer->options->printable);
+
+        size_t written = 0;
+        while (written < length) {
+            ssize_t result = pwrite(writer->fd, block + written, length - written, writer->baseOffset + (off_t)(start + written));
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                writer->failed = true;
+                free(block);
+                return NULL;
+            }
+            written += (size_t)result;
+        }
+    }
+
+    free(block);
+    return NULL;
+}
+
+// Appends numBytes of random data to a regular file. Space is reserved up front with
+// fallocate when the file system supports it, and the blocks are generated and written
+// with pwrite by several threads at once. Devices, FIFOs and terminals cannot be written
+// at an offset, so they get the data as a stream instead. Returns false on an I/O error.
+bool writeRandomText(int fd, uint64_t numBytes, const RandomTextOptions* options) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+    if (!S_ISREG(info.st_mode)) {
+        return streamRandomText(fd, numBytes, options);
+    }
+    off_t baseOffset = info.st_size;
+    if (numBytes == 0) {
+        return true;
+    }
+    if (fallocate(fd, 0, baseOffset, (off_t)numBytes) != 0 && errno != EOPNOTSUPP && errno != ENOSYS && errno != ENODEV) {
+        return false;
+    }
+
+    uint64_t numBlocks = (numBytes + RANDOM_BLOCK_SIZE - 1) / RANDOM_BLOCK_SIZE;
+    size_t numThreads = options->numThreads;
+    if (numThreads == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = processors > 0 ? (size_t)processors : 1;
+        if (numThreads > numBytes / BYTES_PER_THREAD + 1) {
+            numThreads = (size_t)(numBytes / BYTES_PER_THREAD + 1);
+        }
+    }
+    if (numThreads > numBlocks) {
+        numThreads = (size_t)numBlocks;
+    }
+
+    RandomWriter writers[numThreads];
+    pthread_t threads[numThreads];
+    for (size_t i = 0; i < numThreads; i++) {
+        writers[i] = (RandomWriter){ fd, baseOffset, numBytes, numBlocks, options, numThreads, i, false };
+    }
+
+    // The calling thread takes the first share itself.
+    size_t numStarted = 1;
+    for (; numStarted < numThreads; numStarted++) {
+        if (pthread_create(&threads[numStarted], NULL, writeBlocks, &writers[numStarted]) != 0) {
+            break;
+        }
+    }
+    // Shares whose thread could not be started are run inline as well.
+    writeBlocks(&writers[0]);
+    for (size_t i = numStarted; i < numThreads; i++) {
+        writeBlocks(&writers[i]);
+    }
+
+    bool ok = !writers[0].failed;
+    for (size_t i = 1; i < numThreads; i++) {
+        if (i < numStarted) {
+            pthread_join(threads[i], NULL);
+        }
+        ok = ok && !writers[i].failed;
+    }
+    return ok;
+}
+
+// Writes numBytes of random data to a stream such as standard output. When the stream is a
+// pipe, each block is generated into fresh pages and handed over with vmsplice.
+bool streamRandomText(int fd, uint64_t numBytes, const RandomTextOptions* options) {
+    bool toPipe = isPipe(fd);
+    unsigned char *reusable = toPipe ? NULL : aligned_alloc(RANDOM_BLOCK_ALIGNMENT, RANDOM_BLOCK_SIZE);
+    if (!toPipe && reusable == NULL) {
+        return false;
+    }
+
+    bool ok = true;
+    for (uint64_t index = 0; ok && index * RANDOM_BLOCK_SIZE < numBytes; index++) {
+        uint64_t start = index * RANDOM_BLOCK_SIZE;
+        size_t length = numBytes - start < RANDOM_BLOCK_SIZE ? (size_t)(numBytes - start) : RANDOM_BLOCK_SIZE;
+        unsigned char *block = toPipe ? allocatePipeBuffer(length) : reusable;
+        if (block == NULL) {
+            ok = false;
+            break;
+        }
+        fillBlock(block, length, options->seed, index, options->printable);
+        ok = toPipe ? giftPipeBuffer(fd, block, length) : writeAll(fd, block, length);
+    }
+
+    free(reusable);
+    return ok;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Settings for a random data run.
+typedef struct {
+    uint64_t seed;              // Seed for the generator; equal seeds give identical output.
+    bool printable;             // Restrict output to printable ASCII ('!' through '~').
+    size_t numThreads;          // Worker threads for file output; 0 picks one automatically.
+} RandomTextOptions;
+
+uint64_t randomSeed();
+bool writeRandomText(int fd, uint64_t numBytes, const RandomTextOptions* options);
+bool streamRandomText(int fd, uint64_t numBytes, const RandomTextOptions* options);
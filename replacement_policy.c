@@ -0,0 +1,593 @@
+#include "replacement_policy.h"
+#include "frame_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_FRAME -1
+
+// Doubly linked list of frames, threaded through the frame_prev/frame_next arrays. The head
+// is the next candidate for eviction; the tail is the most recently inserted frame.
+typedef struct {
+    int head;
+    int tail;
+    unsigned int size;
+} FrameList;
+
+static int *frame_prev;
+static int *frame_next;
+static unsigned char *frame_list;       // Which list a frame is on (policy specific), 0 for none.
+static unsigned char *referenced;       // CLOCK reference bits.
+static unsigned int frame_count;
+
+// Allocates a zeroed frame table or exits.
+static void* allocateArray(size_t count, size_t size) {
+    void *array = allocateFrameTable(count, size);
+    if (!array) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+// (Re)allocates the per-frame arrays shared by every policy.
+static void initializeFrameArrays(unsigned int num_frames) {
+    freeFrameTable(frame_prev, frame_count, sizeof(int));
+    freeFrameTable(frame_next, frame_count, sizeof(int));
+    freeFrameTable(frame_list, frame_count, 1);
+    freeFrameTable(referenced, frame_count, 1);
+    frame_prev = (int *)allocateArray(num_frames, sizeof(int));
+    frame_next = (int *)allocateArray(num_frames, sizeof(int));
+    frame_list = (unsigned char *)allocateArray(num_frames, 1);
+    referenced = (unsigned char *)allocateArray(num_frames, 1);
+    frame_count = num_frames;
+}
+
+static void listInit(FrameList *list) {
+    list->head = list->tail = NO_FRAME;
+    list->size = 0;
+}
+
+// Appends a frame at the tail of a list.
+static void listPush(FrameList *list, unsigned char id, int frame) {
+    frame_prev[frame] = list->tail;
+    frame_next[frame] = NO_FRAME;
+    if (list->tail != NO_FRAME) {
+        frame_next[list->tail] = frame;
+    } else {
+        list->head = frame;
+    }
+    list->tail = frame;
+    list->size++;
+    frame_list[frame] = id;
+}
+
+// Unlinks a frame from the list it is on.
+static void listRemove(FrameList *list, int frame) {
+    if (frame_prev[frame] != NO_FRAME) {
+        frame_next[frame_prev[frame]] = frame_next[frame];
+    } else {
+        list->head = frame_next[frame];
+    }
+    if (frame_next[frame] != NO_FRAME) {
+        frame_prev[frame_next[frame]] = frame_prev[frame];
+    } else {
+        list->tail = frame_prev[frame];
+    }
+    list->size--;
+    frame_list[frame] = 0;
+}
+
+// Removes and returns the head of a list.
+static int listPop(FrameList *list) {
+    int frame = list->head;
+    listRemove(list, frame);
+    return frame;
+}
+
+// Frame numbers converted at a time.
+#define SAVED_LIST_CHUNK 1024
+
+// Writes the length of a list and its frames, from head to tail, to an image.
+static void saveList(ImageWriter *writer, const FrameList *list) {
+    uint64_t size = list->size;
+    writeImageSection(writer, SECTION_REPLACEMENT_POLICY, &size, sizeof(size));
+    uint32_t frames[SAVED_LIST_CHUNK];
+    unsigned int count = 0;
+    beginImageSection(writer, SECTION_REPLACEMENT_POLICY, size * sizeof(uint32_t));
+    for (int frame = list->head; frame != NO_FRAME; frame = frame_next[frame]) {
+        frames[count++] = (uint32_t)frame;
+        if (count == SAVED_LIST_CHUNK || frame_next[frame] == NO_FRAME) {
+            writeImageData(writer, frames, count * sizeof(uint32_t));
+            count = 0;
+        }
+    }
+    endImageSection(writer);
+}
+
+// Rebuilds a list saved by saveList, in the policy just initialized. Returns false if the
+// image does not hold it, or names a frame out of range or already on a list.
+static bool loadList(ImageReader *reader, FrameList *list, unsigned char id) {
+    const uint64_t *size = (const uint64_t *)readImageSection(reader, SECTION_REPLACEMENT_POLICY, sizeof(uint64_t));
+    if (!size || *size > frame_count) {
+        return false;
+    }
+    const uint32_t *frames = (const uint32_t *)readImageSection(reader, SECTION_REPLACEMENT_POLICY, *size * sizeof(uint32_t));
+    if (!frames) {
+        return false;
+    }
+    for (uint64_t i = 0; i < *size; i++) {
+        if (frames[i] >= frame_count || frame_list[frames[i]] != 0) {
+            return false;
+        }
+        listPush(list, id, (int)frames[i]);
+    }
+    return true;
+}
+
+// FIFO and LRU share one list: FIFO leaves it in load order, LRU moves frames to the tail
+// on every hit.
+static FrameList queue;
+
+static void queueInitialize(unsigned int num_frames) {
+    initializeFrameArrays(num_frames);
+    listInit(&queue);
+}
+
+static void queueLoad(unsigned int frame, unsigned int pid, uint64_t page) {
+    listPush(&queue, 1, (int)frame);
+}
+
+static void queueRelease(unsigned int frame) {
+    if (frame_list[frame]) {
+        listRemove(&queue, (int)frame);
+    }
+}
+
+static unsigned int queueVictim(unsigned int pid, uint64_t page) {
+    return (unsigned int)listPop(&queue);
+}
+
+static void queueSave(ImageWriter *writer, const unsigned int *frames, unsigned int count) {
+    saveList(writer, &queue);
+}
+
+static bool queueRestore(ImageReader *reader, const unsigned int *frames, unsigned int count) {
+    return loadList(reader, &queue, 1);
+}
+
+static void fifoHit(unsigned int frame) {
+}
+
+static void lruHit(unsigned int frame) {
+    listRemove(&queue, (int)frame);
+    listPush(&queue, 1, (int)frame);
+}
+
+// CLOCK: a hand sweeps the frames in order, clearing reference bits, and evicts the first
+// frame it finds unreferenced. Only frames holding the start of a page are candidates; the
+// other frames of a huge page are skipped.
+static unsigned int clock_hand;
+
+static void clockInitialize(unsigned int num_frames) {
+    initializeFrameArrays(num_frames);
+    clock_hand = 0;
+}
+
+static void clockLoad(unsigned int frame, unsigned int pid, uint64_t page) {
+    frame_list[frame] = 1;
+    referenced[frame] = 1;
+}
+
+static void clockHit(unsigned int frame) {
+    referenced[frame] = 1;
+}
+
+static void clockRelease(unsigned int frame) {
+    frame_list[frame] = 0;
+    referenced[frame] = 0;
+}
+
+static unsigned int clockVictim(unsigned int pid, uint64_t page) {
+    while (!frame_list[clock_hand] || referenced[clock_hand]) {
+        referenced[clock_hand] = 0;
+        clock_hand = (clock_hand + 1) % frame_count;
+    }
+    unsigned int victim = clock_hand;
+    frame_list[victim] = 0;
+    clock_hand = (clock_hand + 1) % frame_count;
+    return victim;
+}
+
+// Bits of a frame's saved CLOCK state.
+enum { CLOCK_LISTED = 1, CLOCK_REFERENCED = 2 };
+
+// Saves the hand and a byte of state for each resident frame; no other frame is on the clock.
+static void clockSave(ImageWriter *writer, const unsigned int *frames, unsigned int count) {
+    uint64_t hand = clock_hand;
+    writeImageSection(writer, SECTION_REPLACEMENT_POLICY, &hand, sizeof(hand));
+    unsigned char states[SAVED_LIST_CHUNK];
+    beginImageSection(writer, SECTION_REPLACEMENT_POLICY, count);
+    for (unsigned int start = 0; start < count; start += SAVED_LIST_CHUNK) {
+        unsigned int chunk = count - start < SAVED_LIST_CHUNK ? count - start : SAVED_LIST_CHUNK;
+        for (unsigned int i = 0; i < chunk; i++) {
+            unsigned int frame = frames[start + i];
+            states[i] = (unsigned char)((frame_list[frame] ? CLOCK_LISTED : 0) | (referenced[frame] ? CLOCK_REFERENCED : 0));
+        }
+        writeImageData(writer, states, chunk);
+    }
+    endImageSection(writer);
+}
+
+static bool clockRestore(ImageReader *reader, const unsigned int *frames, unsigned int count) {
+    const uint64_t *hand = (const uint64_t *)readImageSection(reader, SECTION_REPLACEMENT_POLICY, sizeof(uint64_t));
+    const unsigned char *states = (const unsigned char *)readImageSection(reader, SECTION_REPLACEMENT_POLICY, count);
+    if (!hand || *hand >= frame_count || !states) {
+        return false;
+    }
+    clock_hand = (unsigned int)*hand;
+    for (unsigned int i = 0; i < count; i++) {
+        if (states[i] > (CLOCK_LISTED | CLOCK_REFERENCED)) {
+            return false;
+        }
+        frame_list[frames[i]] = (states[i] & CLOCK_LISTED) != 0;
+        referenced[frames[i]] = (states[i] & CLOCK_REFERENCED) != 0;
+    }
+    return true;
+}
+
+// ARC (Megiddo and Modha): resident pages are split between T1 (seen once recently) and T2
+// (seen at least twice). Ghost lists B1 and B2 remember the pages recently evicted from each,
+// and a hit on a ghost moves the target size of T1 (arc_target) towards the list that would
+// have kept the page.
+enum { ARC_T1 = 1, ARC_T2 = 2 };
+enum { GHOST_FREE, GHOST_B1, GHOST_B2 };
+
+// Ghost entries live in a pool, linked into B1/B2 in LRU order and chained into a hash table.
+// Pool entries are handed out in order before any is reused, and hash links hold the ghost
+// index plus one, so the zeroed arrays need no setup and stay untouched until used.
+typedef struct {
+    int head;
+    int tail;
+    unsigned int size;
+} GhostList;
+
+typedef struct {
+    unsigned int pid;
+    uint64_t page;
+    int prev;
+    int next;
+    int hash_next;
+    unsigned char list;
+} Ghost;
+
+static FrameList arc_t1, arc_t2;
+static GhostList arc_b1, arc_b2, ghost_free;
+static Ghost *ghosts;
+static unsigned int ghosts_used;        // Pool entries handed out at least once.
+static unsigned int ghost_capacity;
+static int *ghost_buckets;
+static unsigned int ghost_bucket_mask;
+static unsigned int arc_target;         // Target size of T1 ("p" in the paper).
+static unsigned int *frame_pid;         // Page held by each frame, remembered for the ghost lists.
+static uint64_t *frame_page;
+
+// Pending decision for a fault: selectVictim has already looked the page up in the ghosts.
+static bool arc_pending;
+static unsigned int arc_pending_pid;
+static uint64_t arc_pending_page;
+static unsigned char arc_pending_list;
+
+static inline unsigned int ghostBucket(unsigned int pid, uint64_t page) {
+    uint64_t key = (page * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t)pid * 0xc2b2ae3d27d4eb4fULL);
+    return (unsigned int)(key >> 32) & ghost_bucket_mask;
+}
+
+static void ghostListPush(GhostList *list, unsigned char id, int ghost) {
+    ghosts[ghost].prev = list->tail;
+    ghosts[ghost].next = NO_FRAME;
+    if (list->tail != NO_FRAME) {
+        ghosts[list->tail].next = ghost;
+    } else {
+        list->head = ghost;
+    }
+    list->tail = ghost;
+    list->size++;
+    ghosts[ghost].list = id;
+}
+
+static void ghostListRemove(GhostList *list, int ghost) {
+    if (ghosts[ghost].prev != NO_FRAME) {
+        ghosts[ghosts[ghost].prev].next = ghosts[ghost].next;
+    } else {
+        list->head = ghosts[ghost].next;
+    }
+    if (ghosts[ghost].next != NO_FRAME) {
+        ghosts[ghosts[ghost].next].prev = ghosts[ghost].prev;
+    } else {
+        list->tail = ghosts[ghost].prev;
+    }
+    list->size--;
+}
+
+// Returns the ghost for a page, or NO_FRAME.
+static int ghostFind(unsigned int pid, uint64_t page) {
+    for (int link = ghost_buckets[ghostBucket(pid, page)]; link != 0; link = ghosts[link - 1].hash_next) {
+        if (ghosts[link - 1].pid == pid && ghosts[link - 1].page == page) {
+            return link - 1;
+        }
+    }
+    return NO_FRAME;
+}
+
+// Removes a ghost from its list and the hash table and returns it to the pool.
+static void ghostDelete(int ghost) {
+    ghostListRemove(ghosts[ghost].list == GHOST_B1 ? &arc_b1 : &arc_b2, ghost);
+    int *link = &ghost_buckets[ghostBucket(ghosts[ghost].pid, ghosts[ghost].page)];
+    while (*link != ghost + 1) {
+        link = &ghosts[*link - 1].hash_next;
+    }
+    *link = ghosts[ghost].hash_next;
+    ghostListPush(&ghost_free, GHOST_FREE, ghost);
+}
+
+// Remembers an evicted page at the MRU end of a ghost list.
+static void ghostAdd(GhostList *list, unsigned char id, unsigned int pid, uint64_t page) {
+    int ghost;
+    if (ghost_free.size == 0 && ghosts_used < ghost_capacity) {
+        ghost = (int)ghosts_used++;
+    } else {
+        if (ghost_free.size == 0) {
+            ghostDelete(arc_b1.size > 0 ? arc_b1.head : arc_b2.head);
+        }
+        ghost = ghost_free.head;
+        ghostListRemove(&ghost_free, ghost);
+    }
+    ghosts[ghost].pid = pid;
+    ghosts[ghost].page = page;
+    unsigned int bucket = ghostBucket(pid, page);
+    ghosts[ghost].hash_next = ghost_buckets[bucket];
+    ghost_buckets[bucket] = ghost + 1;
+    ghostListPush(list, id, ghost);
+}
+
+// Returns the size of the ghost hash table for num_frames frames: a power of two at least
+// as large as the pool of 2 * num_frames ghosts.
+static size_t ghostBucketCount(unsigned int num_frames) {
+    size_t num_buckets = 1;
+    while (num_buckets < (size_t)num_frames * 2) {
+        num_buckets <<= 1;
+    }
+    return num_buckets;
+}
+
+static void arcInitialize(unsigned int num_frames) {
+    // The pool holds two ghosts per frame of the geometry the arrays were allocated for.
+    freeFrameTable(ghosts, ghost_capacity, sizeof(Ghost));
+    freeFrameTable(ghost_buckets, ghosts ? (size_t)ghost_bucket_mask + 1 : 0, sizeof(int));
+    freeFrameTable(frame_pid, ghost_capacity / 2, sizeof(unsigned int));
+    freeFrameTable(frame_page, ghost_capacity / 2, sizeof(uint64_t));
+    initializeFrameArrays(num_frames);
+
+    unsigned int num_ghosts = num_frames * 2;
+    size_t num_buckets = ghostBucketCount(num_frames);
+    ghosts = (Ghost *)allocateArray(num_ghosts, sizeof(Ghost));
+    ghost_buckets = (int *)allocateArray(num_buckets, sizeof(int));
+    frame_pid = (unsigned int *)allocateArray(num_frames, sizeof(unsigned int));
+    frame_page = (uint64_t *)allocateArray(num_frames, sizeof(uint64_t));
+    ghost_bucket_mask = (unsigned int)(num_buckets - 1);
+    ghost_capacity = num_ghosts;
+    ghosts_used = 0;
+
+    listInit(&arc_t1);
+    listInit(&arc_t2);
+    arc_b1 = arc_b2 = ghost_free = (GhostList){ NO_FRAME, NO_FRAME, 0 };
+    arc_target = 0;
+    arc_pending = false;
+}
+
+// Looks the incoming page up in the ghost lists, adapts the target size on a ghost hit and
+// trims the ghost lists for a new page. Returns the list the page will join.
+static unsigned char arcAdmit(unsigned int pid, uint64_t page, bool cache_full) {
+    int ghost = ghostFind(pid, page);
+    if (ghost != NO_FRAME && ghosts[ghost].list == GHOST_B1) {
+        unsigned int delta = arc_b1.size >= arc_b2.size ? 1 : arc_b2.size / arc_b1.size;
+        arc_target = arc_target + delta < frame_count ? arc_target + delta : frame_count;
+        ghostDelete(ghost);
+        return ARC_T2;
+    }
+    if (ghost != NO_FRAME) {
+        unsigned int delta = arc_b2.size >= arc_b1.size ? 1 : arc_b1.size / arc_b2.size;
+        arc_target = arc_target > delta ? arc_target - delta : 0;
+        ghostDelete(ghost);
+        return ARC_T2;
+    }
+
+    // A page not seen recently: keep |T1| + |B1| <= c and the total directory within 2c.
+    if (arc_t1.size + arc_b1.size >= frame_count) {
+        if (arc_b1.size > 0) {
+            ghostDelete(arc_b1.head);
+        }
+    } else if (cache_full && arc_t1.size + arc_t2.size + arc_b1.size + arc_b2.size >= 2 * frame_count && arc_b2.size > 0) {
+        ghostDelete(arc_b2.head);
+    }
+    return ARC_T1;
+}
+
+static unsigned int arcVictim(unsigned int pid, uint64_t page) {
+    bool in_b2 = false;
+    int ghost = ghostFind(pid, page);
+    if (ghost != NO_FRAME) {
+        in_b2 = ghosts[ghost].list == GHOST_B2;
+    }
+    arc_pending_list = arcAdmit(pid, page, true);
+    arc_pending = true;
+    arc_pending_pid = pid;
+    arc_pending_page = page;
+
+    // A new page while T1 fills the whole cache: drop T1's LRU page without remembering it.
+    int victim;
+    if (ghost == NO_FRAME && arc_t1.size == frame_count) {
+        return (unsigned int)listPop(&arc_t1);
+    }
+
+    // REPLACE: evict from T1 if it is above its target, otherwise from T2.
+    if (arc_t1.size > 0 && (arc_t1.size > arc_target || (in_b2 && arc_t1.size == arc_target) || arc_t2.size == 0)) {
+        victim = listPop(&arc_t1);
+        ghostAdd(&arc_b1, GHOST_B1, frame_pid[victim], frame_page[victim]);
+    } else {
+        victim = listPop(&arc_t2);
+        ghostAdd(&arc_b2, GHOST_B2, frame_pid[victim], frame_page[victim]);
+    }
+    return (unsigned int)victim;
+}
+
+static void arcLoad(unsigned int frame, unsigned int pid, uint64_t page) {
+    unsigned char list;
+    if (arc_pending && arc_pending_pid == pid && arc_pending_page == page) {
+        list = arc_pending_list;
+    } else {
+        list = arcAdmit(pid, page, false);
+    }
+    arc_pending = false;
+    frame_pid[frame] = pid;
+    frame_page[frame] = page;
+    listPush(list == ARC_T2 ? &arc_t2 : &arc_t1, list, (int)frame);
+}
+
+static void arcHit(unsigned int frame) {
+    listRemove(frame_list[frame] == ARC_T1 ? &arc_t1 : &arc_t2, (int)frame);
+    listPush(&arc_t2, ARC_T2, (int)frame);
+}
+
+static void arcRelease(unsigned int frame) {
+    if (frame_list[frame]) {
+        listRemove(frame_list[frame] == ARC_T1 ? &arc_t1 : &arc_t2, (int)frame);
+    }
+}
+
+// ARC's ghost lists and counters as saved in an image, followed by T1, T2, the page held by
+// each frame on them and the ghosts handed out. The ghost hash table is rebuilt from the
+// ghosts. No fault is pending between commands.
+typedef struct {
+    GhostList b1, b2, free_ghosts;
+    uint32_t ghosts_used;
+    uint32_t target;
+} SavedArc;
+
+// Page held by a frame on T1 or T2, in list order.
+typedef struct {
+    uint64_t page;
+    uint64_t pid;
+} SavedArcPage;
+
+// Returns true if a restored ghost list links ghosts handed out, from head to tail, all
+// marked as being on it.
+static bool validGhostList(const GhostList *list, unsigned char id) {
+    int previous = NO_FRAME;
+    int ghost = list->head;
+    for (unsigned int i = 0; i < list->size; i++) {
+        if (ghost < 0 || ghost >= (int)ghosts_used || ghosts[ghost].list != id || ghosts[ghost].prev != previous) {
+            return false;
+        }
+        previous = ghost;
+        ghost = ghosts[ghost].next;
+    }
+    return ghost == NO_FRAME && list->tail == previous;
+}
+
+// Writes the pages held by the frames of a list, in list order.
+static void saveArcPages(ImageWriter *writer, const FrameList *list) {
+    for (int frame = list->head; frame != NO_FRAME; frame = frame_next[frame]) {
+        SavedArcPage saved = { frame_page[frame], frame_pid[frame] };
+        writeImageData(writer, &saved, sizeof(saved));
+    }
+}
+
+// Restores the pages held by the frames of a list, returning the next saved entry.
+static const SavedArcPage* loadArcPages(const SavedArcPage *saved, const FrameList *list) {
+    for (int frame = list->head; frame != NO_FRAME; frame = frame_next[frame], saved++) {
+        frame_page[frame] = saved->page;
+        frame_pid[frame] = (unsigned int)saved->pid;
+    }
+    return saved;
+}
+
+static void arcSave(ImageWriter *writer, const unsigned int *frames, unsigned int count) {
+    SavedArc saved = { arc_b1, arc_b2, ghost_free, ghosts_used, arc_target };
+    writeImageSection(writer, SECTION_REPLACEMENT_POLICY, &saved, sizeof(saved));
+    saveList(writer, &arc_t1);
+    saveList(writer, &arc_t2);
+    beginImageSection(writer, SECTION_REPLACEMENT_POLICY, ((uint64_t)arc_t1.size + arc_t2.size) * sizeof(SavedArcPage));
+    saveArcPages(writer, &arc_t1);
+    saveArcPages(writer, &arc_t2);
+    endImageSection(writer);
+    writeImageSection(writer, SECTION_REPLACEMENT_POLICY, ghosts, ghosts_used * sizeof(Ghost));
+}
+
+static bool arcRestore(ImageReader *reader, const unsigned int *frames, unsigned int count) {
+    const SavedArc *saved = (const SavedArc *)readImageSection(reader, SECTION_REPLACEMENT_POLICY, sizeof(SavedArc));
+    if (!saved || saved->ghosts_used > ghost_capacity || saved->target > frame_count || !loadList(reader, &arc_t1, ARC_T1) ||
+        !loadList(reader, &arc_t2, ARC_T2)) {
+        return false;
+    }
+    const SavedArcPage *pages = (const SavedArcPage *)readImageSection(reader, SECTION_REPLACEMENT_POLICY,
+                                                                        ((uint64_t)arc_t1.size + arc_t2.size) * sizeof(SavedArcPage));
+    const Ghost *saved_ghosts = (const Ghost *)readImageSection(reader, SECTION_REPLACEMENT_POLICY, saved->ghosts_used * sizeof(Ghost));
+    if (!pages || !saved_ghosts) {
+        return false;
+    }
+    loadArcPages(loadArcPages(pages, &arc_t1), &arc_t2);
+    arc_b1 = saved->b1;
+    arc_b2 = saved->b2;
+    ghost_free = saved->free_ghosts;
+    ghosts_used = saved->ghosts_used;
+    arc_target = saved->target;
+    memcpy(ghosts, saved_ghosts, ghosts_used * sizeof(Ghost));
+    // Every ghost handed out is on exactly one of B1, B2 and the free list.
+    if (!validGhostList(&arc_b1, GHOST_B1) || !validGhostList(&arc_b2, GHOST_B2) || !validGhostList(&ghost_free, GHOST_FREE) ||
+        (uint64_t)arc_b1.size + arc_b2.size + ghost_free.size != ghosts_used) {
+        return false;
+    }
+    for (unsigned int ghost = 0; ghost < ghosts_used; ghost++) {
+        ghosts[ghost].hash_next = 0;
+        if (ghosts[ghost].list != GHOST_FREE) {
+            unsigned int bucket = ghostBucket(ghosts[ghost].pid, ghosts[ghost].page);
+            ghosts[ghost].hash_next = ghost_buckets[bucket];
+            ghost_buckets[bucket] = (int)ghost + 1;
+        }
+    }
+    return true;
+}
+
+static const ReplacementPolicy policies[] = {
+    [POLICY_FIFO]  = { "fifo",  queueInitialize, queueLoad, fifoHit,  queueRelease, queueVictim, queueSave, queueRestore },
+    [POLICY_CLOCK] = { "clock", clockInitialize, clockLoad, clockHit, clockRelease, clockVictim, clockSave, clockRestore },
+    [POLICY_LRU]   = { "lru",   queueInitialize, queueLoad, lruHit,   queueRelease, queueVictim, queueSave, queueRestore },
+    [POLICY_ARC]   = { "arc",   arcInitialize,   arcLoad,   arcHit,   arcRelease,   arcVictim,   arcSave,   arcRestore },
+};
+
+// Returns the operations of a policy.
+const ReplacementPolicy* getReplacementPolicy(ReplacementPolicyType type) {
+    return &policies[type];
+}
+
+// Parses a policy name (fifo, clock, lru or arc).
+bool parseReplacementPolicy(const char* name, ReplacementPolicyType* type) {
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(name, policies[i].name) == 0) {
+            *type = (ReplacementPolicyType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the bytes of per-frame tables the policy needing the most (ARC) allocates for
+// num_frames frames.
+size_t replacementPolicyTableSize(unsigned int num_frames) {
+    size_t frame_arrays = (size_t)num_frames * (2 * sizeof(int) + 2);
+    size_t arc_arrays = (size_t)num_frames * (2 * sizeof(Ghost) + sizeof(unsigned int) + sizeof(uint64_t)) +
+                        ghostBucketCount(num_frames) * sizeof(int);
+    return frame_arrays + arc_arrays;
+}
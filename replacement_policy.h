@@ -0,0 +1,47 @@
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+#include "checkpoint.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Page replacement policies the frame manager can use.
+typedef enum {
+    POLICY_FIFO,        // Evict the page loaded longest ago.
+    POLICY_CLOCK,       // Second chance: skip frames referenced since the hand last passed.
+    POLICY_LRU,         // Evict the least recently used page.
+    POLICY_ARC          // Adaptive Replacement Cache: balances recency and frequency.
+} ReplacementPolicyType;
+
+// Operations of a replacement policy. Frames are identified by index; pages by (pid, page).
+typedef struct {
+    const char *name;
+    // Prepares the policy for num_frames frames, discarding any earlier state.
+    void (*initialize)(unsigned int num_frames);
+    // A page has been loaded into a frame.
+    void (*onLoad)(unsigned int frame, unsigned int pid, uint64_t page);
+    // A resident page has been accessed.
+    void (*onHit)(unsigned int frame);
+    // A frame has been released without eviction (its page was freed).
+    void (*onRelease)(unsigned int frame);
+    // Memory is full: returns the frame whose page should make room for (pid, page). The
+    // policy stops tracking the frame; onLoad follows for the incoming page.
+    unsigned int (*selectVictim)(unsigned int pid, uint64_t page);
+    // Writes the policy's state for the frames holding resident pages (the first frame of
+    // each, in increasing order) to an image, or restores it into the policy just initialized
+    // for the same number of frames. load returns false if the image does not hold it.
+    void (*save)(ImageWriter *writer, const unsigned int *frames, unsigned int count);
+    bool (*load)(ImageReader *reader, const unsigned int *frames, unsigned int count);
+} ReplacementPolicy;
+
+// Returns the operations of a policy.
+const ReplacementPolicy* getReplacementPolicy(ReplacementPolicyType type);
+
+// Parses a policy name (fifo, clock, lru or arc).
+bool parseReplacementPolicy(const char* name, ReplacementPolicyType* type);
+
+// Returns the most memory any policy allocates for its per-frame tables with num_frames frames.
+size_t replacementPolicyTableSize(unsigned int num_frames);
+
+#endif // REPLACEMENT_POLICY_H
@@ -1,85 +1,262 @@
 #include "scheduler.h"
+#include "trace.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-#define MAX_PROCESSES 10
+#define INITIAL_QUEUE_CAPACITY 64   // Ready queue slots; always a power of two.
+#define INITIAL_INDEX_CAPACITY 128  // Pid index slots; always a power of two, at most half full.
+#define NOT_QUEUED UINT64_MAX
 
-// Process queue
-static Process process_queue[MAX_PROCESSES];
-static int queue_size = 0;
-static int current_index = 0; // For Round-Robin scheduling
+// A process known to the scheduler and its position in the ready queue.
+typedef struct {
+    Process *process;               // NULL for an empty slot.
+    uint64_t position;              // NOT_QUEUED if the process is not ready.
+} IndexSlot;
+
+// Ready queue: a ring buffer of the processes waiting for the CPU, in round-robin order.
+// Processes are owned by the process registry; the queue holds pointers to them. Positions
+// only grow, and position p is held in slot p & (queue_capacity - 1). A process that stops
+// being ready out of turn leaves an empty slot, skipped when it reaches the head.
+static Process **ready_queue;
+static size_t queue_capacity = 0;
+static uint64_t queue_head = 0;     // Position of the next process to run.
+static uint64_t queue_tail = 0;     // Position the next ready process is queued at.
+static size_t ready_count = 0;      // Processes in the queue, not counting empty slots.
+
+// Open-addressing hash table from pid to every process added to the scheduler, so a state
+// transition finds the process's slot without scanning the queue.
+static IndexSlot *pid_index;
+static size_t index_capacity = 0;
+static size_t index_count = 0;
+
+// Allocate a zeroed array
+static void* allocate_array(size_t count, size_t size) {
+    void *array = calloc(count, size);
+    if (!array) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+// Spread consecutive pids across the index (Fibonacci hashing)
+static inline size_t index_slot_for(int process_id, size_t capacity) {
+    return (size_t)(((uint64_t)(unsigned int)process_id * 0x9e3779b97f4a7c15ULL) >> 32) & (capacity - 1);
+}
+
+// Find the index slot of a process, or the empty slot it would go in
+static IndexSlot* find_slot(int process_id) {
+    size_t slot = index_slot_for(process_id, index_capacity);
+    while (pid_index[slot].process && pid_index[slot].process->process_id != process_id) {
+        slot = (slot + 1) & (index_capacity - 1);
+    }
+    return &pid_index[slot];
+}
+
+// Double the index and reinsert every process
+static void grow_index() {
+    IndexSlot *old_index = pid_index;
+    size_t old_capacity = index_capacity;
+    index_capacity *= 2;
+    pid_index = (IndexSlot *)allocate_array(index_capacity, sizeof(IndexSlot));
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_index[i].process) {
+            *find_slot(old_index[i].process->process_id) = old_index[i];
+        }
+    }
+    free(old_index);
+}
+
+// Make room at the tail of a full queue: move the queued processes to the front of a new
+// ring, dropping the empty slots, and double it unless that leaves it at most half full
+static void compact_queue() {
+    size_t new_capacity = ready_count > queue_capacity / 2 ? queue_capacity * 2 : queue_capacity;
+    Process **new_queue = (Process **)allocate_array(new_capacity, sizeof(Process *));
+    uint64_t count = 0;
+    for (uint64_t position = queue_head; position < queue_tail; position++) {
+        Process *p = ready_queue[position & (queue_capacity - 1)];
+        if (p) {
+            find_slot(p->process_id)->position = count;
+            new_queue[count++] = p;
+        }
+    }
+    free(ready_queue);
+    ready_queue = new_queue;
+    queue_capacity = new_capacity;
+    queue_head = 0;
+    queue_tail = count;
+}
+
+// Queue a process at the tail
+static void enqueue(IndexSlot *entry) {
+    if (queue_tail - queue_head == queue_capacity) {
+        compact_queue();
+    }
+    ready_queue[queue_tail & (queue_capacity - 1)] = entry->process;
+    entry->position = queue_tail++;
+    ready_count++;
+}
+
+// Take a process out of the queue, leaving its slot empty
+static void dequeue(IndexSlot *entry) {
+    ready_queue[entry->position & (queue_capacity - 1)] = NULL;
+    entry->position = NOT_QUEUED;
+    ready_count--;
+}
+
+// Return the process at the head of the queue, skipping empty slots, or NULL
+static Process* queue_front() {
+    while (queue_head < queue_tail && ready_queue[queue_head & (queue_capacity - 1)] == NULL) {
+        queue_head++;
+    }
+    return queue_head < queue_tail ? ready_queue[queue_head & (queue_capacity - 1)] : NULL;
+}
 
 // Initialize the scheduler
 void initialize_scheduler() {
-    queue_size = 0;
-    current_index = 0;
+    free(ready_queue);
+    free(pid_index);
+    queue_capacity = INITIAL_QUEUE_CAPACITY;
+    ready_queue = (Process **)allocate_array(queue_capacity, sizeof(Process *));
+    index_capacity = INITIAL_INDEX_CAPACITY;
+    pid_index = (IndexSlot *)allocate_array(index_capacity, sizeof(IndexSlot));
+    queue_head = 0;
+    queue_tail = 0;
+    ready_count = 0;
+    index_count = 0;
 }
 
-// Add a process to the scheduler
-bool add_process(Process p) {
-    if (queue_size >= MAX_PROCESSES) {
+// Add a process to the scheduler, queueing it if it is ready. Returns false if a process
+// with the same id was already added.
+bool add_process(Process *p) {
+    if ((index_count + 1) * 2 > index_capacity) {
+        grow_index();
+    }
+    IndexSlot *entry = find_slot(p->process_id);
+    if (entry->process) {
         return false;
     }
-    process_queue[queue_size++] = p;
+    entry->process = p;
+    entry->position = NOT_QUEUED;
+    index_count++;
+    if (p->state == READY || p->state == RUNNING) {
+        enqueue(entry);
+    }
     return true;
 }
 
 // Execute the scheduler - simple Round-Robin for demonstration
 void execute_scheduler() {
-    if (queue_size == 0) {
+    // Select the next process
+    Process *current_process = queue_front();
+    if (current_process == NULL) {
         return;
     }
-
-    // Select the next process
-    Process *current_process = &process_queue[current_index];
+    IndexSlot *entry = find_slot(current_process->process_id);
+    dequeue(entry);
+    queue_head++;
     current_process->state = RUNNING;
 
     // Simulate process execution
-    printf("Running process: %d\n", current_process->process_id);
+    traceEvent(TRACE_PROCESS_RUNNING, current_process->process_id, 0, 0, 0);
     current_process->burst_time--; // Decrement burst time
 
-    // Check if the process is completed
+    // Check if the process is completed; a completed process leaves the queue
     if (current_process->burst_time <= 0) {
         current_process->state = TERMINATED;
-        printf("Process %d terminated\n", current_process->process_id);
+        traceEvent(TRACE_PROCESS_TERMINATED, current_process->process_id, 0, 0, 0);
     } else {
         current_process->state = READY;
+        enqueue(entry);
     }
-
-    // Move to the next process
-    current_index = (current_index + 1) % queue_size;
 }
 
-// Change the state of a process
+// Change the state of a process. A process becoming ready joins the tail of the queue, and
+// one that is waiting or terminated leaves it.
 void process_state_transition(int process_id, ProcessState new_state) {
-    for (int i = 0; i < queue_size; i++) {
-        if (process_queue[i].process_id == process_id) {
-            process_queue[i].state = new_state;
-            break;
-        }
+    IndexSlot *entry = find_slot(process_id);
+    if (entry->process == NULL) {
+        return;
+    }
+    entry->process->state = new_state;
+    bool ready = new_state == READY || new_state == RUNNING;
+    if (ready && entry->position == NOT_QUEUED) {
+        enqueue(entry);
+    } else if (!ready && entry->position != NOT_QUEUED) {
+        dequeue(entry);
     }
 }
 
-// List all processes in the scheduler
+// List all processes in the scheduler, in the order they will run
 void list_all_processes() {
-    for (int i = 0; i < queue_size; i++) {
-        printf("Process ID: %d, State: %d, Burst Time: %d\n", 
-               process_queue[i].process_id, 
-               process_queue[i].state, 
-               process_queue[i].burst_time);
+    for (uint64_t position = queue_head; position < queue_tail; position++) {
+        Process *p = ready_queue[position & (queue_capacity - 1)];
+        if (p) {
+            printf("Process ID: %d, State: %d, Burst Time: %d\n", p->process_id, p->state, p->burst_time);
+        }
     }
 }
 
 // Show the current process
 void show_current_process() {
-    if (queue_size > 0) {
-        Process current_process = process_queue[current_index];
-        printf("Current Process ID: %d, State: %d, Burst Time: %d\n", 
-               current_process.process_id, 
-               current_process.state, 
-               current_process.burst_time);
+    Process *current_process = queue_front();
+    if (current_process) {
+        printf("Current Process ID: %d, State: %d, Burst Time: %d\n",
+               current_process->process_id,
+               current_process->state,
+               current_process->burst_time);
     } else {
         printf("No current process.\n");
     }
 }
 
+// The scheduler as saved in an image, followed by the ids of every process added to it:
+// first the queued ones, in the order they will run, then the others.
+typedef struct {
+    uint64_t queued;
+    uint64_t other;
+} SavedScheduler;
+
+// Write the queue to an image
+void save_scheduler(ImageWriter *writer) {
+    SavedScheduler saved = { ready_count, index_count - ready_count };
+    int32_t *ids = (int32_t *)allocate_array(index_count ? index_count : 1, sizeof(int32_t));
+    size_t count = 0;
+    for (uint64_t position = queue_head; position < queue_tail; position++) {
+        Process *p = ready_queue[position & (queue_capacity - 1)];
+        if (p) {
+            ids[count++] = p->process_id;
+        }
+    }
+    for (size_t i = 0; i < index_capacity; i++) {
+        if (pid_index[i].process && pid_index[i].position == NOT_QUEUED) {
+            ids[count++] = pid_index[i].process->process_id;
+        }
+    }
+    writeImageSection(writer, SECTION_SCHEDULER, &saved, sizeof(saved));
+    writeImageSection(writer, SECTION_SCHEDULER, ids, (uint64_t)count * sizeof(int32_t));
+    free(ids);
+}
+
+// Restore the queue from an image
+bool load_scheduler(ImageReader *reader, Process* (*find)(int process_id)) {
+    const SavedScheduler *saved = (const SavedScheduler *)readImageSection(reader, SECTION_SCHEDULER, sizeof(SavedScheduler));
+    if (saved == NULL || saved->queued > reader->size || saved->other > reader->size) {
+        return false;
+    }
+    uint64_t count = saved->queued + saved->other;
+    const int32_t *ids = (const int32_t *)readImageSection(reader, SECTION_SCHEDULER, count * sizeof(int32_t));
+    if (ids == NULL) {
+        return false;
+    }
+    initialize_scheduler();
+    for (uint64_t i = 0; i < count; i++) {
+        Process *p = find(ids[i]);
+        bool ready = p != NULL && (p->state == READY || p->state == RUNNING);
+        if (p == NULL || ready != (i < saved->queued) || !add_process(p)) {
+            return false;
+        }
+    }
+    return true;
+}
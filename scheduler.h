@@ -1,6 +1,7 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include "checkpoint.h"
 #include <stdbool.h>
 
 // Process states
@@ -20,8 +21,13 @@ typedef struct {
 
 // Function prototypes
 void initialize_scheduler();
-bool add_process(Process p);
+bool add_process(Process *p);
 void execute_scheduler();
 void process_state_transition(int process_id, ProcessState new_state);
 
+// Writes the queue to an image, naming processes by id, or restores it, looking each id up
+// with find. load_scheduler returns false if the image does not hold a valid queue.
+void save_scheduler(ImageWriter *writer);
+bool load_scheduler(ImageReader *reader, Process* (*find)(int process_id));
+
 #endif // SCHEDULER_H
@@ -0,0 +1,186 @@
+#include "script_file.h"
+#include "runCommand.h"
+#include "append_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Consumed script pages are handed back to the kernel in batches of at least this size.
+#define DISCARD_BATCH_SIZE (16 * 1024 * 1024)
+
+// Reads the whole of an unmappable file into a NUL-terminated heap copy, for callers that
+// keep every line. Returns false on a read error.
+static bool readWholeFile(int fd, ScriptFile* script) {
+    size_t capacity = 64 * 1024;
+    char *data = malloc(capacity);
+    size_t length = 0;
+    for (;;) {
+        if (data == NULL) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+        if (length + 1 == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            continue;
+        }
+        ssize_t result = read(fd, data + length, capacity - length - 1);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            free(data);
+            return false;
+        }
+        if (result == 0) {
+            break;
+        }
+        length += (size_t)result;
+    }
+    data[length] = '\0';
+    script->data = data;
+    script->length = length;
+    script->heapCopy = true;
+    return true;
+}
+
+// Maps a script file for reading. The mapping is private and writable so lines can be
+// NUL-terminated in place without touching the file. With discardConsumed set, pages whose
+// lines have all been returned are released as the script advances, keeping memory flat for
+// very large scripts; callers that hold on to earlier lines must leave it unset.
+// Anything other than a regular file has no size to map, so it is read with getline one
+// line at a time, or with discardConsumed unset read whole into the heap.
+bool openScriptFile(const char* fileName, ScriptFile* script, bool discardConsumed) {
+    memset(script, 0, sizeof(*script));
+    script->discardConsumed = discardConsumed;
+
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    if (!S_ISREG(info.st_mode)) {
+        bool ok = true;
+        if (discardConsumed) {
+            script->stream = fdopen(fd, "r");
+            ok = script->stream != NULL;
+        } else {
+            ok = readWholeFile(fd, script);
+        }
+        if (script->stream == NULL) {
+            close(fd);
+        }
+        return ok;
+    }
+
+    script->length = (size_t)info.st_size;
+    script->mappedLength = script->length;
+    if (script->length > 0) {
+        script->data = mmap(NULL, script->mappedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (script->data == MAP_FAILED) {
+            script->data = NULL;
+            close(fd);
+            return false;
+        }
+        madvise(script->data, script->mappedLength, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return true;
+}
+
+// Returns the next line of the script as a NUL-terminated string, or NULL at the end.
+// The string may be modified and remains valid until the script is closed (or, when
+// consumed pages are discarded, until the next call).
+char* nextScriptLine(ScriptFile* script) {
+    if (script->stream != NULL) {
+        ssize_t length = getline(&script->streamLine, &script->streamCapacity, script->stream);
+        if (length < 0) {
+            return NULL;
+        }
+        if (length > 0 && script->streamLine[length - 1] == '\n') {
+            script->streamLine[length - 1] = '\0';
+        }
+        return script->streamLine;
+    }
+    if (script->position >= script->length) {
+        return NULL;
+    }
+
+    if (script->discardConsumed && script->position - script->discardedUpTo >= DISCARD_BATCH_SIZE) {
+        // Drop the private copies of pages that only held already-executed lines.
+        size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        size_t end = script->position & ~(pageSize - 1);
+        madvise(script->data + script->discardedUpTo, end - script->discardedUpTo, MADV_DONTNEED);
+        script->discardedUpTo = end;
+    }
+
+    char *line = script->data + script->position;
+    size_t remaining = script->length - script->position;
+    char *newline = memchr(line, '\n', remaining);
+    if (newline != NULL) {
+        *newline = '\0';
+        script->position += (size_t)(newline - line) + 1;
+        return line;
+    }
+
+    // Final line without a newline. The rest of its page past the end of the file is
+    // zero-filled, so it is already terminated unless the file ends exactly on a page boundary.
+    // A heap copy is always terminated.
+    script->position = script->length;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (script->heapCopy || script->length % pageSize != 0) {
+        return line;
+    }
+    free(script->lastLine);
+    script->lastLine = strndup(line, remaining);
+    if (script->lastLine == NULL) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    return script->lastLine;
+}
+
+// Unmaps or closes a script file and frees its state.
+void closeScriptFile(ScriptFile* script) {
+    if (script->heapCopy) {
+        free(script->data);
+    } else if (script->data != NULL) {
+        munmap(script->data, script->mappedLength);
+    }
+    if (script->stream != NULL) {
+        fclose(script->stream);
+    }
+    free(script->streamLine);
+    free(script->lastLine);
+    memset(script, 0, sizeof(*script));
+}
+
+// Runs a script inside the shell: each line goes through runCommand exactly as if it had
+// been typed at the prompt, so scripts can use every lopesShell command.
+// Returns false if the file could not be opened.
+bool executeScriptFile(const char* fileName) {
+    ScriptFile script;
+    if (!openScriptFile(fileName, &script, true)) {
+        return false;
+    }
+
+    char *line;
+    while ((line = nextScriptLine(&script)) != NULL) {
+        runCommand(line);
+    }
+    flushAppendCache();
+
+    closeScriptFile(&script);
+    return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// A script file mapped into memory and consumed one line at a time. Lines are returned in
+// place: the newline is replaced by NUL in a private copy-on-write mapping of the file.
+// Files that cannot be mapped (pipes, terminals, /dev/stdin) are read instead.
+typedef struct {
+    char *data;                 // Start of the mapping or heap copy, or NULL for an empty file.
+    size_t length;              // Size of the file in bytes.
+    size_t mappedLength;        // Size of the mapping.
+    size_t position;            // Offset of the next unread line.
+    size_t discardedUpTo;       // Offset up to which consumed pages have been released.
+    bool discardConsumed;       // Release pages once their lines have been executed.
+    char *lastLine;             // Heap copy of a final unterminated line that fills its page.
+    bool heapCopy;              // data was read into the heap rather than mapped.
+    FILE *stream;               // Unmappable file read one line at a time, or NULL.
+    char *streamLine;           // getline buffer for stream, reused for every line.
+    size_t streamCapacity;
+} ScriptFile;
+
+bool openScriptFile(const char* fileName, ScriptFile* script, bool discardConsumed);
+char* nextScriptLine(ScriptFile* script);
+void closeScriptFile(ScriptFile* script);
+bool executeScriptFile(const char* fileName);
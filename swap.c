@@ -0,0 +1,449 @@
+#include "swap.h"
+#include "vmm.h"
+#include "utilities.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Transfers are staged through buffers of at most this many bytes (and at least one page).
+#define SWAP_BUFFER_BYTES (4 * 1024 * 1024)
+
+// The swap device: a file divided into page-sized slots. Slots in use are marked in a bitmap
+// searched the way the frame bitmap is, from where the last free slot was found, so pages
+// evicted one after another land in neighbouring slots. Each slot counts the page table
+// entries pointing to it, plus one for a resident frame keeping it as a copy of its page.
+static int swap_fd = -1;
+static char *swap_path;
+static uint64_t page_size;
+static uint64_t num_slots;
+static uint64_t *slot_bitmap;
+static uint64_t num_words;
+static uint64_t search_word;
+static uint32_t *slot_references;
+static uint64_t slots_in_use;
+static SwapStats stats;
+
+// Pages are written from, and huge pages read into, a staging buffer. Single pages are read
+// with the aligned cluster of slots around them into the readahead buffer, which keeps them
+// until one of its slots is written again.
+static unsigned char *io_buffer;
+static uint64_t io_pages;
+static unsigned char *readahead_buffer;
+static unsigned int readahead;
+static uint64_t readahead_first;
+static uint64_t readahead_count;
+
+// Starts swapping to an open file of slots page-sized slots, all free.
+static void setUpSwap(int fd, const char *path, uint64_t slots, uint64_t slot_size, unsigned int readahead_pages) {
+    page_size = slot_size;
+    num_slots = slots;
+    io_pages = page_size < SWAP_BUFFER_BYTES ? SWAP_BUFFER_BYTES / page_size : 1;
+    readahead = readahead_pages < io_pages ? readahead_pages : (unsigned int)io_pages;
+    num_words = (num_slots + 63) / 64;
+    slot_bitmap = (uint64_t *)calloc(num_words, sizeof(uint64_t));
+    slot_references = (uint32_t *)calloc(num_slots, sizeof(uint32_t));
+    io_buffer = (unsigned char *)calloc(io_pages, page_size);
+    readahead_buffer = (unsigned char *)calloc(readahead, page_size);
+    swap_path = copyString((char *)path);
+    if (!slot_bitmap || !slot_references || !io_buffer || !readahead_buffer) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    // Mark the bits past the last slot as used so the scan never returns them.
+    if (num_slots % 64 != 0) {
+        slot_bitmap[num_words - 1] = ~0ULL << (num_slots % 64);
+    }
+    swap_fd = fd;
+}
+
+// Opens or creates the swap file and sets up its slots.
+const char* enableSwap(const char *path, uint64_t size, unsigned int readahead_pages) {
+    if (swap_fd >= 0) {
+        return "swap is already on";
+    }
+    page_size = memoryGeometry()->page_size;
+    if (size < page_size) {
+        return "the swap size must be at least one page";
+    }
+    if (readahead_pages == 0 || readahead_pages > MAX_SWAP_READAHEAD) {
+        return "readahead must be from 1 to 256 pages";
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return strerror(errno);
+    }
+    uint64_t slots = size / page_size;
+    if (ftruncate(fd, (off_t)(slots * page_size)) != 0) {
+        const char *problem = strerror(errno);
+        close(fd);
+        return problem;
+    }
+    setUpSwap(fd, path, slots, page_size, readahead_pages);
+    return NULL;
+}
+
+// Returns true if a swap device is in use.
+bool swapEnabled() {
+    return swap_fd >= 0;
+}
+
+// Returns true if a slot holds a page.
+static inline bool slotInUse(uint64_t slot) {
+    return (slot_bitmap[slot / 64] >> (slot % 64)) & 1;
+}
+
+// Reserves count free consecutive slots, with no references yet, and returns the first, or
+// -1 if there are none. Runs of more than one slot hold huge pages and are aligned to their
+// size, so they are whole bitmap words.
+static int64_t reserveSwapSlots(uint64_t count) {
+    if (num_slots - slots_in_use < count) {
+        return -1;
+    }
+    if (count == 1) {
+        for (uint64_t i = 0; i < num_words; i++) {
+            uint64_t word = (search_word + i) % num_words;
+            if (slot_bitmap[word] != ~0ULL) {
+                unsigned int bit = (unsigned int)__builtin_ctzll(~slot_bitmap[word]);
+                slot_bitmap[word] |= 1ULL << bit;
+                search_word = word;
+                slots_in_use++;
+                return (int64_t)(word * 64 + bit);
+            }
+        }
+        return -1;
+    }
+
+    uint64_t words_per_run = count / 64;
+    for (uint64_t start = 0; start + words_per_run <= num_words; start += words_per_run) {
+        uint64_t word = start;
+        while (word < start + words_per_run && slot_bitmap[word] == 0) {
+            word++;
+        }
+        if (word == start + words_per_run) {
+            memset(&slot_bitmap[start], 0xff, words_per_run * sizeof(uint64_t));
+            slots_in_use += count;
+            return (int64_t)(start * 64);
+        }
+    }
+    return -1;
+}
+
+// Chooses the slot an evicted page is left pointing to. A clean page goes back to its copy,
+// if it has one. A dirty page is written over its copy when nothing else refers to it, and
+// otherwise to new slots.
+uint64_t swapSlotFor(SwapOut *swap_out, bool dirty) {
+    if (!dirty) {
+        swap_out->slot = swap_out->copy;
+    } else if (swap_out->slot == 0) {
+        bool copy_shared = false;
+        for (uint64_t i = 0; swap_out->copy && i < swap_out->count; i++) {
+            copy_shared = copy_shared || slot_references[swap_out->copy - 1 + i] > 1;
+        }
+        if (swap_out->copy && !copy_shared) {
+            swap_out->slot = swap_out->copy;
+        } else if (!swap_out->full) {
+            swap_out->slot = (uint64_t)(reserveSwapSlots(swap_out->count) + 1);
+        }
+        swap_out->write = swap_out->slot != 0;
+        if (!swap_out->write && !swap_out->full) {
+            swap_out->full = true;
+            stats.full++;
+        }
+    }
+    if (swap_out->slot) {
+        retainSwapSlots(swap_out->slot - 1, swap_out->count);
+    }
+    return swap_out->slot;
+}
+
+// Adds a reference to count consecutive slots.
+void retainSwapSlots(uint64_t first, uint64_t count) {
+    for (uint64_t slot = first; slot < first + count; slot++) {
+        slot_references[slot]++;
+    }
+}
+
+// Drops a reference to count consecutive slots, freeing those left with none.
+void releaseSwapSlots(uint64_t first, uint64_t count) {
+    for (uint64_t slot = first; slot < first + count; slot++) {
+        if (--slot_references[slot] == 0) {
+            slot_bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+            slots_in_use--;
+        }
+    }
+}
+
+// Reads or writes length bytes at a file offset, retrying short transfers. Returns false
+// after reporting an I/O error.
+static bool transfer(bool write, unsigned char *buffer, uint64_t length, uint64_t offset) {
+    uint64_t done = 0;
+    while (done < length) {
+        ssize_t result = write ? pwrite(swap_fd, buffer + done, length - done, (off_t)(offset + done))
+                               : pread(swap_fd, buffer + done, length - done, (off_t)(offset + done));
+        if (write) {
+            stats.writes++;
+        } else {
+            stats.reads++;
+        }
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "swap: %s: %s\n", swap_path, result < 0 ? strerror(errno) : "unexpected end of file");
+            stats.errors++;
+            return false;
+        }
+        done += (uint64_t)result;
+        if (write) {
+            stats.bytes_written += (uint64_t)result;
+        } else {
+            stats.bytes_read += (uint64_t)result;
+        }
+    }
+    return true;
+}
+
+// Each page written to swap starts with its page number, which is checked when it is read
+// back; the rest of the page is zero.
+static void stampPage(unsigned char *data, uint64_t page) {
+    memcpy(data, &page, sizeof(page));
+}
+
+// Reports a page read back from a slot that does not hold the expected page.
+static void checkPage(const unsigned char *data, uint64_t slot, uint64_t page) {
+    uint64_t stored;
+    memcpy(&stored, data, sizeof(stored));
+    if (stored != page) {
+        fprintf(stderr, "swap: slot %llu holds page %llu instead of page %llu\n", (unsigned long long)slot,
+                (unsigned long long)stored, (unsigned long long)page);
+        stats.errors++;
+    }
+}
+
+// Writes count pages to the slots starting at first, as few large writes as the staging
+// buffer allows.
+void writeSwapSlots(uint64_t first, uint64_t page, uint64_t count) {
+    if (first < readahead_first + readahead_count && readahead_first < first + count) {
+        readahead_count = 0;
+    }
+    for (uint64_t done = 0; done < count;) {
+        uint64_t n = count - done < io_pages ? count - done : io_pages;
+        for (uint64_t i = 0; i < n; i++) {
+            stampPage(io_buffer + i * page_size, page + done + i);
+        }
+        transfer(true, io_buffer, n * page_size, (first + done) * page_size);
+        done += n;
+    }
+    stats.page_outs += count;
+}
+
+// Reads count pages back from the slots starting at first. A single page comes from the
+// readahead buffer if it was read ahead; otherwise its aligned cluster is read, trimmed to
+// the slots in use at either end.
+void readSwapSlots(uint64_t first, uint64_t page, uint64_t count) {
+    stats.page_ins += count;
+    if (count == 1) {
+        if (first >= readahead_first && first < readahead_first + readahead_count) {
+            stats.readahead_hits++;
+            checkPage(readahead_buffer + (first - readahead_first) * page_size, first, page);
+            return;
+        }
+        uint64_t start = first - first % readahead;
+        uint64_t end = start + readahead < num_slots ? start + readahead : num_slots;
+        while (start < first && !slotInUse(start)) {
+            start++;
+        }
+        while (end - 1 > first && !slotInUse(end - 1)) {
+            end--;
+        }
+        readahead_count = 0;
+        if (!transfer(false, readahead_buffer, (end - start) * page_size, start * page_size)) {
+            return;
+        }
+        for (uint64_t slot = start; slot < end; slot++) {
+            stats.readahead_pages += slot != first && slotInUse(slot);
+        }
+        readahead_first = start;
+        readahead_count = end - start;
+        checkPage(readahead_buffer + (first - start) * page_size, first, page);
+        return;
+    }
+
+    for (uint64_t done = 0; done < count;) {
+        uint64_t n = count - done < io_pages ? count - done : io_pages;
+        if (!transfer(false, io_buffer, n * page_size, (first + done) * page_size)) {
+            return;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            checkPage(io_buffer + i * page_size, first + done + i, page + done + i);
+        }
+        done += n;
+    }
+}
+
+// Records the time taken to service a page fault.
+void recordFaultLatency(bool major, uint64_t nanoseconds) {
+    uint64_t *faults = major ? &stats.major_faults : &stats.minor_faults;
+    uint64_t *total = major ? &stats.major_fault_ns : &stats.minor_fault_ns;
+    uint64_t *longest = major ? &stats.max_major_fault_ns : &stats.max_minor_fault_ns;
+    (*faults)++;
+    *total += nanoseconds;
+    if (nanoseconds > *longest) {
+        *longest = nanoseconds;
+    }
+}
+
+// Returns the number of slots holding a page.
+uint64_t swapSlotsInUse() {
+    return slots_in_use;
+}
+
+// Returns the number of slots on the device.
+uint64_t totalSwapSlots() {
+    return num_slots;
+}
+
+// Returns the swap counters.
+const SwapStats* swapStats() {
+    return &stats;
+}
+
+// Prints the swap device and its counters.
+void printSwapStats() {
+    if (swap_fd < 0) {
+        printf("Swap is off.\n");
+        return;
+    }
+    printf("Swap: %s, %llu of %llu slots in use, readahead %u pages\n", swap_path, (unsigned long long)slots_in_use,
+           (unsigned long long)num_slots, readahead);
+    printf("  %llu pages out in %llu writes (%llu bytes), %llu pages in in %llu reads (%llu bytes)\n",
+           (unsigned long long)stats.page_outs, (unsigned long long)stats.writes, (unsigned long long)stats.bytes_written,
+           (unsigned long long)stats.page_ins, (unsigned long long)stats.reads, (unsigned long long)stats.bytes_read);
+    printf("  %llu pages read ahead, %llu faults served by readahead, %llu dirty pages dropped with swap full, %llu errors\n",
+           (unsigned long long)stats.readahead_pages, (unsigned long long)stats.readahead_hits, (unsigned long long)stats.full,
+           (unsigned long long)stats.errors);
+    printf("  Fault service: %llu major faults, %.2f us average, %.2f us max; %llu minor faults, %.2f us average, %.2f us max\n",
+           (unsigned long long)stats.major_faults,
+           stats.major_faults ? (double)stats.major_fault_ns / (double)stats.major_faults / 1e3 : 0.0,
+           (double)stats.max_major_fault_ns / 1e3, (unsigned long long)stats.minor_faults,
+           stats.minor_faults ? (double)stats.minor_fault_ns / (double)stats.minor_faults / 1e3 : 0.0,
+           (double)stats.max_minor_fault_ns / 1e3);
+}
+
+// The swap device as saved in an image. With swap on, it is followed by sections holding the
+// path of the swap file, the slot bitmap and the slot reference counts. The pages themselves
+// stay in the swap file, which must not change until the image is loaded; so do the pages
+// in the readahead buffer, which are read again from it.
+typedef struct {
+    uint64_t num_slots;             // 0 if swap was off.
+    uint64_t page_size;
+    uint64_t readahead;
+    uint64_t search_word;
+    uint64_t slots_in_use;
+    uint64_t readahead_first;
+    uint64_t readahead_count;
+    int64_t modified_seconds;       // Modification time of the swap file when the image was saved.
+    int64_t modified_nanoseconds;
+    uint64_t path_length;           // Including the terminating NUL.
+    SwapStats stats;
+} SavedSwap;
+
+// Writes the swap device to an image.
+void saveSwap(ImageWriter *writer) {
+    SavedSwap saved = { 0 };
+    struct stat info;
+    if (swap_fd >= 0) {
+        if (fstat(swap_fd, &info) != 0) {
+            writer->failed = true;
+            return;
+        }
+        saved = (SavedSwap){ num_slots, page_size, readahead, search_word, slots_in_use, readahead_first, readahead_count,
+                             (int64_t)info.st_mtim.tv_sec, (int64_t)info.st_mtim.tv_nsec, strlen(swap_path) + 1, stats };
+    }
+    writeImageSection(writer, SECTION_SWAP, &saved, sizeof(saved));
+    if (swap_fd >= 0) {
+        writeImageSection(writer, SECTION_SWAP, swap_path, saved.path_length);
+        writeImageSection(writer, SECTION_SWAP, slot_bitmap, num_words * sizeof(uint64_t));
+        writeImageSection(writer, SECTION_SWAP, slot_references, num_slots * sizeof(uint32_t));
+    }
+}
+
+// Restores the swap device from an image, reopening its file, which must not have changed
+// since the image was saved. Returns NULL on success, or a description of the problem; swap
+// is then left off.
+const char* loadSwap(ImageReader *reader, uint64_t expected_page_size) {
+    const SavedSwap *saved = (const SavedSwap *)readImageSection(reader, SECTION_SWAP, sizeof(SavedSwap));
+    if (!saved) {
+        return "the image is damaged";
+    }
+    if (saved->num_slots == 0) {
+        return NULL;
+    }
+    uint64_t words = (saved->num_slots + 63) / 64;
+    if (saved->page_size != expected_page_size || saved->readahead == 0 || saved->readahead > MAX_SWAP_READAHEAD ||
+        saved->search_word >= words || saved->slots_in_use > saved->num_slots || saved->path_length == 0 ||
+        saved->num_slots > UINT64_MAX / saved->page_size) {
+        return "the image is damaged";
+    }
+    const char *path = (const char *)readImageSection(reader, SECTION_SWAP, saved->path_length);
+    const uint64_t *bitmap = (const uint64_t *)readImageSection(reader, SECTION_SWAP, words * sizeof(uint64_t));
+    const uint32_t *references = (const uint32_t *)readImageSection(reader, SECTION_SWAP, saved->num_slots * sizeof(uint32_t));
+    if (!path || !bitmap || !references || strlen(path) + 1 != saved->path_length) {
+        return "the image is damaged";
+    }
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        const char *problem = strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return problem;
+    }
+    if ((uint64_t)info.st_size != saved->num_slots * saved->page_size || (int64_t)info.st_mtim.tv_sec != saved->modified_seconds ||
+        (int64_t)info.st_mtim.tv_nsec != saved->modified_nanoseconds) {
+        close(fd);
+        return "the swap file has changed since the image was saved";
+    }
+    setUpSwap(fd, path, saved->num_slots, saved->page_size, (unsigned int)saved->readahead);
+    memcpy(slot_bitmap, bitmap, words * sizeof(uint64_t));
+    memcpy(slot_references, references, saved->num_slots * sizeof(uint32_t));
+    search_word = saved->search_word;
+    slots_in_use = saved->slots_in_use;
+    // Refill the readahead buffer; pages it cannot hold are simply read again when faulted.
+    if (saved->readahead_count <= readahead && saved->readahead_first <= num_slots - saved->readahead_count &&
+        transfer(false, readahead_buffer, saved->readahead_count * page_size, saved->readahead_first * page_size)) {
+        readahead_first = saved->readahead_first;
+        readahead_count = saved->readahead_count;
+    }
+    stats = saved->stats;
+    return NULL;
+}
+
+// swapon | swapon <file> [size] [readahead]
+void executeSwapOn(char** arguments) {
+    if (!arguments[1]) {
+        printSwapStats();
+        return;
+    }
+    uint64_t size = memoryGeometry()->physical_memory * 2;
+    char *end = NULL;
+    unsigned long pages = DEFAULT_SWAP_READAHEAD;
+    if ((arguments[2] && !parseSize(arguments[2], &size)) ||
+        (arguments[2] && arguments[3] && ((pages = strtoul(arguments[3], &end, 10)) > MAX_SWAP_READAHEAD || *end != '\0'))) {
+        printf("Usage: swapon | swapon <file> [size] [readahead_pages]\n");
+        return;
+    }
+    const char *problem = enableSwap(arguments[1], size, (unsigned int)pages);
+    if (problem) {
+        printf("swapon: %s: %s\n", arguments[1], problem);
+        return;
+    }
+    printf("Swapping to %s: %llu slots of %llu bytes, readahead %u pages\n", arguments[1], (unsigned long long)num_slots,
+           (unsigned long long)page_size, readahead);
+}
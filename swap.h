@@ -0,0 +1,87 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "checkpoint.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Pages read around a faulting page by default: an aligned cluster of 8 swap slots.
+#define DEFAULT_SWAP_READAHEAD 8
+#define MAX_SWAP_READAHEAD 256
+
+// Swap device counters.
+typedef struct {
+    uint64_t page_outs;             // Pages written to swap.
+    uint64_t page_ins;              // Pages read back on a fault.
+    uint64_t writes;                // pwrite calls.
+    uint64_t reads;                 // pread calls.
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    uint64_t readahead_pages;       // Pages read ahead of a fault, besides the faulting page.
+    uint64_t readahead_hits;        // Faults served from pages read ahead.
+    uint64_t full;                  // Dirty pages dropped because no slot was free.
+    uint64_t errors;                // Failed reads and writes.
+    uint64_t major_faults;          // Faults that read the page from swap.
+    uint64_t major_fault_ns;        // Time spent servicing them.
+    uint64_t max_major_fault_ns;
+    uint64_t minor_faults;          // Faults that needed no read, timed while swap is on.
+    uint64_t minor_fault_ns;
+    uint64_t max_minor_fault_ns;
+} SwapStats;
+
+// Where the frame being evicted goes in swap. A frame loaded from swap keeps the slots it
+// came from as a copy. The slot is chosen when the first mapping of the frame is dropped,
+// and every later mapping gets the same one: processes sharing a frame after a fork agree
+// on whether it is dirty, since a write to a shared page copies it first.
+typedef struct {
+    uint64_t copy;                  // First slot + 1 of a copy of the page already in swap, or 0.
+    uint64_t count;                 // Slots the page needs: 2^order.
+    uint64_t slot;                  // First slot + 1 the page was swapped out to, or 0.
+    bool write;                     // The page is dirty and must be written to slot.
+    bool full;                      // The page is dirty but no slots were free.
+} SwapOut;
+
+// Opens or creates the file at path as the swap device, sized to hold size bytes of pages,
+// and reads readahead slots around each faulting page. Returns NULL on success, or a
+// description of the problem.
+const char* enableSwap(const char *path, uint64_t size, unsigned int readahead);
+
+// Returns true if a swap device is in use.
+bool swapEnabled();
+
+// Returns the first slot + 1 that the page being evicted is left pointing to, and takes a
+// reference to it for the entry, or returns 0 if the page is dropped: a clean page with no
+// copy in swap, or a dirty one when swap is full.
+uint64_t swapSlotFor(SwapOut *swap_out, bool dirty);
+
+// Adds or drops references to count consecutive slots. A slot is free again once its last
+// reference is dropped.
+void retainSwapSlots(uint64_t first, uint64_t count);
+void releaseSwapSlots(uint64_t first, uint64_t count);
+
+// Writes or reads count pages, starting at the given page number, to or from the slots
+// starting at first. A single page is read with the cluster of slots around it, and later
+// reads of those slots are served from memory.
+void writeSwapSlots(uint64_t first, uint64_t page, uint64_t count);
+void readSwapSlots(uint64_t first, uint64_t page, uint64_t count);
+
+// Records the time taken to service a page fault.
+void recordFaultLatency(bool major, uint64_t nanoseconds);
+
+// Returns the number of slots in use and in total, and the counters.
+uint64_t swapSlotsInUse();
+uint64_t totalSwapSlots();
+const SwapStats* swapStats();
+
+// Prints the swap device and its counters.
+void printSwapStats();
+
+// Writes the swap device to an image, or restores it by reopening its file, which must not
+// have changed since. loadSwap returns NULL on success, or a description of the problem.
+void saveSwap(ImageWriter *writer);
+const char* loadSwap(ImageReader *reader, uint64_t page_size);
+
+// swapon builtin.
+void executeSwapOn(char** arguments);
+
+#endif // SWAP_H
@@ -0,0 +1,303 @@
+#include "tlb.h"
+#include "vmm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_TLB_ENTRIES 64
+#define DEFAULT_TLB_WAYS 4
+#define SHOOTDOWN_QUEUE_SIZE 64     // Pending invalidations a CPU can hold before it must flush.
+
+// An invalidation posted to another CPU.
+typedef struct {
+    uint64_t page;
+    unsigned int asid;
+    unsigned int order;
+} Shootdown;
+
+// Invalidations waiting for a CPU, like the IPIs a kernel sends on a mapping change. Senders
+// are serialized by the caller and the receiving CPU drains the queue before each access.
+// When the queue is full the sender sets overflowed instead, and the receiver flushes its
+// whole TLB.
+typedef struct {
+    Shootdown requests[SHOOTDOWN_QUEUE_SIZE];
+    uint64_t posted __attribute__((aligned(64)));  // Written by senders.
+    bool overflowed;
+    uint64_t handled __attribute__((aligned(64))); // Written by the receiving CPU.
+} ShootdownQueue;
+
+// One CPU's TLB: an array of sets, each holding `ways` entries side by side. A page maps to
+// the set given by the low bits of its page number, as in hardware.
+typedef struct {
+    TlbEntry *entries;
+    unsigned int num_sets;
+    unsigned int num_ways;
+    TlbReplacement replacement_policy;
+    uint64_t clock_stamp;           // Advances on every lookup and insertion.
+    uint64_t random_state;
+    TlbStats stats;
+    bool has_huge_entries;          // Lookups only probe for huge pages once one was cached.
+    ShootdownQueue shootdowns;
+} Tlb;
+
+// CPU 0 is the shell's; the others exist during a concurrent replay. Every thread uses CPU
+// 0's TLB until it selects another.
+static Tlb cpus[MAX_CPUS];
+static unsigned int online_cpus = 1;
+static __thread Tlb *tlb = &cpus[0];
+
+static const char *replacement_names[] = { "lru", "fifo", "random" };
+
+// Gives a TLB an empty entry array of the given geometry. The number of sets must be a power
+// of two.
+static void resetTLB(Tlb *target, unsigned int sets, unsigned int ways, TlbReplacement replacement) {
+    TlbEntry *new_entries = (TlbEntry *)calloc(sets * ways, sizeof(TlbEntry));
+    if (!new_entries) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    free(target->entries);
+    target->entries = new_entries;
+    target->num_sets = sets;
+    target->num_ways = ways;
+    target->replacement_policy = replacement;
+    if (target->random_state == 0) {
+        target->random_state = 0x9e3779b97f4a7c15ULL;
+    }
+    target->has_huge_entries = false;
+    memset(&target->stats, 0, sizeof(target->stats));
+}
+
+// Sets up an empty TLB with the given geometry. The number of sets (entries / ways) must be
+// a power of two. Returns false if the geometry is not valid.
+bool configureTLB(unsigned int num_entries, unsigned int ways, TlbReplacement replacement) {
+    if (ways == 0 || num_entries == 0 || num_entries % ways != 0) {
+        return false;
+    }
+    unsigned int sets = num_entries / ways;
+    if ((sets & (sets - 1)) != 0) {
+        return false;
+    }
+    resetTLB(tlb, sets, ways, replacement);
+    return true;
+}
+
+// Returns the first entry of the set a page maps to, configuring the default TLB if needed.
+static inline TlbEntry* setFor(uint64_t page) {
+    if (!tlb->entries) {
+        configureTLB(DEFAULT_TLB_ENTRIES, DEFAULT_TLB_WAYS, TLB_LRU);
+    }
+    return &tlb->entries[(page & (tlb->num_sets - 1)) * tlb->num_ways];
+}
+
+// Returns the entry caching (asid, page) at the given order, or NULL.
+static inline TlbEntry* findEntry(unsigned int asid, uint64_t page, unsigned int order) {
+    uint64_t key = page >> order;
+    TlbEntry *set = setFor(key);
+    for (unsigned int way = 0; way < tlb->num_ways; way++) {
+        if (set[way].valid && set[way].page == key && set[way].asid == asid && set[way].order == order) {
+            return &set[way];
+        }
+    }
+    return NULL;
+}
+
+// Returns the entry translating (asid, page), or NULL on a miss. Like a CPU with separate
+// TLBs per page size, a base page entry is looked for first, then huge ones.
+TlbEntry* tlbLookup(unsigned int asid, uint64_t page) {
+    TlbEntry *entry = findEntry(asid, page, 0);
+    for (unsigned int level = 1; !entry && tlb->has_huge_entries && level <= HUGE_PAGE_LEVELS; level++) {
+        entry = findEntry(asid, page, level * RADIX_BITS);
+    }
+    if (!entry) {
+        tlb->stats.misses++;
+        return NULL;
+    }
+    tlb->stats.hits++;
+    if (tlb->replacement_policy == TLB_LRU) {
+        entry->stamp = ++tlb->clock_stamp;
+    }
+    return entry;
+}
+
+// Caches a translation after a page-table walk, replacing an invalid entry if the set has
+// one and otherwise the entry chosen by the replacement policy.
+void tlbInsert(unsigned int asid, uint64_t page, unsigned int frame, bool dirty, unsigned int order) {
+    page >>= order;
+    TlbEntry *set = setFor(page);
+    TlbEntry *victim = &set[0];
+    for (unsigned int way = 0; way < tlb->num_ways; way++) {
+        if (!set[way].valid) {
+            victim = &set[way];
+            break;
+        }
+        if (set[way].stamp < victim->stamp) {
+            victim = &set[way];
+        }
+    }
+    if (victim->valid && tlb->replacement_policy == TLB_RANDOM) {
+        uint64_t random_state = tlb->random_state;
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        tlb->random_state = random_state;
+        victim = &set[random_state % tlb->num_ways];
+    }
+
+    victim->page = page;
+    victim->asid = asid;
+    victim->frame = frame;
+    victim->order = (unsigned char)order;
+    victim->dirty = dirty;
+    victim->valid = true;
+    victim->stamp = ++tlb->clock_stamp;
+    if (order > 0) {
+        tlb->has_huge_entries = true;
+    }
+}
+
+// Drops the translation of one page, or of the huge page of the given order containing it.
+void tlbInvalidatePage(unsigned int asid, uint64_t page, unsigned int order) {
+    TlbEntry *entry = findEntry(asid, page, order);
+    if (entry) {
+        entry->valid = false;
+        tlb->stats.invalidations++;
+    }
+}
+
+// Drops every translation of one address space.
+void tlbFlushAsid(unsigned int asid) {
+    setFor(0);
+    for (unsigned int i = 0; i < tlb->num_sets * tlb->num_ways; i++) {
+        if (tlb->entries[i].asid == asid) {
+            tlb->entries[i].valid = false;
+        }
+    }
+    tlb->stats.asid_flushes++;
+}
+
+// Drops every translation.
+void tlbFlush() {
+    setFor(0);
+    for (unsigned int i = 0; i < tlb->num_sets * tlb->num_ways; i++) {
+        tlb->entries[i].valid = false;
+    }
+    tlb->has_huge_entries = false;
+    tlb->stats.flushes++;
+}
+
+// Brings CPUs 1 to count - 1 online with empty TLBs of CPU 0's geometry, and clears every
+// shootdown queue.
+void tlbStartCPUs(unsigned int count) {
+    setFor(0);
+    for (unsigned int cpu = 0; cpu < count; cpu++) {
+        if (cpu > 0) {
+            resetTLB(&cpus[cpu], cpus[0].num_sets, cpus[0].num_ways, cpus[0].replacement_policy);
+        }
+        cpus[cpu].shootdowns.posted = 0;
+        cpus[cpu].shootdowns.handled = 0;
+        cpus[cpu].shootdowns.overflowed = false;
+    }
+    online_cpus = count;
+}
+
+// Takes every CPU but CPU 0 offline. Their TLBs keep their counters until the next start.
+void tlbStopCPUs() {
+    online_cpus = 1;
+}
+
+// Makes the calling thread use a CPU's TLB.
+void tlbSelectCPU(unsigned int cpu) {
+    tlb = &cpus[cpu];
+}
+
+// Posts the invalidation of one page to every online CPU in cpu_mask other than the calling
+// thread's. Callers must not post concurrently.
+void tlbShootdown(uint64_t cpu_mask, unsigned int asid, uint64_t page, unsigned int order) {
+    for (unsigned int cpu = 0; cpu < online_cpus; cpu++) {
+        if (!(cpu_mask & (1ULL << cpu)) || &cpus[cpu] == tlb) {
+            continue;
+        }
+        ShootdownQueue *queue = &cpus[cpu].shootdowns;
+        uint64_t posted = queue->posted;
+        if (posted - __atomic_load_n(&queue->handled, __ATOMIC_ACQUIRE) == SHOOTDOWN_QUEUE_SIZE) {
+            __atomic_store_n(&queue->overflowed, true, __ATOMIC_RELEASE);
+        } else {
+            queue->requests[posted % SHOOTDOWN_QUEUE_SIZE] = (Shootdown){ page, asid, order };
+            __atomic_store_n(&queue->posted, posted + 1, __ATOMIC_RELEASE);
+        }
+        tlb->stats.shootdowns_sent++;
+    }
+}
+
+// Applies the invalidations other CPUs posted to the calling thread's TLB. Called before
+// each access, so a translation changed by another CPU is used at most by the access in
+// flight when it changed.
+void tlbProcessShootdowns() {
+    ShootdownQueue *queue = &tlb->shootdowns;
+    uint64_t posted = __atomic_load_n(&queue->posted, __ATOMIC_ACQUIRE);
+    if (posted == queue->handled && !__atomic_load_n(&queue->overflowed, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (__atomic_exchange_n(&queue->overflowed, false, __ATOMIC_ACQUIRE)) {
+        // Requests were dropped; only a full flush is sure to cover them.
+        tlbFlush();
+        tlb->stats.shootdown_flushes++;
+        posted = __atomic_load_n(&queue->posted, __ATOMIC_ACQUIRE);
+    } else {
+        for (uint64_t i = queue->handled; i < posted; i++) {
+            const Shootdown *request = &queue->requests[i % SHOOTDOWN_QUEUE_SIZE];
+            tlbInvalidatePage(request->asid, request->page, request->order);
+        }
+    }
+    tlb->stats.shootdowns_received += posted - queue->handled;
+    __atomic_store_n(&queue->handled, posted, __ATOMIC_RELEASE);
+}
+
+// Returns the counters of a CPU's TLB.
+const TlbStats* tlbStats(unsigned int cpu) {
+    return &cpus[cpu].stats;
+}
+
+// Prints the TLB geometry and counters of CPU 0.
+static void printTLBStats() {
+    setFor(0);
+    const TlbStats *stats = &tlb->stats;
+    uint64_t lookups = stats->hits + stats->misses;
+    unsigned int num_entries = tlb->num_sets * tlb->num_ways;
+    printf("TLB: %u entries, %u-way, %u sets, %s replacement, reach %llu bytes\n", num_entries, tlb->num_ways, tlb->num_sets,
+           replacement_names[tlb->replacement_policy], (unsigned long long)num_entries * memoryGeometry()->page_size);
+    printf("Lookups: %llu, hits: %llu (%.2f%%), misses: %llu (%.2f%%)\n", (unsigned long long)lookups,
+           (unsigned long long)stats->hits, lookups ? 100.0 * (double)stats->hits / (double)lookups : 0.0,
+           (unsigned long long)stats->misses, lookups ? 100.0 * (double)stats->misses / (double)lookups : 0.0);
+    printf("Flushes: %llu, address space flushes: %llu, invalidated entries: %llu\n", (unsigned long long)stats->flushes,
+           (unsigned long long)stats->asid_flushes, (unsigned long long)stats->invalidations);
+}
+
+// tlb | tlb config <entries> <ways> [lru|fifo|random] | tlb flush [pid]
+void executeTLB(char** arguments) {
+    if (!arguments[1]) {
+        printTLBStats();
+    } else if (strcmp(arguments[1], "flush") == 0) {
+        if (arguments[2]) {
+            tlbFlushAsid((unsigned int)strtoul(arguments[2], NULL, 10));
+        } else {
+            tlbFlush();
+        }
+    } else if (strcmp(arguments[1], "config") == 0 && arguments[2] && arguments[3]) {
+        TlbReplacement replacement = TLB_LRU;
+        if (arguments[4]) {
+            for (replacement = TLB_LRU; replacement <= TLB_RANDOM; replacement++) {
+                if (strcmp(arguments[4], replacement_names[replacement]) == 0) {
+                    break;
+                }
+            }
+        }
+        if (replacement > TLB_RANDOM ||
+            !configureTLB((unsigned int)strtoul(arguments[2], NULL, 10), (unsigned int)strtoul(arguments[3], NULL, 10), replacement)) {
+            printf("Invalid TLB configuration: entries must be a multiple of ways, with a power-of-two number of sets.\n");
+        }
+    } else {
+        printf("Usage: tlb | tlb config <entries> <ways> [lru|fifo|random] | tlb flush [pid]\n");
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Replacement policies within a TLB set.
+typedef enum {
+    TLB_LRU,
+    TLB_FIFO,
+    TLB_RANDOM
+} TlbReplacement;
+
+// A cached translation, tagged with the address space (pid) it belongs to.
+typedef struct {
+    uint64_t page;                  // Virtual page number, shifted right by order.
+    uint64_t stamp;                 // Last use (LRU) or insertion (FIFO) time.
+    unsigned int asid;              // Address space ID: the pid of the owning process.
+    unsigned int frame;             // Physical frame holding the page, or the first frame of a huge page.
+    unsigned char order;            // log2 of the pages mapped: 0, or more for a huge page.
+    bool valid;
+    bool dirty;                     // The page table entry is already marked dirty.
+} TlbEntry;
+
+// TLB counters.
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t flushes;               // Whole-TLB flushes.
+    uint64_t asid_flushes;          // Flushes of one address space.
+    uint64_t invalidations;         // Single entries invalidated.
+    uint64_t shootdowns_sent;       // Invalidations posted to other CPUs.
+    uint64_t shootdowns_received;   // Invalidations posted by other CPUs and applied.
+    uint64_t shootdown_flushes;     // Full flushes because too many invalidations were pending.
+} TlbStats;
+
+// Sets up an empty TLB with the given geometry. Returns false if it is not valid.
+bool configureTLB(unsigned int num_entries, unsigned int ways, TlbReplacement replacement);
+
+// Returns the entry translating (asid, page), or NULL on a miss. The entry may be for a huge
+// page containing the page.
+TlbEntry* tlbLookup(unsigned int asid, uint64_t page);
+
+// Caches a translation after a page-table walk. For a huge page (order > 0), frame is the
+// first frame of the run.
+void tlbInsert(unsigned int asid, uint64_t page, unsigned int frame, bool dirty, unsigned int order);
+
+// Drops the translation of one page, or of the huge page of the given order containing it.
+void tlbInvalidatePage(unsigned int asid, uint64_t page, unsigned int order);
+
+// Drops every translation of one address space, or of all of them.
+void tlbFlushAsid(unsigned int asid);
+void tlbFlush();
+
+// Brings CPUs 0 to count - 1 online for a concurrent replay, each with an empty TLB of CPU
+// 0's geometry, or takes all but CPU 0 offline again.
+void tlbStartCPUs(unsigned int count);
+void tlbStopCPUs();
+
+// Makes the calling thread use a CPU's TLB. Threads start on CPU 0.
+void tlbSelectCPU(unsigned int cpu);
+
+// Posts the invalidation of a page to every other online CPU in cpu_mask. The target CPUs
+// apply it in tlbProcessShootdowns. Callers must not post concurrently.
+void tlbShootdown(uint64_t cpu_mask, unsigned int asid, uint64_t page, unsigned int order);
+void tlbProcessShootdowns();
+
+// Returns the counters of a CPU's TLB.
+const TlbStats* tlbStats(unsigned int cpu);
+
+// tlb builtin.
+void executeTLB(char** arguments);
+
+#endif // TLB_H
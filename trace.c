@@ -0,0 +1,290 @@
+#include "trace.h"
+#include "pipe_io.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Number of events kept in memory. With a trace file open the ring is written out each time
+// it fills, so events reach the file in large batches; otherwise the oldest are overwritten.
+#define TRACE_RING_CAPACITY (1 << 16)
+#define TRACE_TEXT_BUFFER_SIZE (256 * 1024)
+#define TRACE_MAX_TEXT_LINE 256
+
+// How each event type is named in text trace files and printed at the event level. In the
+// message, %p stands for the pid and %0, %1 and %2 for the event's arguments.
+typedef struct {
+    const char *name;
+    const char *message;
+    bool isError;                   // Printed at the summary level too.
+} TraceEventFormat;
+
+static const TraceEventFormat event_formats[TRACE_NUM_EVENT_TYPES] = {
+    [TRACE_PROCESS_CREATED]      = { "process_created", "Process %p created with %0 bytes of memory, requiring %1 pages.", false },
+    [TRACE_MEMORY_ALLOCATED]     = { "memory_allocated", "Process %p memory increased by %0 bytes, now requiring a total of %1 pages.", false },
+    [TRACE_ACCESS_OUT_OF_BOUNDS] = { "access_out_of_bounds", "Error: The virtual address %0 is out of bounds for process %p.", true },
+    [TRACE_PAGE_FAULT]           = { "page_fault", "Page fault for process %p at virtual address %0: Page %1 not in physical memory.", false },
+    [TRACE_PAGE_LOADED]          = { "page_loaded", "Page %0 loaded into frame %1 for process %p.", false },
+    [TRACE_ADDRESS_TRANSLATED]   = { "address_translated", "Virtual address %0 translated to physical address %1 for process %p.", false },
+    [TRACE_FREE_TOO_LARGE]       = { "free_too_large", "Error: Cannot free %0 bytes from process %p. Only %1 bytes are currently allocated.", true },
+    [TRACE_MEMORY_FREED]         = { "memory_freed", "Freed %0 bytes of memory from process %p. %1 pages remaining.", false },
+    [TRACE_PAGE_EVICTED]         = { "page_evicted", "Page %0 of process %p evicted from frame %1.", false },
+    [TRACE_PAGE_WRITTEN_BACK]    = { "page_written_back", "Dirty page %0 of process %p written back from frame %1.", false },
+    [TRACE_PROCESS_RUNNING]      = { "process_running", "Running process: %p", false },
+    [TRACE_PROCESS_TERMINATED]   = { "process_terminated", "Process %p terminated", false },
+    [TRACE_ALLOCATION_TOO_LARGE] = { "allocation_too_large", "Error: Cannot allocate %0 more bytes to process %p. %1 bytes are allocated and the address space is %2 bytes.", true },
+    [TRACE_PROCESS_FORKED]       = { "process_forked", "Process %p forked from process %0, sharing %1 frames copy-on-write.", false },
+    [TRACE_COPY_ON_WRITE]        = { "copy_on_write", "Write to shared page %0 of process %p: copied from frame %1 to frame %2.", false },
+    [TRACE_PAGE_SWAPPED_OUT]     = { "page_swapped_out", "Page %0 of process %p written from frame %1 to swap slot %2.", false },
+    [TRACE_PAGE_SWAPPED_IN]      = { "page_swapped_in", "Page %0 of process %p read from swap slot %1 into frame %2.", false },
+};
+
+// Header at the start of binary trace files, followed by TraceEvent records.
+typedef struct {
+    char magic[8];                  // "LSTRACE\0"
+    uint32_t version;
+    uint32_t record_size;           // sizeof(TraceEvent)
+} TraceFileHeader;
+
+static TraceLevel trace_level = TRACE_EVENT;
+static TraceEvent *ring;
+static uint64_t next_sequence = 0;          // Sequence number of the next event.
+static uint64_t flushed_sequence = 0;       // Events before this one are in the trace file.
+static uint64_t event_counts[TRACE_NUM_EVENT_TYPES];
+
+static int trace_fd = -1;
+static bool trace_binary = false;
+static char *text_buffer;                   // Staging area for text trace files.
+
+// Writes an unsigned number in decimal; returns the number of characters written.
+static size_t formatUnsigned(char *out, uint64_t value) {
+    char digits[20];
+    size_t length = 0;
+    do {
+        digits[length++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < length; i++) {
+        out[i] = digits[length - 1 - i];
+    }
+    return length;
+}
+
+// Renders an event's message into out, which must hold TRACE_MAX_TEXT_LINE characters.
+// Only the placeholders above are recognized, so there is no format string to parse.
+static size_t formatMessage(char *out, const TraceEvent *event) {
+    size_t length = 0;
+    for (const char *c = event_formats[event->type].message; *c != '\0'; c++) {
+        if (c[0] == '%' && c[1] == 'p') {
+            length += formatUnsigned(out + length, event->pid);
+            c++;
+        } else if (c[0] == '%' && c[1] >= '0' && c[1] <= '2') {
+            length += formatUnsigned(out + length, event->args[c[1] - '0']);
+            c++;
+        } else {
+            out[length++] = *c;
+        }
+    }
+    out[length++] = '\n';
+    return length;
+}
+
+// Renders an event as one compact line: sequence, name, pid and arguments.
+static size_t formatCompact(char *out, const TraceEvent *event) {
+    size_t length = formatUnsigned(out, event->sequence);
+    out[length++] = ' ';
+    const char *name = event_formats[event->type].name;
+    size_t name_length = strlen(name);
+    memcpy(out + length, name, name_length);
+    length += name_length;
+    out[length++] = ' ';
+    length += formatUnsigned(out + length, event->pid);
+    for (int i = 0; i < 3; i++) {
+        out[length++] = ' ';
+        length += formatUnsigned(out + length, event->args[i]);
+    }
+    out[length++] = '\n';
+    return length;
+}
+
+// Flushes the trace file and prints the summary on exit.
+static void finishTrace() {
+    closeTraceFile();
+    if (trace_level == TRACE_SUMMARY && next_sequence > 0) {
+        printf("Trace summary: %llu events\n", (unsigned long long)next_sequence);
+        for (int type = 0; type < TRACE_NUM_EVENT_TYPES; type++) {
+            if (event_counts[type] > 0) {
+                printf("  %s: %llu\n", event_formats[type].name, (unsigned long long)event_counts[type]);
+            }
+        }
+    }
+}
+
+// Initializes the trace ring buffer.
+void initializeTrace() {
+    ring = (TraceEvent *)malloc(sizeof(TraceEvent) * TRACE_RING_CAPACITY);
+    if (!ring) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    atexit(finishTrace);
+}
+
+// Records an event in the ring buffer, counts it and prints it if the level asks for it.
+// Printing uses a precompiled message per event type written straight into stdout's buffer.
+void traceEvent(TraceEventType type, uint32_t pid, uint64_t arg0, uint64_t arg1, uint64_t arg2) {
+    if (trace_fd >= 0 && next_sequence - flushed_sequence == TRACE_RING_CAPACITY) {
+        flushTrace();
+    }
+
+    TraceEvent *event = &ring[next_sequence % TRACE_RING_CAPACITY];
+    event->sequence = next_sequence++;
+    event->type = type;
+    event->pid = pid;
+    event->args[0] = arg0;
+    event->args[1] = arg1;
+    event->args[2] = arg2;
+    event_counts[type]++;
+
+    if (trace_level == TRACE_EVENT || (trace_level == TRACE_SUMMARY && event_formats[type].isError)) {
+        char line[TRACE_MAX_TEXT_LINE];
+        fwrite(line, 1, formatMessage(line, event), stdout);
+    }
+}
+
+// Changes how much is printed.
+void setTraceLevel(TraceLevel level) {
+    trace_level = level;
+}
+
+// Returns the current trace level.
+TraceLevel getTraceLevel() {
+    return trace_level;
+}
+
+// Starts copying events to a trace file, replacing any file already open. Events recorded
+// from now on are appended in binary records or compact text lines.
+bool openTraceFile(const char* path, bool binary) {
+    closeTraceFile();
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    if (binary) {
+        TraceFileHeader header = { "LSTRACE", 1, sizeof(TraceEvent) };
+        if (!writeAll(fd, &header, sizeof(header))) {
+            close(fd);
+            return false;
+        }
+    } else if (!text_buffer) {
+        text_buffer = (char *)malloc(TRACE_TEXT_BUFFER_SIZE);
+        if (!text_buffer) {
+            perror("memory allocation error");
+            exit(EXIT_FAILURE);
+        }
+    }
+    trace_fd = fd;
+    trace_binary = binary;
+    flushed_sequence = next_sequence;
+    return true;
+}
+
+// Flushes and closes the trace file.
+void closeTraceFile() {
+    if (trace_fd < 0) {
+        return;
+    }
+    flushTrace();
+    close(trace_fd);
+    trace_fd = -1;
+}
+
+// Writes the events recorded since the last flush to the trace file. Binary records are
+// written straight from the ring (in at most two pieces); text is staged in a large buffer.
+void flushTrace() {
+    if (trace_fd < 0 || flushed_sequence == next_sequence) {
+        return;
+    }
+
+    bool ok = true;
+    if (trace_binary) {
+        uint64_t start = flushed_sequence % TRACE_RING_CAPACITY;
+        uint64_t count = next_sequence - flushed_sequence;
+        uint64_t first = count < TRACE_RING_CAPACITY - start ? count : TRACE_RING_CAPACITY - start;
+        ok = writeAll(trace_fd, &ring[start], first * sizeof(TraceEvent));
+        if (ok && first < count) {
+            ok = writeAll(trace_fd, ring, (count - first) * sizeof(TraceEvent));
+        }
+    } else {
+        size_t used = 0;
+        for (uint64_t sequence = flushed_sequence; ok && sequence < next_sequence; sequence++) {
+            used += formatCompact(text_buffer + used, &ring[sequence % TRACE_RING_CAPACITY]);
+            if (used > TRACE_TEXT_BUFFER_SIZE - TRACE_MAX_TEXT_LINE) {
+                ok = writeAll(trace_fd, text_buffer, used);
+                used = 0;
+            }
+        }
+        if (ok && used > 0) {
+            ok = writeAll(trace_fd, text_buffer, used);
+        }
+    }
+
+    if (!ok) {
+        perror("trace file");
+    }
+    flushed_sequence = next_sequence;
+}
+
+// Prints the event counts and the state of the trace.
+static void printTraceStats() {
+    static const char *level_names[] = { "silent", "summary", "event" };
+    printf("Trace level: %s, %llu events recorded\n", level_names[trace_level], (unsigned long long)next_sequence);
+    for (int type = 0; type < TRACE_NUM_EVENT_TYPES; type++) {
+        printf("  %-22s %llu\n", event_formats[type].name, (unsigned long long)event_counts[type]);
+    }
+    if (trace_fd >= 0) {
+        printf("Trace file: %s records, %llu events waiting to be written\n", trace_binary ? "binary" : "text",
+               (unsigned long long)(next_sequence - flushed_sequence));
+    }
+}
+
+// Prints the most recent events from the ring buffer in compact form.
+static void printRecentEvents(uint64_t count) {
+    uint64_t available = next_sequence < TRACE_RING_CAPACITY ? next_sequence : TRACE_RING_CAPACITY;
+    if (count > available) {
+        count = available;
+    }
+    char line[TRACE_MAX_TEXT_LINE];
+    for (uint64_t sequence = next_sequence - count; sequence < next_sequence; sequence++) {
+        fwrite(line, 1, formatCompact(line, &ring[sequence % TRACE_RING_CAPACITY]), stdout);
+    }
+}
+
+// trace [silent|summary|event] | trace file <path> [text|binary] | trace file off
+// trace stats | trace tail [count] | trace flush
+void executeTrace(char** arguments) {
+    const char *option = arguments[1];
+    if (!option || strcmp(option, "stats") == 0) {
+        printTraceStats();
+    } else if (strcmp(option, "silent") == 0) {
+        setTraceLevel(TRACE_SILENT);
+    } else if (strcmp(option, "summary") == 0) {
+        setTraceLevel(TRACE_SUMMARY);
+    } else if (strcmp(option, "event") == 0) {
+        setTraceLevel(TRACE_EVENT);
+    } else if (strcmp(option, "flush") == 0) {
+        flushTrace();
+    } else if (strcmp(option, "tail") == 0) {
+        printRecentEvents(arguments[2] ? strtoull(arguments[2], NULL, 10) : 20);
+    } else if (strcmp(option, "file") == 0 && arguments[2] && strcmp(arguments[2], "off") == 0) {
+        closeTraceFile();
+    } else if (strcmp(option, "file") == 0 && arguments[2] &&
+               (!arguments[3] || strcmp(arguments[3], "text") == 0 || strcmp(arguments[3], "binary") == 0)) {
+        if (!openTraceFile(arguments[2], arguments[3] && strcmp(arguments[3], "binary") == 0)) {
+            perror("trace");
+        }
+    } else {
+        printf("Usage: trace [silent|summary|event] | trace file <path> [text|binary] | trace file off | trace stats | trace tail [count] | trace flush\n");
+    }
+}
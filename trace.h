@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How much the VMM and scheduler report as they run.
+typedef enum {
+    TRACE_SILENT,       // Nothing is printed; events are only counted.
+    TRACE_SUMMARY,      // Errors are printed, and event counts when the shell exits.
+    TRACE_EVENT         // Every event is printed as it happens.
+} TraceLevel;
+
+// Kinds of traced events. The meaning of each event's arguments is given alongside.
+typedef enum {
+    TRACE_PROCESS_CREATED,          // bytes, pages
+    TRACE_MEMORY_ALLOCATED,         // bytes added, total pages
+    TRACE_ACCESS_OUT_OF_BOUNDS,     // virtual address
+    TRACE_PAGE_FAULT,               // virtual address, page
+    TRACE_PAGE_LOADED,              // page, frame
+    TRACE_ADDRESS_TRANSLATED,       // virtual address, physical address
+    TRACE_FREE_TOO_LARGE,           // bytes requested, bytes allocated
+    TRACE_MEMORY_FREED,             // bytes freed, pages remaining
+    TRACE_PAGE_EVICTED,             // page, frame
+    TRACE_PAGE_WRITTEN_BACK,        // page, frame
+    TRACE_PROCESS_RUNNING,          // (none)
+    TRACE_PROCESS_TERMINATED,       // (none)
+    TRACE_ALLOCATION_TOO_LARGE,     // bytes requested, bytes allocated, address space size
+    TRACE_PROCESS_FORKED,           // parent pid, frames shared
+    TRACE_COPY_ON_WRITE,            // page, old frame, new frame
+    TRACE_PAGE_SWAPPED_OUT,         // page, frame, swap slot
+    TRACE_PAGE_SWAPPED_IN,          // page, swap slot, frame
+    TRACE_NUM_EVENT_TYPES
+} TraceEventType;
+
+// Fixed-size record of one event, as kept in the ring buffer and written to binary trace files.
+typedef struct {
+    uint64_t sequence;              // Position of the event in the whole run.
+    uint32_t type;                  // TraceEventType.
+    uint32_t pid;                   // Simulated process the event belongs to.
+    uint64_t args[3];               // Event-specific values.
+} TraceEvent;
+
+// Initializes the trace ring buffer.
+void initializeTrace();
+
+// Records an event, printing it if the trace level asks for it.
+void traceEvent(TraceEventType type, uint32_t pid, uint64_t arg0, uint64_t arg1, uint64_t arg2);
+
+// Changes or returns how much is printed.
+void setTraceLevel(TraceLevel level);
+TraceLevel getTraceLevel();
+
+// Starts or stops copying every event to a trace file.
+bool openTraceFile(const char* path, bool binary);
+void closeTraceFile();
+
+// Writes buffered events to the trace file.
+void flushTrace();
+
+// trace builtin.
+void executeTrace(char** arguments);
+
+#endif // TRACE_H
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
 
 // Function to copy a string
 char* copyString(char* targetString) {
@@ -22,6 +23,32 @@ char* copyString(char* targetString) {
     return targetString_copy;
 }
 
+// Parses a byte count with an optional K, M, G or T suffix (powers of 1024).
+// Returns false if the text is not a valid size.
+bool parseSize(const char* text, uint64_t* size) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text || text[0] == '-') {
+        return false;
+    }
+
+    unsigned shift = 0;
+    switch (*end) {
+        case 'k': case 'K': shift = 10; end++; break;
+        case 'm': case 'M': shift = 20; end++; break;
+        case 'g': case 'G': shift = 30; end++; break;
+        case 't': case 'T': shift = 40; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || (shift > 0 && value > (UINT64_MAX >> shift))) {
+        return false;
+    }
+
+    *size = (uint64_t)value << shift;
+    return true;
+}
+
 /*
 // Main function for testing the copyString function
 int main() {
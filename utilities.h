@@ -1,3 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 char* copyString(char* targetString);
+bool parseSize(const char* text, uint64_t* size);
@@ -1,124 +1,603 @@
 #include "vmm.h"
+#include "trace.h"
+#include "frame_manager.h"
+#include "tlb.h"
+#include "swap.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-// Frame table to keep track of frame usage.
-static FrameTable frame_table;
+// Geometry of the simulated machine and the page table layout given to new processes.
+static MemoryGeometry geometry;
+static ReplacementPolicyType replacement_policy = POLICY_CLOCK;
+static PageTableLayout page_table_layout = PAGE_TABLE_FLAT;
 
-// Initializes the Virtual Memory Manager.
-void initializeVMM() {
-    // Calculate the number of frames based on physical memory size and page size.
-    frame_table.num_frames = PHYS_MEM_SIZE / PAGE_SIZE;
-    // Allocate and initialize frame usage count to zero for each frame.
-    frame_table.frame_usage_count = (int *)calloc(frame_table.num_frames, sizeof(int));
-    if (!frame_table.frame_usage_count) {
-        // If allocation fails, display an error message and exit.
-        perror("Failed to initialize frame usage count");
-        exit(EXIT_FAILURE);
+// Concurrent replays. Hits, and faults that find a free frame in the CPU's cache, only take
+// the process's table lock; everything else runs the single-threaded code under vmm_lock,
+// taking the table lock for writing as well. Hits and faults made without vmm_lock are
+// queued per CPU and applied to the counters and the replacement policy under it, in order.
+#define PENDING_ACCESS_LIMIT 256
+
+// A hit or fault waiting to be applied.
+typedef struct {
+    PCB *pcb;
+    uint64_t page;                  // The page, or the first page of a huge page that was hit.
+    uint64_t virtual_address;
+    unsigned int frame;
+    bool loaded;                    // A fault that loaded the page, rather than a hit.
+} PendingAccess;
+
+static pthread_mutex_t vmm_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool concurrent = false;
+static __thread unsigned int current_cpu;
+static __thread PCB *locked_pcb;    // Process whose table this thread holds for writing.
+static __thread PendingAccess pending_accesses[PENDING_ACCESS_LIMIT];
+static __thread unsigned int num_pending;
+
+// Checks a geometry and fills in the derived fields. Returns NULL if it is valid, or a
+// description of the problem.
+const char* validateMemoryGeometry(MemoryGeometry *candidate) {
+    uint64_t page_size = candidate->page_size;
+    if (page_size < MIN_PAGE_SIZE || page_size > MAX_PAGE_SIZE || (page_size & (page_size - 1)) != 0) {
+        return "the page size must be a power of two from 1K to 1G";
+    }
+    candidate->page_shift = (unsigned int)__builtin_ctzll(page_size);
+    if (candidate->physical_memory < page_size || candidate->physical_memory % page_size != 0) {
+        return "physical memory must be a whole number of pages";
+    }
+    if (candidate->physical_memory / page_size > MAX_FRAMES) {
+        return "physical memory has too many frames for the page size";
+    }
+    candidate->num_frames = (unsigned int)(candidate->physical_memory / page_size);
+    if (!canReserveFrameTables(candidate->num_frames)) {
+        return "the frame tables for physical memory this large do not fit in the address space";
+    }
+    if (candidate->address_bits < MIN_ADDRESS_BITS || candidate->address_bits > MAX_ADDRESS_BITS) {
+        return "virtual addresses must be from 32 to 57 bits wide";
     }
+    candidate->max_virtual_memory = 1ULL << candidate->address_bits;
+    return NULL;
+}
+
+// Initializes the Virtual Memory Manager.
+void initializeVMM(const MemoryGeometry *machine, ReplacementPolicyType policy, PageTableLayout layout) {
+    geometry = *machine;
+    replacement_policy = policy;
+    page_table_layout = layout;
+    configurePageTables(geometry.address_bits - geometry.page_shift);
+    // Physical memory is divided into page-sized frames handed out by the frame manager.
+    initializeFrameManager(geometry.num_frames, policy);
+}
+
+// Returns the geometry in use.
+const MemoryGeometry* memoryGeometry() {
+    return &geometry;
+}
+
+// Returns the replacement policy in use.
+ReplacementPolicyType replacementPolicyType() {
+    return replacement_policy;
+}
+
+// Returns the page table layout given to new processes.
+PageTableLayout pageTableLayout() {
+    return page_table_layout;
 }
 
 // Creates a process with the specified PID and memory size.
 void createProcess(PCB *pcb, unsigned int pid, size_t memory_size) {
     pcb->pid = pid;
+    pthread_rwlock_init(&pcb->table_lock, NULL);
+    initializePageTable(&pcb->page_table, page_table_layout);
     // Allocate memory for the process.
     allocateMemory(pcb, memory_size);
-    // Print process creation information.
-    printf("Process %u created with %zu bytes of memory, requiring %u pages.\n", pcb->pid, memory_size, pcb->page_table.num_pages);
+    // Report process creation.
+    traceEvent(TRACE_PROCESS_CREATED, pcb->pid, memory_size, pcb->page_table.num_pages, 0);
 }
 
-// Allocates additional memory to a process.
+// Allocates additional memory to a process. Only the size of the address space changes;
+// page table entries are created when pages are first accessed.
 void allocateMemory(PCB *pcb, size_t additional_memory_size) {
+    // Reject requests that would not fit in the virtual address space.
+    if (additional_memory_size > geometry.max_virtual_memory - pcb->memory_requirement) {
+        traceEvent(TRACE_ALLOCATION_TOO_LARGE, pcb->pid, additional_memory_size, pcb->memory_requirement, geometry.max_virtual_memory);
+        return;
+    }
+
     // Calculate new memory requirement.
     size_t new_memory_requirement = pcb->memory_requirement + additional_memory_size;
     // Calculate the number of pages needed.
-    unsigned int new_num_pages = (new_memory_requirement + PAGE_SIZE - 1) / PAGE_SIZE;
-
-    // Check if additional pages are needed.
-    if(new_num_pages > pcb->page_table.num_pages) {
-        // Reallocate the page table to accommodate the new pages.
-        PageTableEntry *new_entries = (PageTableEntry *)realloc(pcb->page_table.entries, new_num_pages * sizeof(PageTableEntry));
-        if (!new_entries) {
-            perror("Failed to allocate additional page table entries");
-            exit(EXIT_FAILURE);
+    uint64_t new_num_pages = (new_memory_requirement + geometry.page_size - 1) >> geometry.page_shift;
+    truncatePageTable(&pcb->page_table, new_num_pages, NULL, NULL);
+
+    pcb->memory_requirement = new_memory_requirement;
+    traceEvent(TRACE_MEMORY_ALLOCATED, pcb->pid, additional_memory_size, pcb->page_table.num_pages, 0);
+}
+
+// Drops the cached translations of a page of pcb (or of the huge page of the given order
+// containing it). In a concurrent replay, the other CPUs that have run pcb are sent a
+// shootdown.
+static void invalidateTranslation(PCB *pcb, uint64_t page, unsigned int order) {
+    tlbInvalidatePage(pcb->pid, page, order);
+    if (concurrent) {
+        tlbShootdown(__atomic_load_n(&pcb->cpu_mask, __ATOMIC_SEQ_CST), pcb->pid, page, order);
+    }
+}
+
+// Reads a page just given a frame back from swap, if its old entry points there.
+static void swapIn(PCB *pcb, uint64_t page, PageTableEntry old_entry, unsigned int frame, unsigned int order) {
+    if (old_entry & PTE_SWAPPED) {
+        readSwappedPage(pcb, frame, page, pteFrame(old_entry), order);
+    }
+}
+
+// Loads a faulting page, reading it from swap if it was swapped out. With huge pages on,
+// the largest huge page around it that lies inside the address space is tried first. It
+// is used only if a free, aligned run of frames exists, since huge pages never cause
+// evictions; otherwise the page is loaded on its own. A huge page in swap that cannot be
+// loaded whole is split, and only the faulting page is read. Returns the entry now mapping
+// the page and sets *order to the size it maps.
+static PageTableEntry* loadFaultingPage(PCB *pcb, uint64_t page_number, unsigned int *order) {
+    if (geometry.huge_pages) {
+        for (unsigned int level = HUGE_PAGE_LEVELS; level >= 1; level--) {
+            unsigned int huge_order = level * RADIX_BITS;
+            uint64_t base = page_number & ~((1ULL << huge_order) - 1);
+            if (base + (1ULL << huge_order) > pcb->page_table.num_pages || !canMapHugePage(&pcb->page_table, base, huge_order)) {
+                continue;
+            }
+            int64_t frame = loadHugePage(pcb, base, huge_order);
+            if (frame >= 0) {
+                PageTableEntry *entry = createHugePageTableEntry(&pcb->page_table, base, huge_order);
+                swapIn(pcb, base, *entry, (unsigned int)frame, huge_order);
+                *entry = pteWithFrame(PTE_HUGE | PTE_VALID, (uint64_t)frame);
+                *order = huge_order;
+                return entry;
+            }
         }
+    }
 
-        // Initialize the new page table entries.
-        for(unsigned int i = pcb->page_table.num_pages; i < new_num_pages; ++i) {
-            new_entries[i].valid = 0;
-            new_entries[i].dirty = 0;
-            new_entries[i].accessed = 0;
+    PageTableEntry *entry = createPageTableEntry(&pcb->page_table, page_number);
+    // Load the page into a frame, evicting another page if physical memory is full.
+    unsigned int frame = loadPage(pcb, page_number);
+    swapIn(pcb, page_number, *entry, frame, 0);
+    *entry = pteWithFrame((*entry & PTE_ACCESSED) | PTE_VALID, frame);
+    *order = 0;
+    return entry;
+}
+
+// Handles a write to a page shared copy-on-write. If other processes still map the frame,
+// this process gives up its share and faults in a private copy, which counts as a fault. A
+// huge page is copied whole if a free run allows; otherwise only the written page is, and
+// the rest of the huge page faults back in one page at a time.
+// The last process left mapping the frame just takes it over. Returns the entry now
+// mapping the page.
+static PageTableEntry* copyOnWrite(PCB *pcb, uint64_t page_number, PageTableEntry *entry, unsigned int *order) {
+    unsigned int shared_frame = (unsigned int)pteFrame(*entry);
+    if (!isFrameShared(shared_frame)) {
+        *entry &= ~PTE_COW;
+        touchFrame(pcb, shared_frame);
+        return entry;
+    }
+
+    uint64_t base = page_number & ~((1ULL << *order) - 1);
+    invalidateTranslation(pcb, base, *order);
+    releaseFrame(pcb, shared_frame);
+    *entry &= PTE_HUGE;
+    entry = loadFaultingPage(pcb, page_number, order);
+    recordCopyOnWrite(pcb, 1ULL << *order);
+    traceEvent(TRACE_COPY_ON_WRITE, pcb->pid, page_number, shared_frame, pteFrame(*entry));
+    return entry;
+}
+
+// Returns the time elapsed since start, in nanoseconds.
+static uint64_t nanosecondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)((now.tv_sec - start->tv_sec) * 1000000000LL + (now.tv_nsec - start->tv_nsec));
+}
+
+// Translates a page that was not found in the TLB, or that was found but is being written
+// while its entry is not yet dirty (cached is then that entry). Handles a page fault if the
+// page is not resident. While swap is on, faults are timed: major faults read the page from
+// swap, minor ones do not. Returns the frame holding the page.
+static int64_t translateMiss(PCB *pcb, uint64_t page_number, uint64_t virtual_address, bool write, TlbEntry *cached) {
+    unsigned int order;
+    PageTableEntry *entry = walkPageTable(&pcb->page_table, page_number, &order);
+    // Handle page fault if the page is not valid.
+    if (!entry || !(*entry & PTE_VALID)) {
+        traceEvent(TRACE_PAGE_FAULT, pcb->pid, virtual_address, page_number, 0);
+        bool timed = swapEnabled();
+        bool major = entry && (*entry & PTE_SWAPPED);
+        struct timespec start;
+        if (timed) {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+        entry = loadFaultingPage(pcb, page_number, &order);
+        if (timed) {
+            recordFaultLatency(major, nanosecondsSince(&start));
         }
+        traceEvent(TRACE_PAGE_LOADED, pcb->pid, page_number, pteFrame(*entry) + (page_number & ((1ULL << order) - 1)), 0);
+    } else if (write && (*entry & PTE_COW)) {
+        // A private copy drops the cached entry; a frame no longer shared is taken over and
+        // keeps it, so it must be updated rather than cached a second time.
+        if (isFrameShared((unsigned int)pteFrame(*entry))) {
+            cached = NULL;
+        }
+        entry = copyOnWrite(pcb, page_number, entry, &order);
+    } else {
+        touchFrame(pcb, (unsigned int)pteFrame(*entry));
+    }
 
-        pcb->page_table.entries = new_entries;
-        pcb->page_table.num_pages = new_num_pages;
+    *entry |= PTE_ACCESSED;
+    if (write) {
+        *entry |= PTE_DIRTY;
     }
+    // Writes may bypass the page table only once the entry is dirty and not shared.
+    uint64_t first_frame = pteFrame(*entry);
+    bool writable = (*entry & (PTE_DIRTY | PTE_COW)) == PTE_DIRTY;
+    if (cached) {
+        cached->dirty = writable;
+    } else {
+        tlbInsert(pcb->pid, page_number, (unsigned int)first_frame, writable, order);
+    }
+    return (int64_t)(first_frame + (page_number & ((1ULL << order) - 1)));
+}
 
-    pcb->memory_requirement = new_memory_requirement;
-    printf("Process %u memory increased by %zu bytes, now requiring a total of %u pages.\n", pcb->pid, additional_memory_size, pcb->page_table.num_pages);
+// Translates a page of a process for a read or write, handling a page fault if it is not
+// resident. Returns the frame holding the page, or -1 if the page is out of bounds.
+static inline int64_t translatePage(PCB *pcb, uint64_t page_number, uint64_t virtual_address, bool write) {
+    // Check if the page number is valid.
+    if (page_number >= pcb->page_table.num_pages) {
+        traceEvent(TRACE_ACCESS_OUT_OF_BOUNDS, pcb->pid, virtual_address, 0, 0);
+        return -1;
+    }
+
+    // Try the TLB first: a hit needs no page table walk unless a write must set the dirty bit.
+    // Huge pages are cached as one entry; the frame of a page within one is an offset from
+    // the first frame of the run.
+    TlbEntry *cached = tlbLookup(pcb->pid, page_number);
+    if (cached && (!write || cached->dirty)) {
+        touchFrame(pcb, cached->frame);
+        return cached->frame + (page_number & ((1ULL << cached->order) - 1));
+    }
+    return translateMiss(pcb, page_number, virtual_address, write, cached);
 }
 
-// Accesses a virtual address within a process's memory.
-void accessMemory(PCB *pcb, unsigned int virtual_address) {
+// Reads or writes a virtual address within a process's memory.
+void accessMemory(PCB *pcb, uint64_t virtual_address, bool write) {
     // Calculate the page number and offset from the virtual address.
-    unsigned int page_number = virtual_address / PAGE_SIZE;
-    unsigned int offset = virtual_address % PAGE_SIZE;
+    uint64_t page_number = virtual_address >> geometry.page_shift;
+    uint64_t offset = virtual_address & (geometry.page_size - 1);
 
-    // Check if the page number is valid.
+    int64_t frame_number = translatePage(pcb, page_number, virtual_address, write);
+    if (frame_number >= 0) {
+        // Calculate the physical address from the page number and offset.
+        uint64_t physical_address = ((uint64_t)frame_number << geometry.page_shift) | offset;
+        traceEvent(TRACE_ADDRESS_TRANSLATED, pcb->pid, virtual_address, physical_address, 0);
+    }
+}
+
+// Performs a batch of accesses, in order. The page/offset split and the physical address
+// calculation are done for the whole batch in straight-line loops the compiler vectorizes,
+// leaving only the page table and frame work per access.
+void accessMemoryBatch(PCB **pcbs, const uint64_t *virtual_addresses, const bool *writes, size_t count) {
+    uint64_t pages[ACCESS_BATCH_SIZE];
+    int64_t frames[ACCESS_BATCH_SIZE];
+    uint64_t physical_addresses[ACCESS_BATCH_SIZE];
+    unsigned int page_shift = geometry.page_shift;
+    uint64_t offset_mask = geometry.page_size - 1;
+
+    for (size_t start = 0; start < count; start += ACCESS_BATCH_SIZE) {
+        size_t n = count - start < ACCESS_BATCH_SIZE ? count - start : ACCESS_BATCH_SIZE;
+        const uint64_t *addresses = virtual_addresses + start;
+
+        for (size_t i = 0; i < n; i++) {
+            pages[i] = addresses[i] >> page_shift;
+        }
+        for (size_t i = 0; i < n; i++) {
+            frames[i] = translatePage(pcbs[start + i], pages[i], addresses[i], writes[start + i]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            physical_addresses[i] = ((uint64_t)frames[i] << page_shift) | (addresses[i] & offset_mask);
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (frames[i] >= 0) {
+                traceEvent(TRACE_ADDRESS_TRANSLATED, pcbs[start + i]->pid, addresses[i], physical_addresses[i], 0);
+            }
+        }
+    }
+}
+
+// Applies the calling CPU's pending hits and faults to the counters and the replacement
+// policy, in the order they happened. Called with vmm_lock held.
+static void applyPendingAccesses() {
+    for (unsigned int i = 0; i < num_pending; i++) {
+        const PendingAccess *access = &pending_accesses[i];
+        if (access->loaded) {
+            traceEvent(TRACE_PAGE_FAULT, access->pcb->pid, access->virtual_address, access->page, 0);
+            recordPageLoad(access->pcb, access->page, access->frame);
+            traceEvent(TRACE_PAGE_LOADED, access->pcb->pid, access->page, access->frame, 0);
+        } else {
+            touchMappedFrame(access->pcb, access->frame, access->page);
+        }
+    }
+    num_pending = 0;
+}
+
+// Takes vmm_lock. The CPU's pending accesses are applied first, so the replacement policy
+// sees them before anything this CPU does under the lock.
+static void lockVMM() {
+    pthread_mutex_lock(&vmm_lock);
+    applyPendingAccesses();
+}
+
+// Queues a hit or fault made without vmm_lock, applying the queue once it is full.
+static inline void queuePendingAccess(PCB *pcb, uint64_t page, uint64_t virtual_address, unsigned int frame, bool loaded) {
+    pending_accesses[num_pending++] = (PendingAccess){ pcb, page, virtual_address, frame, loaded };
+    if (num_pending == PENDING_ACCESS_LIMIT) {
+        lockVMM();
+        pthread_mutex_unlock(&vmm_lock);
+    }
+}
+
+// Loads a page that is not resident into a frame from the CPU's cache, with the process's
+// table held for writing but without vmm_lock. Returns false if no frame is free, another
+// CPU loaded the page first or the page is in swap.
+static bool loadPageShared(PCB *pcb, uint64_t page_number, uint64_t virtual_address, bool write) {
+    int64_t frame = takeCachedFrame();
+    if (frame < 0) {
+        lockVMM();
+        bool refilled = refillFrameCache();
+        pthread_mutex_unlock(&vmm_lock);
+        if (!refilled) {
+            return false;
+        }
+        frame = takeCachedFrame();
+    }
+
+    pthread_rwlock_wrlock(&pcb->table_lock);
+    PageTableEntry *entry = createPageTableEntry(&pcb->page_table, page_number);
+    PageTableEntry old_entry = __atomic_load_n(entry, __ATOMIC_RELAXED);
+    if (pteHoldsPage(old_entry)) {
+        pthread_rwlock_unlock(&pcb->table_lock);
+        returnCachedFrame((unsigned int)frame);
+        return false;
+    }
+    PageTableEntry new_entry = pteWithFrame(old_entry | PTE_VALID | PTE_ACCESSED | (write ? PTE_DIRTY : 0), (uint64_t)frame);
+    __atomic_store_n(entry, new_entry, __ATOMIC_SEQ_CST);
+    pthread_rwlock_unlock(&pcb->table_lock);
+
+    tlbInsert(pcb->pid, page_number, (unsigned int)frame, write, 0);
+    queuePendingAccess(pcb, page_number, virtual_address, (unsigned int)frame, true);
+    return true;
+}
+
+// Translates a page that missed in the TLB without vmm_lock, when possible: the page is
+// resident and the access needs no copy-on-write, or it is not resident and can be loaded
+// by loadPageShared. The accessed and dirty bits are set with a compare-and-swap, since an
+// evicting CPU may clear the entry at the same time. Returns false if the locked path
+// must be taken.
+static bool translateShared(PCB *pcb, uint64_t page_number, uint64_t virtual_address, bool write, TlbEntry *cached) {
+    unsigned int order;
+    pthread_rwlock_rdlock(&pcb->table_lock);
+    PageTableEntry *entry = walkPageTableShared(&pcb->page_table, page_number, &order);
+    PageTableEntry old_entry = entry ? __atomic_load_n(entry, __ATOMIC_RELAXED) : 0;
+    PageTableEntry new_entry = 0;
+    bool mapped = false;
+    while ((old_entry & PTE_VALID) && !(write && (old_entry & PTE_COW))) {
+        new_entry = old_entry | PTE_ACCESSED | (write ? PTE_DIRTY : 0);
+        if (new_entry == old_entry ||
+            __atomic_compare_exchange_n(entry, &old_entry, new_entry, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            mapped = true;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&pcb->table_lock);
+
+    if (!mapped) {
+        // A stale TLB entry, huge pages, copy-on-write and swap are left to the locked path.
+        if (pteHoldsPage(old_entry) || cached || geometry.huge_pages) {
+            return false;
+        }
+        return loadPageShared(pcb, page_number, virtual_address, write);
+    }
+
+    unsigned int first_frame = (unsigned int)pteFrame(new_entry);
+    bool writable = (new_entry & (PTE_DIRTY | PTE_COW)) == PTE_DIRTY;
+    if (cached && cached->frame == first_frame) {
+        cached->dirty = writable;
+    } else {
+        if (cached) {
+            cached->valid = false;
+        }
+        tlbInsert(pcb->pid, page_number, first_frame, writable, order);
+    }
+    queuePendingAccess(pcb, page_number & ~((1ULL << order) - 1), virtual_address, first_frame, false);
+    return true;
+}
+
+// Translates a page with vmm_lock and the process's table held for writing, running the
+// single-threaded code. Shootdowns posted before the lock was taken are applied first, in
+// case they invalidated the cached entry.
+static void translateLocked(PCB *pcb, uint64_t page_number, uint64_t virtual_address, bool write, TlbEntry *cached) {
+    lockVMM();
+    tlbProcessShootdowns();
+    if (cached && !cached->valid) {
+        cached = NULL;
+    }
+    pthread_rwlock_wrlock(&pcb->table_lock);
+    locked_pcb = pcb;
+    translateMiss(pcb, page_number, virtual_address, write, cached);
+    locked_pcb = NULL;
+    pthread_rwlock_unlock(&pcb->table_lock);
+    pthread_mutex_unlock(&vmm_lock);
+}
+
+// Brings count CPUs online for a concurrent replay.
+void startCPUs(unsigned int count) {
+    tlbStartCPUs(count);
+    concurrent = true;
+}
+
+// Makes the calling thread one of the CPUs.
+void enterCPU(unsigned int cpu) {
+    current_cpu = cpu;
+    tlbSelectCPU(cpu);
+}
+
+// Reads or writes a virtual address within a process's memory from the calling thread's
+// CPU. Translations are not traced, as they would serialize the CPUs.
+void accessMemoryConcurrent(PCB *pcb, uint64_t virtual_address, bool write) {
+    tlbProcessShootdowns();
+    // Evicting CPUs only send shootdowns to the CPUs in the process's mask.
+    uint64_t cpu_bit = 1ULL << current_cpu;
+    if (!(__atomic_load_n(&pcb->cpu_mask, __ATOMIC_RELAXED) & cpu_bit)) {
+        __atomic_fetch_or(&pcb->cpu_mask, cpu_bit, __ATOMIC_SEQ_CST);
+    }
+
+    uint64_t page_number = virtual_address >> geometry.page_shift;
     if (page_number >= pcb->page_table.num_pages) {
-        printf("Error: The virtual address %u is out of bounds for process %u.\n", virtual_address, pcb->pid);
+        lockVMM();
+        traceEvent(TRACE_ACCESS_OUT_OF_BOUNDS, pcb->pid, virtual_address, 0, 0);
+        pthread_mutex_unlock(&vmm_lock);
+        return;
+    }
+    TlbEntry *cached = tlbLookup(pcb->pid, page_number);
+    if (cached && (!write || cached->dirty)) {
+        queuePendingAccess(pcb, page_number & ~((1ULL << cached->order) - 1), virtual_address, cached->frame, false);
         return;
     }
+    if (!translateShared(pcb, page_number, virtual_address, write, cached)) {
+        translateLocked(pcb, page_number, virtual_address, write, cached);
+    }
+}
 
-    PageTableEntry *entry = &pcb->page_table.entries[page_number];
-    // Handle page fault if the page is not valid.
-    if (!entry->valid) {
-        printf("Page fault for process %u at virtual address %u: Page %u not in physical memory.\n", pcb->pid, virtual_address, page_number);
-        // Load the page into memory (simulated here).
-        entry->valid = 1;
-        entry->frame_number = page_number % frame_table.num_frames; // Simple mapping example.
-        printf("Page %u loaded into frame %u for process %u.\n", page_number, entry->frame_number, pcb->pid);
+// Applies the calling CPU's pending accesses and returns its cached frames.
+void leaveCPU() {
+    lockVMM();
+    drainFrameCache();
+    pthread_mutex_unlock(&vmm_lock);
+}
+
+// Ends a concurrent replay, on the thread that was CPU 0, once the other CPUs have left.
+void stopCPUs() {
+    tlbProcessShootdowns();
+    tlbStopCPUs();
+    concurrent = false;
+}
+
+// State of a fork while the parent's resident pages are visited.
+typedef struct {
+    PCB *parent;
+    PCB *child;
+    uint64_t frames_shared;
+} ForkState;
+
+// Maps one page of the parent into the child. A resident frame is shared copy-on-write; a
+// page in swap is shared by pointing both entries at its slots, since reading it back
+// gives each process a frame of its own.
+static void sharePage(void *context, uint64_t page, PageTableEntry *entry, unsigned int order) {
+    ForkState *fork_state = (ForkState *)context;
+    PageTable *child_table = &fork_state->child->page_table;
+    PageTableEntry *child_entry = order > 0 ? createHugePageTableEntry(child_table, page, order)
+                                            : createPageTableEntry(child_table, page);
+    if (!(*entry & PTE_VALID)) {
+        *child_entry = *entry;
+        retainSwapSlots(pteFrame(*entry), 1ULL << order);
+        return;
     }
+    *entry |= PTE_COW;
+    *child_entry = *entry;
+    shareFrame(fork_state->child, (unsigned int)pteFrame(*entry));
+    fork_state->frames_shared += 1ULL << order;
+}
+
+// Makes child a copy of parent's address space. Instead of copying resident pages, both
+// processes map the same frames marked copy-on-write; the parent's cached translations are
+// flushed so its next write to a shared page walks the table and copies it.
+uint64_t forkProcess(PCB *parent, PCB *child, unsigned int child_pid) {
+    child->pid = child_pid;
+    child->memory_requirement = parent->memory_requirement;
+    pthread_rwlock_init(&child->table_lock, NULL);
+    initializePageTable(&child->page_table, parent->page_table.layout);
+    truncatePageTable(&child->page_table, parent->page_table.num_pages, NULL, NULL);
 
-    entry->accessed = 1;
-    // Calculate the physical address from the page number and offset.
-    unsigned int physical_address = (entry->frame_number * PAGE_SIZE) + offset;
-    printf("Virtual address %u translated to physical address %u for process %u.\n", virtual_address, physical_address, pcb->pid);
+    ForkState fork_state = { parent, child, 0 };
+    forEachStoredPage(&parent->page_table, sharePage, &fork_state);
+    tlbFlushAsid(parent->pid);
+    tlbFlushAsid(child_pid);
+    recordFork(fork_state.frames_shared);
+    traceEvent(TRACE_PROCESS_FORKED, child->pid, parent->pid, fork_state.frames_shared, 0);
+    return fork_state.frames_shared;
+}
+
+// Gives back the frame of a resident page dropped from a process's page table, or the swap
+// slots of a page that was swapped out.
+static void releasePage(void *context, uint64_t page, PageTableEntry *entry, unsigned int order) {
+    PCB *pcb = (PCB *)context;
+    if (!(*entry & PTE_VALID)) {
+        releaseSwapSlots(pteFrame(*entry), 1ULL << order);
+        return;
+    }
+    invalidateTranslation(pcb, page, order);
+    releaseFrame(pcb, (unsigned int)pteFrame(*entry));
 }
 
 // Frees a specified amount of memory from a process.
 void freeMemory(PCB *pcb, size_t memory_to_free) {
     // Ensure the requested amount to free does not exceed the allocated memory.
     if(memory_to_free > pcb->memory_requirement) {
-        printf("Error: Cannot free %zu bytes from process %u. Only %zu bytes are currently allocated.\n", memory_to_free, pcb->pid, pcb->memory_requirement);
+        traceEvent(TRACE_FREE_TOO_LARGE, pcb->pid, memory_to_free, pcb->memory_requirement, 0);
         return;
     }
 
     // Decrease the process's memory requirement.
     pcb->memory_requirement -= memory_to_free;
     // Calculate the new number of pages required.
-    unsigned int new_num_pages = (pcb->memory_requirement + PAGE_SIZE - 1) / PAGE_SIZE;
-
-    // Check if the number of pages can be reduced.
-    if(new_num_pages < pcb->page_table.num_pages) {
-        // Reduce the page table size.
-        PageTableEntry *new_entries = (PageTableEntry *)realloc(pcb->page_table.entries, new_num_pages * sizeof(PageTableEntry));
-        if (!new_entries && new_num_pages > 0) {
-            perror("Failed to reallocate the page table entries");
-            exit(EXIT_FAILURE);
-        }
+    uint64_t new_num_pages = (pcb->memory_requirement + geometry.page_size - 1) >> geometry.page_shift;
+    // Shrink the page table, giving back the frames of the pages being dropped.
+    truncatePageTable(&pcb->page_table, new_num_pages, releasePage, pcb);
 
-        pcb->page_table.entries = new_entries;
-        pcb->page_table.num_pages = new_num_pages;
-    }
+    traceEvent(TRACE_MEMORY_FREED, pcb->pid, memory_to_free, pcb->page_table.num_pages, 0);
+}
 
-    printf("Freed %zu bytes of memory from process %u. %u pages remaining.\n", memory_to_free, pcb->pid, pcb->page_table.num_pages);
+// Gives back every frame and swap slot of a process, keeping its address space.
+void dropResidentPages(PCB *pcb) {
+    uint64_t num_pages = pcb->page_table.num_pages;
+    truncatePageTable(&pcb->page_table, 0, releasePage, pcb);
+    truncatePageTable(&pcb->page_table, num_pages, NULL, NULL);
+}
+
+// Invalidates a resident page whose frame is being reused. Returns true if it was dirty.
+// With swap_out, the page is being swapped out and the entry is left pointing to the slot
+// swapSlotFor picks, if any. In a concurrent replay other CPUs may be walking pcb's table
+// and setting bits in the entry with a compare-and-swap; the table is held for writing,
+// so the dirty bit read here is final.
+bool unmapPage(PCB *pcb, uint64_t page, SwapOut *swap_out) {
+    bool lock = concurrent && pcb != locked_pcb;
+    if (lock) {
+        pthread_rwlock_wrlock(&pcb->table_lock);
+    }
+    // The page is resident, so its entry exists; looking it up is not counted as a walk.
+    unsigned int order;
+    PageTableEntry *entry = findPageTableEntry(&pcb->page_table, page, &order);
+    PageTableEntry old_entry = *entry;
+    bool dirty = (old_entry & PTE_DIRTY) != 0;
+    uint64_t slot = swap_out ? swapSlotFor(swap_out, dirty) : 0;
+    PageTableEntry new_entry = slot ? pteWithFrame((old_entry & (PTE_HUGE | PTE_ACCESSED)) | PTE_SWAPPED, slot - 1)
+                                    : old_entry & ~(PTE_VALID | PTE_DIRTY | PTE_COW);
+    __atomic_store_n(entry, new_entry, __ATOMIC_SEQ_CST);
+    if (lock) {
+        pthread_rwlock_unlock(&pcb->table_lock);
+    }
+    invalidateTranslation(pcb, page, order);
+    return dirty;
 }
 
 // Cleans up the VMM by freeing the frame table.
 void cleanupVMM() {
-    free(frame_table.frame_usage_count);
+    cleanupFrameManager();
 }
 
 
@@ -1,49 +1,84 @@
 #ifndef VMM_H
 #define VMM_H
 
+#include "scheduler.h"
+#include "replacement_policy.h"
+#include "page_table.h"
+#include "swap.h"
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-// Define the size of a memory page.
-#define PAGE_SIZE 4096  // Page size in bytes.
+// Default geometry of the simulated machine: 4 KiB pages, 16 frames of physical memory and
+// 48-bit virtual addresses, as on x86-64.
+#define DEFAULT_PAGE_SIZE 4096
+#define DEFAULT_PHYS_MEM_SIZE (16 * DEFAULT_PAGE_SIZE)
+#define DEFAULT_ADDRESS_BITS 48
 
-// Define the size of the physical memory.
-#define PHYS_MEM_SIZE 16 * PAGE_SIZE  // Physical memory size in bytes.
+// Limits on the geometry. Frame numbers, and twice as many ARC ghosts, must fit in an int.
+#define MIN_PAGE_SIZE 1024
+#define MAX_PAGE_SIZE (1ULL << 30)
+#define MIN_ADDRESS_BITS 32
+#define MAX_ADDRESS_BITS 57
+#define MAX_FRAMES (1U << 30)
 
-// Define the size of the virtual memory.
-#define VIRT_MEM_SIZE 64 * PAGE_SIZE  // Virtual memory size in bytes.
+// Huge pages span one or two radix levels above a page: 2 MiB and 1 GiB with 4 KiB pages.
+#define HUGE_PAGE_LEVELS 2
 
-// Structure to represent a page table entry.
-typedef struct {
-    unsigned int frame_number: 10;  // Frame number within physical memory (limited to 10 bits for small physical memory size).
-    unsigned int valid: 1;          // Flag to indicate if the page is valid (in memory).
-    unsigned int dirty: 1;          // Flag to indicate if the page has been modified.
-    unsigned int accessed: 1;       // Flag to indicate if the page has been accessed.
-} PageTableEntry;
+// Simulated CPUs in a concurrent replay. Each has its own TLB and a bit in PCB.cpu_mask.
+#define MAX_CPUS 64
 
-// Structure to represent a page table.
+// Memory geometry of the simulated machine, set at startup.
+typedef struct {
+    uint64_t page_size;             // Bytes per page; a power of two.
+    unsigned int page_shift;        // log2(page_size).
+    uint64_t physical_memory;       // Bytes of physical memory; a multiple of the page size.
+    unsigned int num_frames;        // physical_memory / page_size.
+    unsigned int address_bits;      // Width of virtual addresses.
+    uint64_t max_virtual_memory;    // 2^address_bits: the largest address space of a process.
+    bool huge_pages;                // Map large aligned regions with huge pages (radix tables only).
+} MemoryGeometry;
+
+// Memory access counters, kept per process and in total.
 typedef struct {
-    PageTableEntry *entries;        // Pointer to an array of page table entries.
-    unsigned int num_pages;         // Number of pages in the page table.
-} PageTable;
+    uint64_t hits;                  // Accesses to pages already in physical memory.
+    uint64_t faults;                // Accesses that had to load the page.
+    uint64_t evictions;             // Pages taken out of memory to make room for others.
+    uint64_t writebacks;            // Evicted pages that were dirty and had to be written back.
+    uint64_t huge_faults;           // Faults that loaded a whole huge page.
+    uint64_t cow_copies;            // Frames copied because a page shared after a fork was written.
+    uint64_t swap_ins;              // Pages read back from swap on a fault.
+    uint64_t swap_outs;             // Evicted pages written to swap.
+} MemoryStats;
 
 // Structure to represent a process control block (PCB).
 typedef struct {
     PageTable page_table;           // Page table for the process.
     unsigned int pid;               // Process ID.
     size_t memory_requirement;      // Total memory requirement of the process in bytes.
+    Process process;                // Scheduling record; the scheduler queues a pointer to it.
+    MemoryStats stats;              // Hits, faults, evictions and write-backs of this process.
+    pthread_rwlock_t table_lock;    // Concurrent replays: held to read the page table, or to change it.
+    uint64_t cpu_mask;              // CPUs that may have cached translations of this process.
 } PCB;
 
-// Structure to represent the frame table.
-typedef struct {
-    int *frame_usage_count;         // Array to track the usage count of each frame.
-    unsigned int num_frames;        // Total number of frames in physical memory.
-} FrameTable;
-
 // Function declarations for virtual memory management.
 
-// Initializes the Virtual Memory Manager.
-void initializeVMM();
+// Checks a geometry's page size, physical memory size and address width, and fills in the
+// derived fields. Returns NULL if it is valid, or a description of the problem.
+const char* validateMemoryGeometry(MemoryGeometry *geometry);
+
+// Initializes the Virtual Memory Manager with a validated geometry, the given page
+// replacement policy and the page table layout used for new processes.
+void initializeVMM(const MemoryGeometry *geometry, ReplacementPolicyType policy, PageTableLayout layout);
+
+// Returns the geometry in use.
+const MemoryGeometry* memoryGeometry();
+
+// Returns the replacement policy and the page table layout given to new processes.
+ReplacementPolicyType replacementPolicyType();
+PageTableLayout pageTableLayout();
 
 // Creates a process with the given PID and memory size.
 void createProcess(PCB *pcb, unsigned int pid, size_t memory_size);
@@ -51,11 +86,38 @@ void createProcess(PCB *pcb, unsigned int pid, size_t memory_size);
 // Allocates memory for a process.
 void allocateMemory(PCB *pcb, size_t memory_size);
 
-// Simulates memory access for a given virtual address in a process.
-void accessMemory(PCB *pcb, unsigned int virtual_address);
+// Simulates a read or write of a given virtual address in a process.
+void accessMemory(PCB *pcb, uint64_t virtual_address, bool write);
+
+// Performs count accesses, the i-th by pcbs[i] at virtual_addresses[i], in order. Batches
+// of ACCESS_BATCH_SIZE are translated together.
+#define ACCESS_BATCH_SIZE 256
+void accessMemoryBatch(PCB **pcbs, const uint64_t *virtual_addresses, const bool *writes, size_t count);
+
+// Makes child a copy of parent's address space: the page table is copied and resident
+// frames are shared copy-on-write. Returns the number of frames shared.
+uint64_t forkProcess(PCB *parent, PCB *child, unsigned int child_pid);
 
 // Frees a specified amount of memory from a process.
 void freeMemory(PCB *pcb, size_t memory_to_free);
 
+// Invalidates a resident page whose frame is being reused. Returns true if it was dirty.
+// When the page is being swapped out, swap_out says where to; otherwise it is NULL.
+bool unmapPage(PCB *pcb, uint64_t page, SwapOut *swap_out);
+
+// Gives back every frame and swap slot of a process. Its address space is kept, and its
+// pages fault back in as new pages when next accessed.
+void dropResidentPages(PCB *pcb);
+
+// Concurrent replays run count simulated CPUs, each on its own thread, against the shared
+// processes and physical memory. startCPUs is called first, then each thread calls
+// enterCPU, accessMemoryConcurrent for its accesses and leaveCPU; stopCPUs ends the replay.
+// Processes must not be created or changed in any other way meanwhile.
+void startCPUs(unsigned int count);
+void enterCPU(unsigned int cpu);
+void accessMemoryConcurrent(PCB *pcb, uint64_t virtual_address, bool write);
+void leaveCPU();
+void stopCPUs();
+
 #endif // VMM_H
 
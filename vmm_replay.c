@@ -0,0 +1,611 @@
+#include "vmm_replay.h"
+#include "vmm.h"
+#include "process_registry.h"
+#include "frame_manager.h"
+#include "script_file.h"
+#include "tlb.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Accesses handed to the VMM at once. A multiple of ACCESS_BATCH_SIZE.
+#define REPLAY_CHUNK_SIZE (16 * ACCESS_BATCH_SIZE)
+
+// Accesses gathered from a trace, waiting to be replayed.
+typedef struct {
+    PCB *pcbs[REPLAY_CHUNK_SIZE];
+    uint64_t addresses[REPLAY_CHUNK_SIZE];
+    bool writes[REPLAY_CHUNK_SIZE];
+    size_t count;
+    uint64_t total;                 // Accesses replayed so far.
+    unsigned int last_pid;          // Most recent pid looked up, and its PCB.
+    PCB *last_pcb;
+    unsigned int created;           // Processes created for pids the trace introduced.
+} ReplayState;
+
+// Returns the PCB of a pid named in a trace. Pids that do not exist yet get a process with
+// the whole virtual address space; they are not queued with the scheduler.
+static PCB* replayProcess(ReplayState *state, unsigned int pid) {
+    if (state->last_pcb && state->last_pid == pid) {
+        return state->last_pcb;
+    }
+    PCB *pcb = findProcess(pid);
+    if (pcb == NULL) {
+        pcb = registerProcess(pid);
+        createProcess(pcb, pid, memoryGeometry()->max_virtual_memory);
+        state->created++;
+    }
+    state->last_pid = pid;
+    state->last_pcb = pcb;
+    return pcb;
+}
+
+// Replays the accesses gathered so far.
+static void replayPending(ReplayState *state) {
+    accessMemoryBatch(state->pcbs, state->addresses, state->writes, state->count);
+    state->total += state->count;
+    state->count = 0;
+}
+
+// Adds one access, replaying the chunk once it is full.
+static inline void queueAccess(ReplayState *state, unsigned int pid, uint64_t address, bool write) {
+    state->pcbs[state->count] = replayProcess(state, pid);
+    state->addresses[state->count] = address;
+    state->writes[state->count] = write;
+    if (++state->count == REPLAY_CHUNK_SIZE) {
+        replayPending(state);
+    }
+}
+
+// Parses one text trace line: "<pid> r|w <address>". Blank lines and lines starting with
+// '#' are skipped. Returns -1 for a malformed line, 0 for a skipped one and 1 for an access.
+static int parseTraceLine(char *line, unsigned int *pid, uint64_t *address, bool *write) {
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '\0' || *line == '#' || *line == '\r') {
+        return 0;
+    }
+
+    char *end;
+    unsigned long value = strtoul(line, &end, 10);
+    if (end == line || value > UINT32_MAX || (*end != ' ' && *end != '\t')) {
+        return -1;
+    }
+    *pid = (unsigned int)value;
+    while (*end == ' ' || *end == '\t') {
+        end++;
+    }
+    if ((end[0] != 'r' && end[0] != 'w') || (end[1] != ' ' && end[1] != '\t')) {
+        return -1;
+    }
+    *write = end[0] == 'w';
+
+    line = end + 2;
+    *address = strtoull(line, &end, 0);
+    if (end == line || (*end != '\0' && *end != '\r' && *end != ' ' && *end != '\t')) {
+        return -1;
+    }
+    return 1;
+}
+
+// Maps a whole file for reading. Returns NULL and sets *length to 0 for an empty file.
+static void* mapTraceFile(const char *path, size_t *length, bool *ok) {
+    *ok = false;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return NULL;
+    }
+    *length = (size_t)info.st_size;
+    void *data = NULL;
+    if (*length > 0) {
+        data = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+        madvise(data, *length, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    *ok = true;
+    return data;
+}
+
+// Returns true if a mapped file starts with a binary trace header.
+static bool isBinaryTrace(const void *data, size_t length) {
+    return length >= sizeof(VmmTraceHeader) && memcmp(data, VMM_TRACE_MAGIC, sizeof(VMM_TRACE_MAGIC)) == 0;
+}
+
+// Returns the records of a mapped binary trace and sets *num_records, or returns NULL if
+// the header is not usable.
+static const VmmTraceRecord* binaryTraceRecords(const char *data, size_t length, size_t *num_records) {
+    const VmmTraceHeader *header = (const VmmTraceHeader *)data;
+    if (header->version != VMM_TRACE_VERSION || header->record_size != sizeof(VmmTraceRecord)) {
+        printf("Unsupported trace file version %u (record size %u).\n", header->version, header->record_size);
+        return NULL;
+    }
+
+    *num_records = (length - sizeof(VmmTraceHeader)) / sizeof(VmmTraceRecord);
+    if ((length - sizeof(VmmTraceHeader)) % sizeof(VmmTraceRecord) != 0) {
+        printf("Warning: trace ends with a partial record, which is ignored.\n");
+    }
+    return (const VmmTraceRecord *)(data + sizeof(VmmTraceHeader));
+}
+
+// Replays the records of a mapped binary trace. Returns false if the header is not usable.
+static bool replayBinaryTrace(ReplayState *state, const char *data, size_t length) {
+    size_t num_records;
+    const VmmTraceRecord *records = binaryTraceRecords(data, length, &num_records);
+    if (!records) {
+        return false;
+    }
+    for (size_t i = 0; i < num_records; i++) {
+        queueAccess(state, records[i].pid, records[i].address, records[i].write != 0);
+    }
+    return true;
+}
+
+// Replays a text trace. Stops at the first malformed line and returns false.
+static bool replayTextTrace(ReplayState *state, ScriptFile *script) {
+    char *line;
+    size_t line_number = 0;
+    while ((line = nextScriptLine(script)) != NULL) {
+        line_number++;
+        unsigned int pid;
+        uint64_t address;
+        bool is_write;
+        int result = parseTraceLine(line, &pid, &address, &is_write);
+        if (result < 0) {
+            printf("Malformed trace line %zu: expected \"<pid> r|w <address>\".\n", line_number);
+            return false;
+        }
+        if (result > 0) {
+            queueAccess(state, pid, address, is_write);
+        }
+    }
+    return true;
+}
+
+// Returns the time elapsed since start, in seconds.
+static double secondsSince(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Prints the hits, faults, evictions and write-backs between two snapshots of the totals,
+// and the pages moved to and from swap.
+static void printReplayCounts(const MemoryStats *before, const MemoryStats *after) {
+    uint64_t hits = after->hits - before->hits;
+    uint64_t faults = after->faults - before->faults;
+    printf("%llu hits, %llu faults (%.2f%% hit rate), %llu evictions, %llu write-backs\n",
+           (unsigned long long)hits, (unsigned long long)faults,
+           hits + faults ? 100.0 * (double)hits / (double)(hits + faults) : 0.0,
+           (unsigned long long)(after->evictions - before->evictions),
+           (unsigned long long)(after->writebacks - before->writebacks));
+    if (swapEnabled()) {
+        printf("%llu pages read from swap, %llu written to swap\n", (unsigned long long)(after->swap_ins - before->swap_ins),
+               (unsigned long long)(after->swap_outs - before->swap_outs));
+    }
+}
+
+// Replays a trace file through the VMM and prints the throughput and fault counts.
+static void replayTraceFile(const char *path) {
+    size_t length;
+    bool ok;
+    char *data = mapTraceFile(path, &length, &ok);
+    if (!ok) {
+        perror(path);
+        return;
+    }
+    bool binary = isBinaryTrace(data, length);
+    ScriptFile script;
+    if (!binary) {
+        // Text traces are read through the script reader, which splits lines in place.
+        if (data) {
+            munmap(data, length);
+        }
+        if (!openScriptFile(path, &script, true)) {
+            perror(path);
+            return;
+        }
+    }
+
+    ReplayState *state = (ReplayState *)calloc(1, sizeof(ReplayState));
+    if (!state) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+
+    // Printing every translation would dominate the replay, so only errors are shown.
+    TraceLevel level = getTraceLevel();
+    if (level == TRACE_EVENT) {
+        setTraceLevel(TRACE_SUMMARY);
+    }
+    MemoryStats before = *memoryTotals();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ok = binary ? replayBinaryTrace(state, data, length) : replayTextTrace(state, &script);
+    replayPending(state);
+
+    double seconds = secondsSince(&start);
+    setTraceLevel(level);
+    if (binary) {
+        munmap(data, length);
+    } else {
+        closeScriptFile(&script);
+    }
+
+    printf("Replayed %llu accesses (%s trace, %u new processes) in %.3f s: %.0f accesses/s\n",
+           (unsigned long long)state->total, binary ? "binary" : "text", state->created, seconds,
+           seconds > 0 ? (double)state->total / seconds : 0.0);
+    printReplayCounts(&before, memoryTotals());
+    if (!ok) {
+        printf("Replay stopped early.\n");
+    }
+    free(state);
+}
+
+// A whole trace held in memory as binary records, for concurrent replays.
+typedef struct {
+    const VmmTraceRecord *records;
+    size_t num_records;
+    bool binary;
+    void *data;                     // The mapped binary trace, or the records parsed from a text one.
+    size_t length;
+} LoadedTrace;
+
+// Maps a binary trace, or parses a text trace into records. Returns false if the file cannot
+// be read or is malformed.
+static bool loadTrace(const char *path, LoadedTrace *trace) {
+    bool ok;
+    memset(trace, 0, sizeof(LoadedTrace));
+    trace->data = mapTraceFile(path, &trace->length, &ok);
+    if (!ok) {
+        perror(path);
+        return false;
+    }
+    trace->binary = isBinaryTrace(trace->data, trace->length);
+    if (trace->binary) {
+        trace->records = binaryTraceRecords((const char *)trace->data, trace->length, &trace->num_records);
+        if (!trace->records) {
+            munmap(trace->data, trace->length);
+        }
+        return trace->records != NULL;
+    }
+
+    if (trace->data) {
+        munmap(trace->data, trace->length);
+    }
+    trace->data = NULL;
+    ScriptFile script;
+    if (!openScriptFile(path, &script, true)) {
+        perror(path);
+        return false;
+    }
+    size_t capacity = REPLAY_CHUNK_SIZE;
+    VmmTraceRecord *records = (VmmTraceRecord *)malloc(capacity * sizeof(VmmTraceRecord));
+    char *line;
+    size_t line_number = 0;
+    ok = true;
+    while (ok && records && (line = nextScriptLine(&script)) != NULL) {
+        line_number++;
+        unsigned int pid;
+        uint64_t address;
+        bool is_write;
+        int result = parseTraceLine(line, &pid, &address, &is_write);
+        if (result < 0) {
+            printf("Malformed trace line %zu: expected \"<pid> r|w <address>\".\n", line_number);
+            ok = false;
+        } else if (result > 0) {
+            if (trace->num_records == capacity) {
+                capacity *= 2;
+                records = (VmmTraceRecord *)realloc(records, capacity * sizeof(VmmTraceRecord));
+                if (!records) {
+                    break;
+                }
+            }
+            records[trace->num_records++] = (VmmTraceRecord){ address, pid, is_write };
+        }
+    }
+    closeScriptFile(&script);
+    if (!records) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    if (!ok) {
+        free(records);
+        return false;
+    }
+    trace->data = records;
+    trace->records = records;
+    return true;
+}
+
+// Releases a loaded trace.
+static void releaseTrace(LoadedTrace *trace) {
+    if (trace->binary) {
+        if (trace->data) {
+            munmap(trace->data, trace->length);
+        }
+    } else {
+        free(trace->data);
+    }
+}
+
+// One simulated CPU of a concurrent replay. The trace is dealt out in chunks: CPU k replays
+// chunks k, k + num_cpus, k + 2 * num_cpus and so on, so every CPU sees every process.
+typedef struct {
+    const LoadedTrace *trace;
+    unsigned int cpu;
+    unsigned int num_cpus;
+} ReplayCPU;
+
+// Thread body: replays one CPU's chunks of the trace.
+static void* replayOnCPU(void *argument) {
+    ReplayCPU *replay = (ReplayCPU *)argument;
+    const VmmTraceRecord *records = replay->trace->records;
+    size_t num_records = replay->trace->num_records;
+    size_t stride = (size_t)replay->num_cpus * REPLAY_CHUNK_SIZE;
+    unsigned int last_pid = 0;
+    PCB *last_pcb = NULL;
+
+    enterCPU(replay->cpu);
+    for (size_t start = (size_t)replay->cpu * REPLAY_CHUNK_SIZE; start < num_records; start += stride) {
+        size_t end = num_records - start < REPLAY_CHUNK_SIZE ? num_records : start + REPLAY_CHUNK_SIZE;
+        for (size_t i = start; i < end; i++) {
+            if (!last_pcb || records[i].pid != last_pid) {
+                last_pid = records[i].pid;
+                last_pcb = findProcess(last_pid);
+            }
+            accessMemoryConcurrent(last_pcb, records[i].address, records[i].write != 0);
+        }
+    }
+    leaveCPU();
+    return NULL;
+}
+
+// Counters of one concurrent replay.
+typedef struct {
+    double seconds;
+    MemoryStats before;
+    MemoryStats after;
+    uint64_t tlb_hits;
+    uint64_t tlb_misses;
+    uint64_t shootdowns_sent;
+    uint64_t shootdown_flushes;
+} ConcurrentReplay;
+
+// Replays a loaded trace on num_cpus simulated CPUs, one thread each; the calling thread is
+// CPU 0. The processes the trace names must exist.
+static void replayConcurrently(const LoadedTrace *trace, unsigned int num_cpus, ConcurrentReplay *result) {
+    ReplayCPU cpus[num_cpus];
+    pthread_t threads[num_cpus];
+    for (unsigned int cpu = 0; cpu < num_cpus; cpu++) {
+        cpus[cpu] = (ReplayCPU){ trace, cpu, num_cpus };
+    }
+    TlbStats cpu0_before = *tlbStats(0);
+    result->before = *memoryTotals();
+    startCPUs(num_cpus);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    unsigned int num_started = 1;
+    for (; num_started < num_cpus; num_started++) {
+        if (pthread_create(&threads[num_started], NULL, replayOnCPU, &cpus[num_started]) != 0) {
+            break;
+        }
+    }
+    replayOnCPU(&cpus[0]);
+    // CPUs whose thread could not be started are run here afterwards.
+    for (unsigned int cpu = num_started; cpu < num_cpus; cpu++) {
+        replayOnCPU(&cpus[cpu]);
+    }
+    for (unsigned int cpu = 1; cpu < num_started; cpu++) {
+        pthread_join(threads[cpu], NULL);
+    }
+    result->seconds = secondsSince(&start);
+    enterCPU(0);
+    stopCPUs();
+
+    result->after = *memoryTotals();
+    result->tlb_hits = result->tlb_misses = result->shootdowns_sent = result->shootdown_flushes = 0;
+    for (unsigned int cpu = 0; cpu < num_cpus; cpu++) {
+        const TlbStats *stats = tlbStats(cpu);
+        const TlbStats *before = cpu == 0 ? &cpu0_before : &(TlbStats){ 0 };
+        result->tlb_hits += stats->hits - before->hits;
+        result->tlb_misses += stats->misses - before->misses;
+        result->shootdowns_sent += stats->shootdowns_sent - before->shootdowns_sent;
+        result->shootdown_flushes += stats->shootdown_flushes - before->shootdown_flushes;
+    }
+}
+
+// Loads a trace for a concurrent replay and creates the processes it names, with event
+// tracing lowered to the summary level. Returns false if the trace cannot be used.
+static bool prepareConcurrentReplay(const char *path, LoadedTrace *trace, unsigned int *created, TraceLevel *level) {
+    if (!loadTrace(path, trace)) {
+        return false;
+    }
+    ReplayState *state = (ReplayState *)calloc(1, sizeof(ReplayState));
+    if (!state) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    *level = getTraceLevel();
+    if (*level == TRACE_EVENT) {
+        setTraceLevel(TRACE_SUMMARY);
+    }
+    for (size_t i = 0; i < trace->num_records; i++) {
+        replayProcess(state, trace->records[i].pid);
+    }
+    *created = state->created;
+    free(state);
+    return true;
+}
+
+// Replays a trace on num_cpus simulated CPUs and prints the throughput and counts.
+static void replayTraceFileConcurrently(const char *path, unsigned int num_cpus) {
+    LoadedTrace trace;
+    unsigned int created;
+    TraceLevel level;
+    if (!prepareConcurrentReplay(path, &trace, &created, &level)) {
+        return;
+    }
+    ConcurrentReplay result;
+    replayConcurrently(&trace, num_cpus, &result);
+    setTraceLevel(level);
+
+    printf("Replayed %llu accesses on %u CPUs (%s trace, %u new processes) in %.3f s: %.0f accesses/s\n",
+           (unsigned long long)trace.num_records, num_cpus, trace.binary ? "binary" : "text", created, result.seconds,
+           result.seconds > 0 ? (double)trace.num_records / result.seconds : 0.0);
+    printReplayCounts(&result.before, &result.after);
+    uint64_t lookups = result.tlb_hits + result.tlb_misses;
+    printf("TLB hit rate %.2f%%, %llu shootdowns sent, %llu full flushes for overflowing shootdown queues\n",
+           lookups ? 100.0 * (double)result.tlb_hits / (double)lookups : 0.0,
+           (unsigned long long)result.shootdowns_sent, (unsigned long long)result.shootdown_flushes);
+    releaseTrace(&trace);
+}
+
+// Replays a trace on 1, 2, 4 and so on up to every online processor, starting each run with
+// no pages resident, and prints the throughput of each run against one CPU.
+static void measureReplayScaling(const char *path) {
+    LoadedTrace trace;
+    unsigned int created;
+    TraceLevel level;
+    if (!prepareConcurrentReplay(path, &trace, &created, &level)) {
+        return;
+    }
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int max_cpus = processors < 1 ? 1 : processors > MAX_CPUS ? MAX_CPUS : (unsigned int)processors;
+
+    printf("Replaying %llu accesses (%s trace) on 1 to %u CPUs\n", (unsigned long long)trace.num_records,
+           trace.binary ? "binary" : "text", max_cpus);
+    printf("%5s %10s %14s %8s %9s %12s\n", "CPUs", "Seconds", "Accesses/s", "Speedup", "Hit rate", "Shootdowns");
+    double base_rate = 0.0;
+    for (unsigned int num_cpus = 1;; num_cpus = num_cpus * 2 < max_cpus ? num_cpus * 2 : max_cpus) {
+        forEachProcess(dropResidentPages);
+        ConcurrentReplay result;
+        replayConcurrently(&trace, num_cpus, &result);
+        double rate = result.seconds > 0 ? (double)trace.num_records / result.seconds : 0.0;
+        if (num_cpus == 1) {
+            base_rate = rate;
+        }
+        uint64_t hits = result.after.hits - result.before.hits;
+        uint64_t faults = result.after.faults - result.before.faults;
+        printf("%5u %10.3f %14.0f %7.2fx %8.2f%% %12llu\n", num_cpus, result.seconds, rate,
+               base_rate > 0 ? rate / base_rate : 0.0, hits + faults ? 100.0 * (double)hits / (double)(hits + faults) : 0.0,
+               (unsigned long long)result.shootdowns_sent);
+        if (num_cpus == max_cpus) {
+            break;
+        }
+    }
+    setTraceLevel(level);
+    releaseTrace(&trace);
+}
+
+// Writes a whole buffer, retrying short writes.
+static bool writeBuffer(int fd, const void *buffer, size_t length) {
+    const char *bytes = (const char *)buffer;
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// Converts a text trace into the binary format.
+static void convertTraceFile(const char *text_path, const char *binary_path) {
+    ScriptFile script;
+    if (!openScriptFile(text_path, &script, true)) {
+        perror(text_path);
+        return;
+    }
+    int fd = open(binary_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(binary_path);
+        closeScriptFile(&script);
+        return;
+    }
+
+    VmmTraceHeader header = { VMM_TRACE_MAGIC, VMM_TRACE_VERSION, sizeof(VmmTraceRecord) };
+    VmmTraceRecord *records = (VmmTraceRecord *)malloc(REPLAY_CHUNK_SIZE * sizeof(VmmTraceRecord));
+    if (!records) {
+        perror("memory allocation error");
+        exit(EXIT_FAILURE);
+    }
+    bool ok = writeBuffer(fd, &header, sizeof(header));
+    size_t count = 0, line_number = 0;
+    uint64_t total = 0;
+    char *line;
+    while (ok && (line = nextScriptLine(&script)) != NULL) {
+        line_number++;
+        unsigned int pid;
+        uint64_t address;
+        bool is_write;
+        int result = parseTraceLine(line, &pid, &address, &is_write);
+        if (result < 0) {
+            printf("Malformed trace line %zu: expected \"<pid> r|w <address>\".\n", line_number);
+            ok = false;
+        } else if (result > 0) {
+            records[count++] = (VmmTraceRecord){ address, pid, is_write };
+            if (count == REPLAY_CHUNK_SIZE) {
+                ok = writeBuffer(fd, records, count * sizeof(VmmTraceRecord));
+                total += count;
+                count = 0;
+            }
+        }
+    }
+    if (ok && count > 0) {
+        ok = writeBuffer(fd, records, count * sizeof(VmmTraceRecord));
+        total += count;
+    }
+    if (close(fd) != 0) {
+        ok = false;
+    }
+    if (ok) {
+        printf("Wrote %llu records to %s\n", (unsigned long long)total, binary_path);
+    } else {
+        printf("Failed to convert %s\n", text_path);
+    }
+    free(records);
+    closeScriptFile(&script);
+}
+
+// vmmtrace <file> [cpus] | vmmtrace scale <file> | vmmtrace convert <text_file> <binary_file>
+void executeVMMTrace(char** arguments) {
+    char *end = NULL;
+    unsigned long num_cpus = arguments[1] != NULL && arguments[2] != NULL ? strtoul(arguments[2], &end, 10) : 0;
+    if (arguments[1] != NULL && strcmp(arguments[1], "convert") == 0 && arguments[2] != NULL && arguments[3] != NULL) {
+        convertTraceFile(arguments[2], arguments[3]);
+    } else if (arguments[1] != NULL && strcmp(arguments[1], "scale") == 0 && arguments[2] != NULL && arguments[3] == NULL) {
+        measureReplayScaling(arguments[2]);
+    } else if (arguments[1] != NULL && arguments[2] == NULL) {
+        replayTraceFile(arguments[1]);
+    } else if (arguments[3] == NULL && end != arguments[2] && *end == '\0' && num_cpus >= 1 && num_cpus <= MAX_CPUS) {
+        replayTraceFileConcurrently(arguments[1], (unsigned int)num_cpus);
+    } else {
+        printf("Usage: vmmtrace <file> [cpus] | vmmtrace scale <file> | vmmtrace convert <text_file> <binary_file>\n");
+        printf("A replay on cpus simulated CPUs uses that many threads; at most %d.\n", MAX_CPUS);
+    }
+}
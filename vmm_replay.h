@@ -0,0 +1,27 @@
+#ifndef VMM_REPLAY_H
+#define VMM_REPLAY_H
+
+#include <stdint.h>
+
+// Binary access traces start with this header, followed by VmmTraceRecord entries.
+#define VMM_TRACE_MAGIC "LSVMTRC"
+#define VMM_TRACE_VERSION 1
+
+typedef struct {
+    char magic[8];                  // "LSVMTRC\0"
+    uint32_t version;
+    uint32_t record_size;           // sizeof(VmmTraceRecord)
+} VmmTraceHeader;
+
+// One access of a binary trace.
+typedef struct {
+    uint64_t address;               // Virtual address.
+    uint32_t pid;                   // Simulated process making the access.
+    uint32_t write;                 // 1 for a write, 0 for a read.
+} VmmTraceRecord;
+
+// vmmtrace builtin: vmmtrace <file> [cpus] | vmmtrace scale <file> |
+// vmmtrace convert <text_file> <binary_file>
+void executeVMMTrace(char** arguments);
+
+#endif // VMM_REPLAY_H